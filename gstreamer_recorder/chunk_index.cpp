@@ -0,0 +1,258 @@
+#include "chunk_index.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_set>
+#include <glog/logging.h>
+
+void ChunkIndexWriter::begin() {
+    entries.clear();
+    first_utc_us = 0;
+    last_utc_us = 0;
+}
+
+void ChunkIndexWriter::set_anchor(gint64 utc_us, guint64 pts) {
+    anchor_utc_us = utc_us;
+    anchor_pts = pts;
+}
+
+/* Wall clock of the anchor plus the PTS distance to it */
+gint64 ChunkIndexWriter::utc_of(guint64 pts) const {
+    return anchor_utc_us + ((gint64) pts - (gint64) anchor_pts) / 1000;
+}
+
+void ChunkIndexWriter::add_buffer(guint64 pts, guint64 offset, gboolean keyframe) {
+    if (!anchor_utc_us)
+        set_anchor(g_get_real_time(), pts);
+    gint64 utc_us = utc_of(pts);
+    if (!first_utc_us)
+        first_utc_us = utc_us;
+    last_utc_us = std::max(last_utc_us, utc_us);
+
+    if (keyframe) {
+        ChunkIndexEntry entry;
+        entry.pts = pts;
+        entry.offset = offset;
+        entry.utc_us = utc_us;
+        entries.push_back(entry);
+    }
+}
+
+gboolean ChunkIndexWriter::finish(const gchar *chunk_path, guint64 file_size, ChunkCatalogRecord *record) {
+    if (!entries.empty())
+        first_utc_us = entries.front().utc_us;
+    if (!first_utc_us)
+        first_utc_us = last_utc_us = g_get_real_time();
+
+    /* Catalog the chunk even without keyframes so retention can delete it */
+    if (!chunk_catalog_record_for_file(chunk_path, first_utc_us, last_utc_us, record))
+        return FALSE;
+    record->file_size = file_size;
+
+    if (!entries.empty()) {
+        ChunkIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = CHUNK_INDEX_MAGIC;
+        header.version = CHUNK_INDEX_VERSION;
+        header.count = entries.size();
+        header.first_utc_us = first_utc_us;
+        header.last_utc_us = last_utc_us;
+        header.file_size = file_size;
+
+        std::string data((const char *) &header, sizeof(header));
+        data.append((const char *) entries.data(), entries.size() * sizeof(ChunkIndexEntry));
+
+        GError *error = NULL;
+        gchar *index_path = g_strconcat(chunk_path, CHUNK_INDEX_SUFFIX, NULL);
+        gboolean written = g_file_set_contents(index_path, data.data(), data.size(), &error);
+        g_free(index_path);
+        if (!written) {
+            LOG(ERROR) << "[Chunk Index] - Failed to write index of " << chunk_path << ": " << error->message;
+            g_error_free(error);
+        }
+    }
+
+    gchar *folder = g_path_get_dirname(chunk_path);
+    gboolean ret = chunk_catalog_append(folder, record);
+    g_free(folder);
+
+    LOG(INFO) << "[Chunk Index] - Indexed " << entries.size() << " keyframes of " << chunk_path;
+    return ret;
+}
+
+gboolean chunk_catalog_record_for_file(const gchar *chunk_path, gint64 first_utc_us, gint64 last_utc_us,
+    ChunkCatalogRecord *record) {
+    struct stat st;
+    gchar *name = g_path_get_basename(chunk_path);
+    gboolean ret = strlen(name) < sizeof(record->name);
+
+    memset(record, 0, sizeof(*record));
+    if (ret) {
+        record->first_utc_us = first_utc_us;
+        record->last_utc_us = last_utc_us;
+        record->file_size = stat(chunk_path, &st) == 0 ? st.st_size : 0;
+        g_strlcpy(record->name, name, sizeof(record->name));
+    } else {
+        LOG(ERROR) << "[Chunk Index] - Chunk name too long for the catalog: " << name;
+    }
+    g_free(name);
+    return ret;
+}
+
+/* Open and lock the catalog of folder. A catalog replaced by
+ * chunk_catalog_drop() while waiting for the lock is reopened. */
+static int
+catalog_open_locked(const gchar *folder, int flags)
+{
+    gchar *catalog_path = g_build_filename(folder, CHUNK_CATALOG_NAME, NULL);
+    int fd = -1;
+    for (;;) {
+        struct stat st;
+        fd = open(catalog_path, flags | O_CLOEXEC, 0644);
+        if (fd < 0)
+            break;
+        if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+            close(fd);
+            fd = -1;
+            break;
+        }
+        if (st.st_nlink > 0)
+            break;
+        close(fd);
+    }
+    if (fd < 0 && errno != ENOENT)
+        LOG(ERROR) << "[Chunk Index] - Unable to open " << catalog_path << ": " << strerror(errno);
+    g_free(catalog_path);
+    return fd;
+}
+
+gboolean chunk_catalog_append(const gchar *folder, const ChunkCatalogRecord *record) {
+    /* Catalog records are fixed size and appended in recording order */
+    int fd = catalog_open_locked(folder, O_WRONLY | O_APPEND | O_CREAT);
+    if (fd < 0)
+        return FALSE;
+    gboolean ret = write(fd, record, sizeof(*record)) == (ssize_t) sizeof(*record);
+    if (!ret)
+        LOG(ERROR) << "[Chunk Index] - Failed to append to the catalog of " << folder << ": " << strerror(errno);
+    close(fd);
+    return ret;
+}
+
+static gboolean
+catalog_read(int fd, std::vector<ChunkCatalogRecord> *records)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return FALSE;
+    records->resize(st.st_size / sizeof(ChunkCatalogRecord));
+    gsize length = records->size() * sizeof(ChunkCatalogRecord);
+    return pread(fd, records->data(), length, 0) == (ssize_t) length;
+}
+
+gboolean chunk_catalog_load(const gchar *folder, std::vector<ChunkCatalogRecord> *records) {
+    int fd = catalog_open_locked(folder, O_RDONLY);
+    if (fd < 0)
+        return FALSE;
+    gboolean ret = catalog_read(fd, records);
+    close(fd);
+    return ret;
+}
+
+gboolean chunk_catalog_drop(const gchar *folder, const std::vector<std::string> &names) {
+    std::vector<ChunkCatalogRecord> records;
+    int fd = catalog_open_locked(folder, O_RDONLY);
+    if (fd < 0)
+        return FALSE;
+
+    gboolean ret = catalog_read(fd, &records);
+    if (ret) {
+        std::unordered_set<std::string> dropped(names.begin(), names.end());
+        auto kept_end = std::remove_if(records.begin(), records.end(),
+            [&dropped](const ChunkCatalogRecord &r) {
+                return dropped.count(std::string(r.name, strnlen(r.name, sizeof(r.name)))) > 0;
+            });
+        gchar *catalog_path = g_build_filename(folder, CHUNK_CATALOG_NAME, NULL);
+        GError *error = NULL;
+        /* Atomic replace; appenders blocked on the old file reopen the new one */
+        ret = g_file_set_contents(catalog_path, (const gchar *) records.data(),
+            (kept_end - records.begin()) * sizeof(ChunkCatalogRecord), &error);
+        if (!ret) {
+            LOG(ERROR) << "[Chunk Index] - Failed to rewrite " << catalog_path << ": " << error->message;
+            g_error_free(error);
+        }
+        g_free(catalog_path);
+    }
+    close(fd);
+    return ret;
+}
+
+gboolean chunk_index_load(const gchar *index_path, ChunkIndexHeader *header,
+    std::vector<ChunkIndexEntry> *entries) {
+    gchar *data = NULL;
+    gsize length = 0;
+
+    if (!g_file_get_contents(index_path, &data, &length, NULL))
+        return FALSE;
+
+    gboolean ret = FALSE;
+    if (length >= sizeof(ChunkIndexHeader)) {
+        memcpy(header, data, sizeof(ChunkIndexHeader));
+        if (header->magic == CHUNK_INDEX_MAGIC && header->version == CHUNK_INDEX_VERSION &&
+            length == sizeof(ChunkIndexHeader) + header->count * sizeof(ChunkIndexEntry)) {
+            const ChunkIndexEntry *first = (const ChunkIndexEntry *) (data + sizeof(ChunkIndexHeader));
+            entries->assign(first, first + header->count);
+            ret = TRUE;
+        }
+    }
+    if (!ret)
+        LOG(ERROR) << "[Chunk Index] - Corrupt index " << index_path;
+    g_free(data);
+    return ret;
+}
+
+gboolean chunk_index_lookup(const gchar *camera_folder, gint64 from_utc_us, gint64 to_utc_us,
+    std::vector<ChunkByteRange> *ranges) {
+    std::vector<ChunkCatalogRecord> catalog;
+    if (!chunk_catalog_load(camera_folder, &catalog))
+        return FALSE;
+
+    const ChunkCatalogRecord *records = catalog.data();
+    const ChunkCatalogRecord *records_end = records + catalog.size();
+
+    /* First chunk that ends at or after the window start */
+    const ChunkCatalogRecord *record = std::lower_bound(records, records_end, from_utc_us,
+        [](const ChunkCatalogRecord &r, gint64 utc_us) { return r.last_utc_us < utc_us; });
+
+    for (; record != records_end && record->first_utc_us <= to_utc_us; record++) {
+        ChunkIndexHeader header;
+        std::vector<ChunkIndexEntry> entries;
+        gchar *chunk_path = g_build_filename(camera_folder, record->name, NULL);
+        gchar *index_path = g_strconcat(chunk_path, CHUNK_INDEX_SUFFIX, NULL);
+        gboolean ok = chunk_index_load(index_path, &header, &entries) && !entries.empty();
+        g_free(index_path);
+        if (!ok) {
+            g_free(chunk_path);
+            continue;
+        }
+
+        /* Last keyframe at or before the start, first keyframe after the end */
+        auto after_start = std::upper_bound(entries.begin(), entries.end(), from_utc_us,
+            [](gint64 utc_us, const ChunkIndexEntry &e) { return utc_us < e.utc_us; });
+        auto after_end = std::upper_bound(entries.begin(), entries.end(), to_utc_us,
+            [](gint64 utc_us, const ChunkIndexEntry &e) { return utc_us < e.utc_us; });
+        const ChunkIndexEntry &start = after_start == entries.begin() ? entries.front() : *(after_start - 1);
+
+        ChunkByteRange range;
+        range.path = chunk_path;
+        range.start = start.offset;
+        range.end = after_end == entries.end() ? header.file_size : after_end->offset;
+        range.start_utc_us = start.utc_us;
+        ranges->push_back(range);
+        g_free(chunk_path);
+    }
+    return TRUE;
+}
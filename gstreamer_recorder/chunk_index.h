@@ -0,0 +1,95 @@
+#ifndef CHUNK_INDEX_H
+#define CHUNK_INDEX_H
+
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/* Every closed chunk gets a binary sidecar <chunk>.idx listing its keyframes,
+ * and one fixed size record appended to <camera folder>/chunks.catalog.
+ * Lookups read the catalog and the matching sidecars only, never the chunks. */
+#define CHUNK_INDEX_MAGIC 0x58444943   // "CIDX"
+#define CHUNK_INDEX_VERSION 1
+#define CHUNK_INDEX_SUFFIX ".idx"
+#define CHUNK_CATALOG_NAME "chunks.catalog"
+#define CHUNK_NAME_MAX 128
+
+struct ChunkIndexHeader {
+    guint32 magic;
+    guint32 version;
+    guint32 count;              // keyframe entries following the header
+    guint32 reserved;
+    gint64 first_utc_us;
+    gint64 last_utc_us;
+    guint64 file_size;
+};
+
+struct ChunkIndexEntry {
+    guint64 pts;                // ns, as seen by the muxer
+    guint64 offset;             // byte offset of the keyframe sample in the chunk
+    gint64 utc_us;
+};
+
+struct ChunkCatalogRecord {
+    gint64 first_utc_us;
+    gint64 last_utc_us;
+    guint64 file_size;
+    char name[CHUNK_NAME_MAX];  // chunk file name relative to the camera folder
+};
+
+/* Byte range of one chunk covering (part of) a requested time window */
+struct ChunkByteRange {
+    std::string path;
+    guint64 start;              // offset of the keyframe at or before the window start
+    guint64 end;                // offset of the first keyframe after the window, or file size
+    gint64 start_utc_us;
+};
+
+/* Collects keyframes of the chunk being written. Used from the sink's
+ * streaming thread only. */
+class ChunkIndexWriter {
+public:
+    /* Start a new chunk; UTC of later buffers is derived from their PTS */
+    void begin();
+    /* Camera PTS anchor: the wall clock anchor_pts was captured at. Chunk
+     * names use the same anchor, so index and file name times agree. Kept
+     * across chunks; without one the first buffer of the chunk is the anchor. */
+    void set_anchor(gint64 anchor_utc_us, guint64 anchor_pts);
+    /* Every muxed buffer extends the chunk end time, keyframes are indexed */
+    void add_buffer(guint64 pts, guint64 offset, gboolean keyframe);
+    /* Write the sidecar for chunk_path and append it to the camera catalog.
+     * record receives what was appended. */
+    gboolean finish(const gchar *chunk_path, guint64 file_size, ChunkCatalogRecord *record);
+
+private:
+    std::vector<ChunkIndexEntry> entries;
+    gint64 anchor_utc_us = 0;
+    guint64 anchor_pts = 0;
+    gint64 first_utc_us = 0;
+    gint64 last_utc_us = 0;
+
+    gint64 utc_of(guint64 pts) const;
+};
+
+/* Catalog access, serialised with flock() so the recorder, the inference
+ * pipeline and the retention thread can share a folder */
+gboolean chunk_catalog_append(const gchar *folder, const ChunkCatalogRecord *record);
+gboolean chunk_catalog_load(const gchar *folder, std::vector<ChunkCatalogRecord> *records);
+/* Drop the records of the named chunks after they were deleted. Matching by
+ * name keeps the catalog right whatever order its records were appended in. */
+gboolean chunk_catalog_drop(const gchar *folder, const std::vector<std::string> &names);
+
+/* Fill a catalog record for a chunk that is already on disk */
+gboolean chunk_catalog_record_for_file(const gchar *chunk_path, gint64 first_utc_us, gint64 last_utc_us,
+    ChunkCatalogRecord *record);
+
+/* Read a sidecar written by ChunkIndexWriter */
+gboolean chunk_index_load(const gchar *index_path, ChunkIndexHeader *header,
+    std::vector<ChunkIndexEntry> *entries);
+
+/* Byte ranges of the chunks in camera_folder covering [from_utc_us, to_utc_us],
+ * in recording order */
+gboolean chunk_index_lookup(const gchar *camera_folder, gint64 from_utc_us, gint64 to_utc_us,
+    std::vector<ChunkByteRange> *ranges);
+
+#endif // CHUNK_INDEX_H
@@ -0,0 +1,207 @@
+#include "chunk_name.h"
+#include <string.h>
+#include <time.h>
+#include <mutex>
+#include <vector>
+
+#define CHUNK_TZ_PROBE_STEP_SEC (24 * 3600)
+
+/* Local time rules between two transitions, [start, end) in UTC seconds */
+struct TzSpan {
+    gint64 start;
+    gint64 end;
+    glong offset;
+    gchar zone[CHUNK_ZONE_MAX];
+};
+
+static std::mutex tz_lock;
+static std::vector<TzSpan> tz_spans;        // most recently added last
+static std::once_flag tz_init;
+
+static void
+tz_probe(gint64 utc_sec, glong *offset, gchar *zone, gsize zone_size)
+{
+    time_t t = (time_t) utc_sec;
+    struct tm local;
+    localtime_r(&t, &local);
+    *offset = local.tm_gmtoff;
+    g_strlcpy(zone, local.tm_zone ? local.tm_zone : "UTC", zone_size);
+}
+
+static gboolean
+tz_same(gint64 utc_sec, const TzSpan &span)
+{
+    glong offset;
+    gchar zone[CHUNK_ZONE_MAX];
+    tz_probe(utc_sec, &offset, zone, sizeof(zone));
+    return offset == span.offset && strcmp(zone, span.zone) == 0;
+}
+
+/* Walk away from utc_sec a day at a time until the rules change, then bisect
+ * down to the second. Returns the span boundary in direction, or the horizon. */
+static gint64
+tz_find_transition(gint64 utc_sec, const TzSpan &span, gint64 direction)
+{
+    gint64 same = utc_sec;
+    gint64 other = utc_sec;
+    gint64 limit = utc_sec + direction * CHUNK_TZ_HORIZON_SEC;
+
+    for (;;) {
+        other = same + direction * CHUNK_TZ_PROBE_STEP_SEC;
+        /* No transition within the horizon, the span ends at the last probe */
+        if (direction > 0 ? other >= limit : other <= limit)
+            return direction > 0 ? same + 1 : same;
+        if (!tz_same(other, span))
+            break;
+        same = other;
+    }
+    while (ABS(other - same) > 1) {
+        gint64 middle = same + (other - same) / 2;
+        if (tz_same(middle, span))
+            same = middle;
+        else
+            other = middle;
+    }
+    /* end is exclusive, start inclusive */
+    return direction > 0 ? other : same;
+}
+
+void chunk_tz_lookup(gint64 utc_sec, glong *offset_sec, gchar *zone, gsize zone_size) {
+    std::call_once(tz_init, tzset);
+
+    std::lock_guard<std::mutex> guard(tz_lock);
+    for (const TzSpan &span : tz_spans) {
+        if (utc_sec >= span.start && utc_sec < span.end) {
+            *offset_sec = span.offset;
+            g_strlcpy(zone, span.zone, zone_size);
+            return;
+        }
+    }
+
+    TzSpan span;
+    tz_probe(utc_sec, &span.offset, span.zone, sizeof(span.zone));
+    span.start = tz_find_transition(utc_sec, span, -1);
+    span.end = tz_find_transition(utc_sec, span, 1);
+    if (tz_spans.size() >= CHUNK_TZ_SPANS_MAX)
+        tz_spans.erase(tz_spans.begin());
+    tz_spans.push_back(span);
+
+    *offset_sec = span.offset;
+    g_strlcpy(zone, span.zone, zone_size);
+}
+
+gboolean chunk_name_format(gchar *buf, gsize size, const gchar *stem, gint64 utc_us, const gchar *ext) {
+    gint64 utc_sec = utc_us / G_USEC_PER_SEC;
+    if (utc_us % G_USEC_PER_SEC < 0)
+        utc_sec--;
+
+    glong offset;
+    gchar zone[CHUNK_ZONE_MAX];
+    chunk_tz_lookup(utc_sec, &offset, zone, sizeof(zone));
+
+    time_t local_sec = (time_t) (utc_sec + offset);
+    struct tm local;
+    gmtime_r(&local_sec, &local);
+
+    gint length = g_snprintf(buf, size, "%s_%04d%02d%02d-%02d%02d%02d_%s.%s", stem,
+        local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+        local.tm_hour, local.tm_min, local.tm_sec, zone, ext);
+    return length > 0 && (gsize) length < size;
+}
+
+static gboolean
+parse_digits(const gchar *s, gint count, gint *value)
+{
+    *value = 0;
+    for (gint i = 0; i < count; i++) {
+        if (!g_ascii_isdigit(s[i]))
+            return FALSE;
+        *value = *value * 10 + (s[i] - '0');
+    }
+    return TRUE;
+}
+
+static gboolean
+is_zone_char(gchar c)
+{
+    return g_ascii_isalnum(c) || c == '+' || c == '-';
+}
+
+gboolean chunk_name_parse(const gchar *name, ChunkName *parsed) {
+    /* _YYYYMMDD-HHMMSS */
+    const gsize time_length = 16;
+    const gchar *dot = strrchr(name, '.');
+    if (!dot || !dot[1] || strlen(dot + 1) >= sizeof(parsed->ext))
+        return FALSE;
+    for (const gchar *c = dot + 1; *c; c++) {
+        if (!g_ascii_isalnum(*c))
+            return FALSE;
+    }
+
+    /* Zone runs back from the extension to the previous underscore */
+    const gchar *zone = dot;
+    while (zone > name && is_zone_char(zone[-1]))
+        zone--;
+    gsize zone_length = dot - zone;
+    if (zone == name || zone[-1] != '_' || !zone_length || zone_length >= sizeof(parsed->zone))
+        return FALSE;
+
+    const gchar *stamp = zone - 1 - time_length;
+    gsize stem_length = stamp - name;
+    if (stamp <= name || stamp[0] != '_' || stamp[9] != '-' || stem_length >= sizeof(parsed->stem))
+        return FALSE;
+    if (!parse_digits(stamp + 1, 4, &parsed->year) || !parse_digits(stamp + 5, 2, &parsed->month) ||
+        !parse_digits(stamp + 7, 2, &parsed->day) || !parse_digits(stamp + 10, 2, &parsed->hour) ||
+        !parse_digits(stamp + 12, 2, &parsed->minute) || !parse_digits(stamp + 14, 2, &parsed->second))
+        return FALSE;
+
+    /* Reject dates that do not exist instead of letting timegm() normalise them */
+    time_t t = (time_t) chunk_name_time(parsed);
+    struct tm check;
+    if (!gmtime_r(&t, &check) || check.tm_year + 1900 != parsed->year || check.tm_mon + 1 != parsed->month ||
+        check.tm_mday != parsed->day || check.tm_hour != parsed->hour ||
+        check.tm_min != parsed->minute || check.tm_sec != parsed->second)
+        return FALSE;
+
+    memcpy(parsed->stem, name, stem_length);
+    parsed->stem[stem_length] = '\0';
+    memcpy(parsed->zone, zone, zone_length);
+    parsed->zone[zone_length] = '\0';
+    g_strlcpy(parsed->ext, dot + 1, sizeof(parsed->ext));
+    return TRUE;
+}
+
+gint64 chunk_name_time(const ChunkName *parsed) {
+    struct tm fields;
+    memset(&fields, 0, sizeof(fields));
+    fields.tm_year = parsed->year - 1900;
+    fields.tm_mon = parsed->month - 1;
+    fields.tm_mday = parsed->day;
+    fields.tm_hour = parsed->hour;
+    fields.tm_min = parsed->minute;
+    fields.tm_sec = parsed->second;
+    return timegm(&fields);
+}
+
+gboolean chunk_name_to_utc(const ChunkName *parsed, gint64 *utc_us) {
+    /* UTC offsets stay within +-14 h, so the rules on either side of the
+     * local time cover every offset the name could have been formatted with */
+    const gint64 max_offset = 14 * 3600;
+    gint64 local_sec = chunk_name_time(parsed);
+    gint64 probes[] = { local_sec, local_sec - max_offset, local_sec + max_offset };
+
+    for (gint64 probe : probes) {
+        glong offset, actual_offset;
+        gchar zone[CHUNK_ZONE_MAX], actual_zone[CHUNK_ZONE_MAX];
+        chunk_tz_lookup(probe, &offset, zone, sizeof(zone));
+        if (strcmp(zone, parsed->zone) != 0)
+            continue;
+        gint64 utc_sec = local_sec - offset;
+        chunk_tz_lookup(utc_sec, &actual_offset, actual_zone, sizeof(actual_zone));
+        if (actual_offset == offset && strcmp(actual_zone, parsed->zone) == 0) {
+            *utc_us = utc_sec * G_USEC_PER_SEC;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
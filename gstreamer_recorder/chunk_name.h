@@ -0,0 +1,47 @@
+#ifndef CHUNK_NAME_H
+#define CHUNK_NAME_H
+
+#include <glib.h>
+#include "chunk_index.h"
+
+/* Chunk files are named <stem>_<YYYYMMDD-HHMMSS>_<zone>.<ext> after the local
+ * time of their first frame, e.g. stream_00003_20240331-021500_CEST.mp4.
+ * Names are formatted once from a UTC time and never renamed afterwards. */
+#define CHUNK_ZONE_MAX 16
+#define CHUNK_EXT_MAX 16
+/* UTC offsets are cached per span between DST transitions. Transitions are
+ * searched this far around a lookup, zones without DST re-check this often. */
+#define CHUNK_TZ_HORIZON_SEC (400 * 24 * 3600)
+/* Cached spans, enough for the current and neighbouring DST periods */
+#define CHUNK_TZ_SPANS_MAX 8
+
+struct ChunkName {
+    gchar stem[CHUNK_NAME_MAX];
+    gint year;
+    gint month;                 // 1-12
+    gint day;
+    gint hour;
+    gint minute;
+    gint second;
+    gchar zone[CHUNK_ZONE_MAX];
+    gchar ext[CHUNK_EXT_MAX];
+};
+
+/* UTC offset and zone abbreviation in effect at utc_sec for the process time
+ * zone. Thread safe; libc is only consulted when utc_sec leaves the cached spans. */
+void chunk_tz_lookup(gint64 utc_sec, glong *offset_sec, gchar *zone, gsize zone_size);
+
+/* Write the name of a chunk starting at utc_us into buf. FALSE if it does not fit. */
+gboolean chunk_name_format(gchar *buf, gsize size, const gchar *stem, gint64 utc_us, const gchar *ext);
+
+/* Split a chunk name into its fields. FALSE if name is not in the format above. */
+gboolean chunk_name_parse(const gchar *name, ChunkName *parsed);
+
+/* Seconds since the epoch of the name's date and time read as UTC */
+gint64 chunk_name_time(const ChunkName *parsed);
+
+/* UTC time a parsed name was formatted from, using its zone to resolve the
+ * hour repeated when DST ends. FALSE if the zone never applies at that time. */
+gboolean chunk_name_to_utc(const ChunkName *parsed, gint64 *utc_us);
+
+#endif // CHUNK_NAME_H
@@ -0,0 +1,472 @@
+#include "chunk_sink.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glog/logging.h>
+
+/* A closed (or open) chunk known to the sync thread. The sync thread owns the
+ * file descriptors once the sink has closed the chunk. */
+struct ChunkSyncFile {
+  int fd;
+  int fd_buffered;
+  std::atomic<bool> dirty;
+  bool closing;                   // guarded by sync_lock
+};
+
+static std::mutex sync_lock;
+static std::condition_variable sync_cond;
+static std::vector<ChunkSyncFile *> sync_files;
+static std::thread sync_thread;
+static bool sync_running = false;
+
+static void
+sync_file_close (ChunkSyncFile * file)
+{
+  if (file->fd_buffered != file->fd)
+    close (file->fd_buffered);
+  close (file->fd);
+  delete file;
+}
+
+/* One fdatasync per dirty chunk every CHUNK_SINK_SYNC_INTERVAL_MS, so the
+ * streaming threads never block on writeback */
+static void
+sync_loop ()
+{
+  std::unique_lock<std::mutex> lock (sync_lock);
+  while (sync_running) {
+    sync_cond.wait_for (lock, std::chrono::milliseconds (CHUNK_SINK_SYNC_INTERVAL_MS));
+
+    std::vector<ChunkSyncFile *> batch = sync_files;
+    lock.unlock ();
+    for (ChunkSyncFile *file : batch) {
+      if (file->dirty.exchange (false) && fdatasync (file->fd_buffered) != 0)
+        LOG(ERROR) << "[Chunk Sink] - fdatasync failed: " << strerror (errno);
+    }
+    lock.lock ();
+
+    /* Closed chunks are released once their last writes are synced */
+    for (auto it = sync_files.begin (); it != sync_files.end ();) {
+      if ((*it)->closing && !(*it)->dirty.load ()) {
+        sync_file_close (*it);
+        it = sync_files.erase (it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+static ChunkSyncFile *
+sync_file_add (int fd, int fd_buffered)
+{
+  ChunkSyncFile *file = new ChunkSyncFile ();
+  file->fd = fd;
+  file->fd_buffered = fd_buffered;
+  file->dirty.store (false);
+  file->closing = false;
+
+  std::lock_guard<std::mutex> lock (sync_lock);
+  if (!sync_running) {
+    sync_running = true;
+    sync_thread = std::thread (sync_loop);
+  }
+  sync_files.push_back (file);
+  return file;
+}
+
+static void
+sync_file_release (ChunkSyncFile * file)
+{
+  std::lock_guard<std::mutex> lock (sync_lock);
+  file->dirty.store (true);
+  file->closing = true;
+}
+
+void
+chunk_sink_shutdown ()
+{
+  {
+    std::lock_guard<std::mutex> lock (sync_lock);
+    if (!sync_running)
+      return;
+    sync_running = false;
+  }
+  sync_cond.notify_all ();
+  sync_thread.join ();
+
+  for (ChunkSyncFile *file : sync_files) {
+    fdatasync (file->fd_buffered);
+    if (file->closing)
+      sync_file_close (file);
+  }
+  sync_files.clear ();
+}
+
+/* Element */
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_PREALLOCATE,
+  PROP_BUFFER_SIZE,
+  PROP_DIRECT
+};
+
+static GstStaticPadTemplate gst_chunk_sink_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define gst_chunk_sink_parent_class parent_class
+G_DEFINE_TYPE (GstChunkSink, gst_chunk_sink, GST_TYPE_BASE_SINK);
+
+static void gst_chunk_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_chunk_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static void gst_chunk_sink_finalize (GObject * object);
+
+static gboolean gst_chunk_sink_start (GstBaseSink * bsink);
+static gboolean gst_chunk_sink_stop (GstBaseSink * bsink);
+static gboolean gst_chunk_sink_event (GstBaseSink * bsink, GstEvent * event);
+static gboolean gst_chunk_sink_query (GstBaseSink * bsink, GstQuery * query);
+static GstFlowReturn gst_chunk_sink_render (GstBaseSink * bsink, GstBuffer * buffer);
+
+static void
+gst_chunk_sink_class_init (GstChunkSinkClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = (GstElementClass *) klass;
+  GstBaseSinkClass *gstbasesink_class = (GstBaseSinkClass *) klass;
+
+  gobject_class->set_property = GST_DEBUG_FUNCPTR (gst_chunk_sink_set_property);
+  gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_chunk_sink_get_property);
+  gobject_class->finalize = GST_DEBUG_FUNCPTR (gst_chunk_sink_finalize);
+
+  gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_chunk_sink_start);
+  gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_chunk_sink_stop);
+  gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_chunk_sink_event);
+  gstbasesink_class->query = GST_DEBUG_FUNCPTR (gst_chunk_sink_query);
+  gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_chunk_sink_render);
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location",
+          "File Location",
+          "Location of the chunk file to write",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PREALLOCATE,
+      g_param_spec_uint64 ("preallocate",
+          "Preallocate",
+          "Bytes reserved with fallocate when a chunk is opened, 0 to disable",
+          0, G_MAXUINT64, 0, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BUFFER_SIZE,
+      g_param_spec_uint ("buffer-size",
+          "Buffer Size",
+          "Bytes coalesced before each write, rounded up to the alignment",
+          CHUNK_SINK_ALIGN, G_MAXINT, DEFAULT_CHUNK_SINK_BUFFER_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DIRECT,
+      g_param_spec_boolean ("direct",
+          "Direct I/O",
+          "Write full buffers with O_DIRECT, bypassing the page cache",
+          FALSE, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&gst_chunk_sink_sink_template));
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Chunk sink",
+      "Sink/File",
+      "Write recording chunks with preallocation, aligned writes and batched fdatasync",
+      "Recorder");
+}
+
+static void
+gst_chunk_sink_init (GstChunkSink * sink)
+{
+  sink->location = NULL;
+  sink->preallocate = 0;
+  sink->buffer_size = DEFAULT_CHUNK_SINK_BUFFER_SIZE;
+  sink->direct = FALSE;
+  sink->fd = -1;
+  sink->fd_buffered = -1;
+  sink->sync_file = NULL;
+  sink->buffer = NULL;
+
+  gst_base_sink_set_sync (GST_BASE_SINK (sink), FALSE);
+}
+
+static void
+gst_chunk_sink_finalize (GObject * object)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (object);
+  g_free (sink->location);
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_chunk_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (object);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_free (sink->location);
+      sink->location = g_value_dup_string (value);
+      break;
+    case PROP_PREALLOCATE:
+      sink->preallocate = g_value_get_uint64 (value);
+      break;
+    case PROP_BUFFER_SIZE:
+      sink->buffer_size = GST_ROUND_UP_N (g_value_get_uint (value), CHUNK_SINK_ALIGN);
+      break;
+    case PROP_DIRECT:
+      sink->direct = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_chunk_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (object);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, sink->location);
+      break;
+    case PROP_PREALLOCATE:
+      g_value_set_uint64 (value, sink->preallocate);
+      break;
+    case PROP_BUFFER_SIZE:
+      g_value_set_uint (value, sink->buffer_size);
+      break;
+    case PROP_DIRECT:
+      g_value_set_boolean (value, sink->direct);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* pwrite the whole range, keeping per chunk latency statistics */
+static gboolean
+write_at (GstChunkSink * sink, int fd, const guint8 * data, gsize size, guint64 offset)
+{
+  gint64 start_us = g_get_monotonic_time ();
+  while (size > 0) {
+    ssize_t written = pwrite (fd, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+          ("Error while writing to file \"%s\".", sink->location), GST_ERROR_SYSTEM);
+      return FALSE;
+    }
+    data += written;
+    offset += written;
+    size -= written;
+  }
+  sink->write_calls++;
+  sink->max_write_us = MAX (sink->max_write_us, g_get_monotonic_time () - start_us);
+  sink->sync_file->dirty.store (true, std::memory_order_relaxed);
+  return TRUE;
+}
+
+/* Write out a partially filled buffer. Its end is unaligned, so it goes
+ * through the buffered descriptor and ends sequential mode. */
+static gboolean
+flush_partial (GstChunkSink * sink)
+{
+  gboolean ret = TRUE;
+  if (sink->buffer_fill)
+    ret = write_at (sink, sink->fd_buffered, sink->buffer, sink->buffer_fill, sink->buffer_offset);
+  sink->buffer_offset += sink->buffer_fill;
+  sink->buffer_fill = 0;
+  sink->sequential = FALSE;
+  return ret;
+}
+
+static gboolean
+gst_chunk_sink_start (GstBaseSink * bsink)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (bsink);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+  if (!sink->location) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, NOT_FOUND, ("No file name specified for writing."), (NULL));
+    return FALSE;
+  }
+
+  sink->fd = open (sink->location, sink->direct ? flags | O_DIRECT : flags, 0644);
+  if (sink->fd < 0 && sink->direct && errno == EINVAL) {
+    /* File system without O_DIRECT support */
+    LOG(WARNING) << "[Chunk Sink] - O_DIRECT not supported for " << sink->location;
+    sink->fd = open (sink->location, flags, 0644);
+  }
+  if (sink->fd < 0) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        ("Could not open file \"%s\" for writing.", sink->location), GST_ERROR_SYSTEM);
+    return FALSE;
+  }
+  sink->fd_buffered = sink->direct ? open (sink->location, O_WRONLY | O_CLOEXEC) : sink->fd;
+  if (sink->fd_buffered < 0) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        ("Could not open file \"%s\" for writing.", sink->location), GST_ERROR_SYSTEM);
+    close (sink->fd);
+    sink->fd = -1;
+    return FALSE;
+  }
+
+  /* Reserve the whole chunk up front so concurrent cameras do not interleave
+   * extents. KEEP_SIZE leaves the visible file size alone. */
+  if (sink->preallocate && fallocate (sink->fd, FALLOC_FL_KEEP_SIZE, 0, sink->preallocate) != 0)
+    VLOG(1) << "[Chunk Sink] - fallocate failed for " << sink->location << ": " << strerror (errno);
+
+  if (posix_memalign ((void **) &sink->buffer, CHUNK_SINK_ALIGN, sink->buffer_size) != 0) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, NO_SPACE_LEFT, ("Could not allocate write buffer."), (NULL));
+    close (sink->fd);
+    if (sink->fd_buffered != sink->fd)
+      close (sink->fd_buffered);
+    sink->fd = sink->fd_buffered = -1;
+    return FALSE;
+  }
+
+  sink->buffer_fill = 0;
+  sink->buffer_offset = 0;
+  sink->position = 0;
+  sink->size = 0;
+  sink->sequential = TRUE;
+  sink->write_calls = 0;
+  sink->max_write_us = 0;
+  sink->sync_file = sync_file_add (sink->fd, sink->fd_buffered);
+  return TRUE;
+}
+
+static gboolean
+gst_chunk_sink_stop (GstBaseSink * bsink)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (bsink);
+  if (sink->fd < 0)
+    return TRUE;
+
+  if (sink->sequential)
+    flush_partial (sink);
+  /* Give back the preallocated blocks past the real end of the chunk */
+  if (sink->preallocate && ftruncate (sink->fd_buffered, sink->size) != 0)
+    LOG(ERROR) << "[Chunk Sink] - ftruncate failed for " << sink->location << ": " << strerror (errno);
+
+  VLOG(1) << "[Chunk Sink] - Closed " << sink->location << " bytes=" << sink->size
+      << " writes=" << sink->write_calls << " max_write_us=" << sink->max_write_us;
+
+  /* The sync thread syncs and closes the descriptors */
+  sync_file_release (sink->sync_file);
+  sink->sync_file = NULL;
+  sink->fd = sink->fd_buffered = -1;
+  free (sink->buffer);
+  sink->buffer = NULL;
+  return TRUE;
+}
+
+static gboolean
+gst_chunk_sink_event (GstBaseSink * bsink, GstEvent * event)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (bsink);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT && sink->fd >= 0) {
+    const GstSegment *segment;
+    gst_event_parse_segment (event, &segment);
+    /* The muxer seeks back to patch its header once the chunk is done */
+    if (segment->format == GST_FORMAT_BYTES && segment->start != sink->position) {
+      if (sink->sequential && !flush_partial (sink)) {
+        gst_event_unref (event);
+        return FALSE;
+      }
+      sink->position = segment->start;
+    }
+  }
+  return GST_BASE_SINK_CLASS (parent_class)->event (bsink, event);
+}
+
+static gboolean
+gst_chunk_sink_query (GstBaseSink * bsink, GstQuery * query)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (bsink);
+  GstFormat format;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_SEEKING:
+      gst_query_parse_seeking (query, &format, NULL, NULL, NULL);
+      gst_query_set_seeking (query, format, format == GST_FORMAT_BYTES, 0, -1);
+      return TRUE;
+    case GST_QUERY_POSITION:
+      gst_query_parse_position (query, &format, NULL);
+      if (format != GST_FORMAT_BYTES && format != GST_FORMAT_DEFAULT)
+        break;
+      gst_query_set_position (query, GST_FORMAT_BYTES, sink->position);
+      return TRUE;
+    default:
+      break;
+  }
+  return GST_BASE_SINK_CLASS (parent_class)->query (bsink, query);
+}
+
+static GstFlowReturn
+gst_chunk_sink_render (GstBaseSink * bsink, GstBuffer * buffer)
+{
+  GstChunkSink *sink = GST_CHUNK_SINK (bsink);
+  GstMapInfo map;
+  gboolean ret = TRUE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+
+  if (sink->sequential) {
+    /* Coalesce into the aligned buffer, write it out whenever it is full */
+    const guint8 *data = map.data;
+    gsize remaining = map.size;
+    while (ret && remaining > 0) {
+      gsize copy = MIN (remaining, (gsize) (sink->buffer_size - sink->buffer_fill));
+      memcpy (sink->buffer + sink->buffer_fill, data, copy);
+      sink->buffer_fill += copy;
+      data += copy;
+      remaining -= copy;
+      if (sink->buffer_fill == sink->buffer_size) {
+        ret = write_at (sink, sink->fd, sink->buffer, sink->buffer_size, sink->buffer_offset);
+        sink->buffer_offset += sink->buffer_size;
+        sink->buffer_fill = 0;
+      }
+    }
+  } else {
+    ret = write_at (sink, sink->fd_buffered, map.data, map.size, sink->position);
+  }
+
+  sink->position += map.size;
+  sink->size = MAX (sink->size, sink->position);
+  gst_buffer_unmap (buffer, &map);
+  return ret ? GST_FLOW_OK : GST_FLOW_ERROR;
+}
+
+gboolean
+chunk_sink_register ()
+{
+  return gst_element_register (NULL, "chunksink", GST_RANK_NONE, GST_TYPE_CHUNK_SINK);
+}
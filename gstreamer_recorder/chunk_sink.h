@@ -0,0 +1,67 @@
+#ifndef __GST_CHUNK_SINK_H__
+#define __GST_CHUNK_SINK_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+/* File sink for recording chunks, used as splitmuxsink's "sink".
+ * - reserves the expected chunk size with fallocate() when a chunk opens
+ * - coalesces muxer output into large aligned buffers (optionally O_DIRECT)
+ * - leaves fdatasync to one background thread shared by every camera, which
+ *   syncs all dirty chunks in a batch instead of each sink stalling on its own
+ */
+#define CHUNK_SINK_ALIGN 4096
+#define DEFAULT_CHUNK_SINK_BUFFER_SIZE (1 << 20)   // bytes
+#define CHUNK_SINK_SYNC_INTERVAL_MS 1000
+
+G_BEGIN_DECLS
+
+typedef struct _GstChunkSink GstChunkSink;
+typedef struct _GstChunkSinkClass GstChunkSinkClass;
+struct ChunkSyncFile;
+
+#define GST_TYPE_CHUNK_SINK (gst_chunk_sink_get_type())
+#define GST_CHUNK_SINK(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_CHUNK_SINK,GstChunkSink))
+
+struct _GstChunkSink
+{
+  GstBaseSink parent;
+
+  /* Properties */
+  gchar *location;
+  guint64 preallocate;            // bytes reserved when the chunk is opened
+  guint buffer_size;              // rounded up to CHUNK_SINK_ALIGN
+  gboolean direct;                // write full buffers with O_DIRECT
+
+  /* Open chunk */
+  int fd;                         // sequential writes, O_DIRECT when direct
+  int fd_buffered;                // tail and header rewrites, same as fd unless direct
+  ChunkSyncFile *sync_file;
+  guint8 *buffer;
+  guint buffer_fill;
+  guint64 buffer_offset;          // file offset of buffer[0], always aligned
+  guint64 position;               // file offset of the next byte from the muxer
+  guint64 size;                   // bytes written so far
+  gboolean sequential;            // FALSE once the muxer seeked back
+
+  /* Write statistics of the open chunk */
+  guint64 write_calls;
+  gint64 max_write_us;
+};
+
+struct _GstChunkSinkClass
+{
+  GstBaseSinkClass parent_class;
+};
+
+GType gst_chunk_sink_get_type (void);
+
+G_END_DECLS
+
+/* Register "chunksink" for this process */
+gboolean chunk_sink_register ();
+
+/* Sync and close every chunk still handed to the sync thread, stop the thread */
+void chunk_sink_shutdown ();
+
+#endif /* __GST_CHUNK_SINK_H__ */
@@ -1,31 +1,62 @@
 #include <gst/gst.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <thread>
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <cstring>
 #include <iomanip>
-#include <unistd.h> 
+#include <unistd.h>
 #include <limits>
 #include <stdexcept>
+#include <vector>
 #include <sys/stat.h>
 #include <glog/logging.h>
+#include "chunk_index.h"
+#include "chunk_name.h"
+#include "chunk_sink.h"
+#include "retention.h"
+
+/* Delay before a failed camera branch is rebuilt, doubled on every failure */
+#define CAMERA_RESTART_BASE_SEC 2
+#define CAMERA_RESTART_MAX_SEC 60
+
+/* Chunk containers */
+#define CONTAINER_MP4 0                 // moov at end, unreadable until finalized
+#define CONTAINER_FRAGMENTED_MP4 1
+#define CONTAINER_MKV 2
+#define FRAGMENT_DURATION_MS 2000
+
+/* Expected camera bitrate, used to preallocate each chunk */
+#define DEFAULT_BITRATE_KBPS 4096
+
+/* Manifest keys, one group per camera */
+#define MANIFEST_URL "url"
+#define MANIFEST_MAC "mac"
+#define MANIFEST_STREAM_ENC "stream-enc"
+#define MANIFEST_RECORD_CHUNK "record-chunk"
+#define MANIFEST_BITRATE "bitrate"
 
 /* variable to keep track of ctr+c cout to stop the program in case of program getting hanged */
 volatile sig_atomic_t ctrl_c_count = 0;
 
-/* Variable to store the last known valid PTS from depay */
-static GstClockTime last_valid_pts = GST_CLOCK_TIME_NONE;
-
 /* Running Configurations */
 static const gchar *mac = "MAC";
 static guint stream_enc = 0; // Default: H264
 static guint chunk_size = 300;
+static const gchar *manifest = NULL;
+static guint container = CONTAINER_MP4;
+static guint fragment_duration = FRAGMENT_DURATION_MS;
+static guint bitrate = DEFAULT_BITRATE_KBPS;
+static gboolean direct_io = FALSE;
+static guint camera_budget_mb = 0;
+static guint global_budget_mb = 0;
 
 GOptionEntry entries[] = {
 {"mac", 'm', 0, G_OPTION_ARG_STRING, &mac,
     "mac", NULL}
-,   
+,
 {"stream-enc", 'h', 0, G_OPTION_ARG_INT, &stream_enc,
       "Stream type: 0 = H264, \
        1 = H265, \
@@ -35,40 +66,116 @@ GOptionEntry entries[] = {
     "Stream record chunk size, \
     In seconds, \
     Default: 300 sec", NULL}
+,
+{"manifest", 'c', 0, G_OPTION_ARG_STRING, &manifest,
+    "Camera manifest (key file, one group per camera), \
+    records every camera in one process", NULL}
+,
+{"container", 'f', 0, G_OPTION_ARG_INT, &container,
+    "Chunk container: 0 = MP4, \
+    1 = Fragmented MP4, \
+    2 = Matroska, \
+    Default: MP4", NULL}
+,
+{"fragment-duration", 'd', 0, G_OPTION_ARG_INT, &fragment_duration,
+    "Fragment duration of fragmented MP4 chunks, \
+    In milliseconds, \
+    Default: 2000 ms", NULL}
+,
+{"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+    "Expected camera bitrate used to preallocate chunks, \
+    In kbps, 0 = no preallocation, \
+    Default: 4096 kbps", NULL}
+,
+{"direct-io", 0, 0, G_OPTION_ARG_NONE, &direct_io,
+    "Write chunks with O_DIRECT", NULL}
+,
+{"camera-budget-mb", 0, 0, G_OPTION_ARG_INT, &camera_budget_mb,
+    "Disk budget per camera, oldest chunks are deleted above it, \
+    In MB, 0 = unlimited, \
+    Default: unlimited", NULL}
+,
+{"global-budget-mb", 0, 0, G_OPTION_ARG_INT, &global_budget_mb,
+    "Disk budget for all cameras together, \
+    In MB, 0 = unlimited, \
+    Default: unlimited", NULL}
+,
+{NULL}
 };
 
-/* Structure to contain all our information, so we can pass it to callbacks */
-typedef struct _CustomData {
+/* Everything one camera needs. Each camera lives in its own bin so that a
+ * failure can be torn down and rebuilt without touching the others. */
+typedef struct _CameraBranch {
+    gchar *name;                    // mac, names the bin and the record folder
+    gchar *url;
+    guint stream_enc;
+    guint chunk_size;
+    guint bitrate;                  // kbps
+    gchar *record_folder;
+    GstElement *bin;
     GstElement *rtspsrc;
     GstElement *capsfilter;
     GstElement *queue;
     GstElement *depay;
     GstElement *parse;
-} CustomData;
-
-/* Following element pointers are globaly defined to access them within the signal handler */
-static GstElement *pipeline = NULL, *splitmuxsink = NULL;
+    GstElement *splitmuxsink;
+    GstElement *filesink;           // chunksink
+    /* Last known valid PTS from depay, only touched by this camera's streaming thread */
+    GstClockTime last_valid_pts;
+    /* Wall clock at the first PTS of the branch; set before any sample reaches
+     * splitmuxsink, read when chunks are named */
+    GstClockTime anchor_pts;
+    gint64 anchor_utc_us;
+    /* Keyframe index of the open chunk, only touched by the filesink's streaming thread */
+    ChunkIndexWriter index;
+    guint64 write_offset;
+    guint64 fragment_offset;        // last moof of a fragmented chunk, where seeking to its keyframe starts
+    gboolean header_rewrite;
+    guint restart_id;
+    gint restarts;
+} CameraBranch;
+
+/* Following pointers are globaly defined to access them within the signal callback */
+static GstElement *pipeline = NULL;
+static std::vector<CameraBranch *> cameras;
+static RetentionManager *retention = NULL;
 static GMainLoop *loop = NULL;
 
 /* Handler for the pad-added signal */
-static void pad_added_handler (GstElement *src, GstPad *pad, CustomData *data);
+static void pad_added_handler (GstElement *src, GstPad *pad, CameraBranch *camera);
 
 /* Bus callback function */
 static gboolean bus_call (GstBus * bus, GstMessage * msg, gpointer data);
 
 /* Pipeline stop function after a certain time limit */
-static void stop_pipeline_after_timeout (CustomData *data, guint timeout_seconds);
+static void stop_pipeline_after_timeout (guint timeout_seconds);
 
-/* Signal handler function stop the pipeline upon the correct signal received */
-static void signal_handler(int signum);
+/* Main loop callback stopping the pipeline upon the correct signal received */
+static gboolean signal_handler (gpointer data);
 
-/* Rename recording chunk files to human readable format */
-static gchararray rename_recording_chunk (GstElement * splitmux, guint fragment_id, const char* record_folder);
+/* Name recording chunks after the local time of their first frame */
+static gchararray format_chunk_location (GstElement * splitmux, guint fragment_id, GstSample *first_sample, CameraBranch *camera);
 
 static guint64 convert_to_nano_seconds (guint original_value);
 
 static gint createFolder(const char* folderPath);
 
+/* Function to add the pad probe to the parser's src pad */
+static void add_pts_fix_probe(CameraBranch *camera);
+
+/* Keyframe index sidecar written as each chunk closes */
+static void add_chunk_index_probe(CameraBranch *camera);
+
+/* Camera manifest and per camera branches */
+static gboolean load_manifest (const gchar *manifest_path);
+static CameraBranch *camera_new (const gchar *name, const gchar *url, guint enc, guint chunk, guint kbps);
+static gboolean camera_build (CameraBranch *camera);
+static void camera_teardown (CameraBranch *camera);
+static gboolean camera_restart (gpointer data);
+static void camera_schedule_restart (CameraBranch *camera);
+static CameraBranch *camera_from_object (GstObject *object);
+static void send_eos_to_cameras ();
+
 int main(int argc, char *argv[]) {
 
     // Initialize Google’s logging library.
@@ -77,13 +184,9 @@ int main(int argc, char *argv[]) {
 
     LOG(INFO) << "[Recorder] - Recorder Logging Initialized";
 
-    CustomData data;
     GstBus *bus = NULL;
-    GstMessage *msg;
     GstStateChangeReturn ret;
-    gboolean terminate = FALSE;
     guint bus_watch_id = 0;
-    GstCaps *caps = NULL; 
 
     GOptionContext *gctx = NULL;
     GOptionGroup *group = NULL;
@@ -97,95 +200,64 @@ int main(int argc, char *argv[]) {
     g_option_context_add_group (gctx, gst_init_get_option_group ());
 
     if (!g_option_context_parse (gctx, &argc, &argv, &error)) {
-        LOG(ERROR) << "[Recorder] - " << error->message << "\n"; 
+        LOG(ERROR) << "[Recorder] - " << error->message << "\n";
         LOG(ERROR) << "[Recorder]- " << g_option_context_get_help(gctx, TRUE, NULL) << "\n";
         return -1;
     }
 
     /* Initialize GStreamer */
     gst_init (&argc, &argv);
+    chunk_sink_register ();
 
      /* Set up a GMainLoop */
     loop = g_main_loop_new(NULL, FALSE);
 
-    /* Create the elements */
-    data.rtspsrc = gst_element_factory_make("rtspsrc", "rtspsrc");
-    data.capsfilter = gst_element_factory_make("capsfilter", "capsfilter");
-    data.queue = gst_element_factory_make("queue", "queue");
-    if (stream_enc == 0){
-        data.depay = gst_element_factory_make("rtph264depay", "h264-depay");
-        data.parse = gst_element_factory_make("h264parse", "h264-parse");
-    }
-    else {
-        data.depay = gst_element_factory_make("rtph265depay", "h265-depay");
-        data.parse = gst_element_factory_make("h265parse", "h265-parse");
-    }
-    splitmuxsink = gst_element_factory_make("splitmuxsink", "splitmuxsink");
-
-    /* Create the empty pipeline */
-    pipeline = gst_pipeline_new ("test-pipeline");
-
-    if (!pipeline || !data.rtspsrc || !data.capsfilter || !data.queue || !data.depay || !data.parse || !splitmuxsink) {
-            LOG(ERROR) << "[Recorder] - Not all elements could be created.\n";
+    /* Single camera from the command line, or every camera of the manifest */
+    if (manifest) {
+        if (!load_manifest (manifest)) {
             return -1;
+        }
+    } else if (argc > 1) {
+        cameras.push_back (camera_new (mac, argv[1], stream_enc, chunk_size, bitrate));
     }
 
-    /* Add elements to the pipeline */
-    gst_bin_add_many(GST_BIN(pipeline), data.rtspsrc, data.capsfilter, data.queue, data.depay, data.parse, splitmuxsink, NULL);
-
-    if (!gst_element_link_many(data.capsfilter, data.queue, data.depay, data.parse, splitmuxsink, NULL)) {
-        LOG(ERROR) << "[Recorder] - Error linking elements.\n";
-        gst_object_unref(pipeline);
+    if (cameras.empty ()) {
+        LOG(ERROR) << "[Recorder] - No camera to record, pass an rtsp url or --manifest.\n";
+        LOG(ERROR) << "[Recorder]- " << g_option_context_get_help(gctx, TRUE, NULL) << "\n";
         return -1;
     }
 
-    /* Convert recording chunk size */
-    guint64 result = convert_to_nano_seconds(chunk_size);
-    if (result == -1){
-        LOG(ERROR) << "[Recorder] - Numerical Conversion Error.\n";
-        gst_object_unref (pipeline);
+    /* Create the empty pipeline */
+    pipeline = gst_pipeline_new ("recording-pipeline");
+    if (!pipeline) {
+        LOG(ERROR) << "[Recorder] - Pipeline could not be created.\n";
         return -1;
     }
 
     /* Create recording folders */
     char stream_record_folder [60];
-    sprintf(stream_record_folder, "./recorded_streams");  
+    sprintf(stream_record_folder, "./recorded_streams");
     createFolder(stream_record_folder);
 
-    char camera_record_folder [90];
-    sprintf(camera_record_folder, "%s/%s", stream_record_folder, mac);
-    createFolder(camera_record_folder);
-
+    retention = new RetentionManager ((guint64) global_budget_mb << 20, (guint64) camera_budget_mb << 20);
 
-    /* Set splitmuxsink properties */ 
-    g_object_set(data.rtspsrc, "location", argv[1], NULL);
-    // g_object_set(data.filesink, "location", "received_h264.mkv", NULL);
-    // g_object_set(splitmuxsink, "location", "recordings/received_h264_%05d.mp4", NULL);
-    g_object_set(splitmuxsink, "max-size-time", result, NULL);  // Set max file size time (nanoseconds)
-    // g_object_set(splitmuxsink, "muxer-factory", "mp4mux", NULL );
-    // g_object_set(splitmuxsink, "async-finalize", true, NULL);
+    for (CameraBranch *camera : cameras) {
+        camera->record_folder = g_strdup_printf ("%s/%s", stream_record_folder, camera->name);
+        createFolder(camera->record_folder);
+        retention->add_folder (camera->record_folder);
 
-    /* Set caps properties */    
-    if (stream_enc == 0){
-        caps = gst_caps_new_simple("application/x-rtp", "media", G_TYPE_STRING, "video", "encoding-name", G_TYPE_STRING, "H264", NULL);
+        /* A camera that cannot be built yet must not keep the others from recording */
+        if (!camera_build (camera))
+            camera_schedule_restart (camera);
     }
-    else {
-        caps = gst_caps_new_simple("application/x-rtp", "media", G_TYPE_STRING, "video", "encoding-name", G_TYPE_STRING, "H265", NULL);
-    }
-    g_object_set(data.capsfilter, "caps", caps, NULL);
-    gst_caps_unref(caps);
 
-    /* pad added call back funtion */
-    g_signal_connect (data.rtspsrc, "pad-added", G_CALLBACK (pad_added_handler), &data);
-    /* add PTS fixing probe to the parser's src pad */
-    add_pts_fix_probe(data.parse);
-    /* rename file chunk call back funtion */
-    g_signal_connect (splitmuxsink, "format-location", G_CALLBACK (rename_recording_chunk), camera_record_folder);
+    retention->start ();
 
-    signal(SIGINT, signal_handler);
+    /* Dispatched on the main loop, where camera_restart also rebuilds the branches */
+    g_unix_signal_add (SIGINT, signal_handler, NULL);
 
     /* Start a thread to stop the pipeline after a certain time */
-    // std::thread stopThread(stop_pipeline_after_timeout, &data, 25);  // 60 seconds, adjust as needed
+    // std::thread stopThread(stop_pipeline_after_timeout, 25);  // 60 seconds, adjust as needed
 
     /* Listen to the bus */
     bus = gst_element_get_bus (pipeline);
@@ -201,16 +273,19 @@ int main(int argc, char *argv[]) {
     }
 
     /* Start the main loop */
-    LOG(INFO) << "[Recorder] - main loop running. \n";
+    LOG(INFO) << "[Recorder] - main loop running with " << cameras.size () << " camera(s). \n";
     g_main_loop_run(loop);
 
     LOG(INFO) << "[Recorder] - out of the main loop. \n";
 
     /* Free resources */
     // stopThread.join();
+    g_source_remove (bus_watch_id);
     g_main_loop_unref(loop);
     gst_element_set_state (pipeline, GST_STATE_NULL);
     gst_object_unref (pipeline);
+    chunk_sink_shutdown ();
+    retention->stop ();
     return 0;
 }
 
@@ -219,6 +294,7 @@ static gboolean bus_call (GstBus * bus, GstMessage * msg, gpointer data)
   GMainLoop *loop = (GMainLoop *) data;
   switch (GST_MESSAGE_TYPE (msg)) {
     case GST_MESSAGE_EOS:
+      /* Posted by the pipeline once every camera's splitmuxsink is EOS */
       LOG(INFO) << "[Recorder] - End of stream. \n";
       g_main_loop_quit (loop);
       break;
@@ -231,6 +307,24 @@ static gboolean bus_call (GstBus * bus, GstMessage * msg, gpointer data)
         LOG(ERROR) << "[Recorder] - Error details: " << debug << "\n";
       g_free (debug);
       g_error_free (error);
+
+      /* Queued errors of a camera bin that was already torn down */
+      if (msg->src != GST_OBJECT (pipeline) &&
+          !gst_object_has_as_ancestor (msg->src, GST_OBJECT (pipeline)))
+        break;
+
+      /* A camera failure only takes down that camera's bin */
+      CameraBranch *camera = camera_from_object (msg->src);
+      if (camera) {
+        camera_teardown (camera);
+        if (ctrl_c_count == 0) {
+          camera_schedule_restart (camera);
+        } else if (!camera_from_object (NULL)) {
+          /* Shutting down and no camera left to deliver EOS */
+          g_main_loop_quit (loop);
+        }
+        break;
+      }
       g_main_loop_quit (loop);
       break;
     }
@@ -241,18 +335,18 @@ static gboolean bus_call (GstBus * bus, GstMessage * msg, gpointer data)
 }
 
 /* This function will be called by the pad-added signal */
-static void pad_added_handler (GstElement *src, GstPad *new_pad, CustomData *data) {
-    GstPad *sink_pad = gst_element_get_static_pad (data->capsfilter, "sink");
+static void pad_added_handler (GstElement *src, GstPad *new_pad, CameraBranch *camera) {
+    GstPad *sink_pad = gst_element_get_static_pad (camera->capsfilter, "sink");
     GstPadLinkReturn ret;
     GstCaps *new_pad_caps = NULL;
     GstStructure *new_pad_struct = NULL;
     const gchar *new_pad_type = NULL;
 
-    LOG(INFO) << "[Recorder] - Received new pad " << GST_PAD_NAME (new_pad) << " from " << GST_ELEMENT_NAME (src) << "\n";
+    LOG(INFO) << "[Recorder] - [" << camera->name << "] - Received new pad " << GST_PAD_NAME (new_pad) << " from " << GST_ELEMENT_NAME (src) << "\n";
 
     /* If our converter is already linked, we have nothing to do here */
     if (gst_pad_is_linked (sink_pad)) {
-        LOG(INFO) << "[Recorder] - We are already linked. Ignoring.\n";
+        LOG(INFO) << "[Recorder] - [" << camera->name << "] - We are already linked. Ignoring.\n";
         goto exit;
     }
 
@@ -261,16 +355,16 @@ static void pad_added_handler (GstElement *src, GstPad *new_pad, CustomData *dat
     new_pad_struct = gst_caps_get_structure (new_pad_caps, 0);
     new_pad_type = gst_structure_get_name (new_pad_struct);
     if (!g_str_has_prefix (new_pad_type, "application/x-rtp")) {
-        LOG(INFO) << "[Recorder] - Ignoring pad with unexpected type: " << new_pad_type;
+        LOG(INFO) << "[Recorder] - [" << camera->name << "] - Ignoring pad with unexpected type: " << new_pad_type;
         goto exit;
     }
 
     /* Attempt the link */
     ret = gst_pad_link (new_pad, sink_pad);
     if (GST_PAD_LINK_FAILED (ret)) {
-        LOG(INFO) << "[Recorder] - Failed to link pad with type: " << new_pad_type;
+        LOG(INFO) << "[Recorder] - [" << camera->name << "] - Failed to link pad with type: " << new_pad_type;
     } else {
-        LOG(INFO) << "[Recorder] - Successfully linked pad with type: " << new_pad_type;
+        LOG(INFO) << "[Recorder] - [" << camera->name << "] - Successfully linked pad with type: " << new_pad_type;
     }
 
 exit:
@@ -282,13 +376,243 @@ exit:
     gst_object_unref (sink_pad);
 }
 
+/* Read the camera manifest. Every group is a camera; keys missing from a
+ * group fall back to the command line values. */
+static gboolean load_manifest (const gchar *manifest_path) {
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar **groups = NULL;
+    GKeyFile *key_file = g_key_file_new ();
+
+    if (!g_key_file_load_from_file (key_file, manifest_path, G_KEY_FILE_NONE, &error)) {
+        LOG(ERROR) << "[Recorder] - Failed to load manifest " << manifest_path << ": " << error->message;
+        goto done;
+    }
+
+    /* Reject the whole manifest before any of its cameras is added */
+    groups = g_key_file_get_groups (key_file, NULL);
+    for (gchar **group = groups; *group; group++) {
+        if (!g_key_file_has_key (key_file, *group, MANIFEST_URL, NULL)) {
+            LOG(ERROR) << "[Recorder] - Manifest group " << *group << " has no " << MANIFEST_URL;
+            goto done;
+        }
+    }
+
+    for (gchar **group = groups; *group; group++) {
+        gchar *url = g_key_file_get_string (key_file, *group, MANIFEST_URL, NULL);
+        gchar *camera_mac = g_key_file_get_string (key_file, *group, MANIFEST_MAC, NULL);
+        guint enc = stream_enc;
+        guint chunk = chunk_size;
+        guint kbps = bitrate;
+        if (g_key_file_has_key (key_file, *group, MANIFEST_STREAM_ENC, NULL))
+            enc = g_key_file_get_integer (key_file, *group, MANIFEST_STREAM_ENC, NULL);
+        if (g_key_file_has_key (key_file, *group, MANIFEST_RECORD_CHUNK, NULL))
+            chunk = g_key_file_get_integer (key_file, *group, MANIFEST_RECORD_CHUNK, NULL);
+        if (g_key_file_has_key (key_file, *group, MANIFEST_BITRATE, NULL))
+            kbps = g_key_file_get_integer (key_file, *group, MANIFEST_BITRATE, NULL);
+
+        cameras.push_back (camera_new (camera_mac ? camera_mac : *group, url, enc, chunk, kbps));
+        g_free (camera_mac);
+        g_free (url);
+    }
+    LOG(INFO) << "[Recorder] - Loaded " << cameras.size () << " camera(s) from " << manifest_path;
+    ret = TRUE;
+
+done:
+    if (error)
+        g_error_free (error);
+    g_strfreev (groups);
+    g_key_file_free (key_file);
+    return ret;
+}
+
+static CameraBranch *camera_new (const gchar *name, const gchar *url, guint enc, guint chunk, guint kbps) {
+    CameraBranch *camera = new CameraBranch ();
+    camera->name = g_strdup (name);
+    camera->url = g_strdup (url);
+    camera->stream_enc = enc;
+    camera->chunk_size = chunk;
+    camera->bitrate = kbps;
+    camera->last_valid_pts = GST_CLOCK_TIME_NONE;
+    camera->anchor_pts = GST_CLOCK_TIME_NONE;
+    return camera;
+}
+
+/* Forget the elements of a branch that was dropped */
+static void camera_clear_elements (CameraBranch *camera) {
+    camera->bin = NULL;
+    camera->rtspsrc = NULL;
+    camera->capsfilter = NULL;
+    camera->queue = NULL;
+    camera->depay = NULL;
+    camera->parse = NULL;
+    camera->splitmuxsink = NULL;
+    camera->filesink = NULL;
+}
+
+/* Create rtspsrc -> capsfilter -> queue -> depay -> parse -> splitmuxsink inside
+ * the camera's bin and add the bin to the pipeline */
+static gboolean camera_build (CameraBranch *camera) {
+    GstCaps *caps = NULL;
+    gchar *bin_name = g_strdup_printf ("camera-%s", camera->name);
+
+    camera->bin = gst_bin_new (bin_name);
+    g_free (bin_name);
+    camera->rtspsrc = gst_element_factory_make("rtspsrc", NULL);
+    camera->capsfilter = gst_element_factory_make("capsfilter", NULL);
+    camera->queue = gst_element_factory_make("queue", NULL);
+    if (camera->stream_enc == 0){
+        camera->depay = gst_element_factory_make("rtph264depay", NULL);
+        camera->parse = gst_element_factory_make("h264parse", NULL);
+    }
+    else {
+        camera->depay = gst_element_factory_make("rtph265depay", NULL);
+        camera->parse = gst_element_factory_make("h265parse", NULL);
+    }
+    camera->splitmuxsink = gst_element_factory_make("splitmuxsink", NULL);
+    camera->filesink = gst_element_factory_make("chunksink", NULL);
+    GstElement *muxer = NULL;
+    if (container == CONTAINER_MKV) {
+        muxer = gst_element_factory_make("matroskamux", NULL);
+    } else {
+        muxer = gst_element_factory_make("mp4mux", NULL);
+        /* Fragments make a chunk playable while it is written and after a crash */
+        if (muxer && container == CONTAINER_FRAGMENTED_MP4)
+            g_object_set(muxer, "fragment-duration", fragment_duration, NULL);
+    }
+
+    if (!camera->bin || !camera->rtspsrc || !camera->capsfilter || !camera->queue || !camera->depay || !camera->parse || !camera->splitmuxsink || !camera->filesink || !muxer) {
+            LOG(ERROR) << "[Recorder] - [" << camera->name << "] - Not all elements could be created.\n";
+            /* Nothing is parented yet, every created element is ours to drop */
+            GstElement *created[] = { camera->bin, camera->rtspsrc, camera->capsfilter, camera->queue,
+                camera->depay, camera->parse, camera->splitmuxsink, camera->filesink, muxer };
+            for (GstElement *element : created) {
+                if (element)
+                    gst_object_unref (element);
+            }
+            camera_clear_elements (camera);
+            return FALSE;
+    }
+
+    /* Own the sink so the muxed bytes can be indexed. splitmuxsink takes the sink
+     * and the muxer, the camera bin the rest, so from here on dropping the bin
+     * frees the whole branch */
+    g_object_set(camera->splitmuxsink, "sink", camera->filesink, NULL);
+    g_object_set(camera->splitmuxsink, "muxer", muxer, NULL);
+
+    /* Add elements to the camera bin */
+    gst_bin_add_many(GST_BIN(camera->bin), camera->rtspsrc, camera->capsfilter, camera->queue, camera->depay, camera->parse, camera->splitmuxsink, NULL);
+
+    if (!gst_element_link_many(camera->capsfilter, camera->queue, camera->depay, camera->parse, camera->splitmuxsink, NULL)) {
+        LOG(ERROR) << "[Recorder] - [" << camera->name << "] - Error linking elements.\n";
+        gst_object_unref (camera->bin);
+        camera_clear_elements (camera);
+        return FALSE;
+    }
+
+    /* Convert recording chunk size */
+    guint64 result = convert_to_nano_seconds(camera->chunk_size);
+    if (result == -1){
+        LOG(ERROR) << "[Recorder] - [" << camera->name << "] - Numerical Conversion Error.\n";
+        gst_object_unref (camera->bin);
+        camera_clear_elements (camera);
+        return FALSE;
+    }
+
+    /* Set splitmuxsink properties */
+    g_object_set(camera->rtspsrc, "location", camera->url, NULL);
+    g_object_set(camera->splitmuxsink, "max-size-time", result, NULL);  // Set max file size time (nanoseconds)
+    /* Reserve bitrate x chunk duration for every chunk */
+    g_object_set(camera->filesink, "preallocate", (guint64) camera->bitrate * 1000 / 8 * camera->chunk_size,
+        "direct", direct_io, NULL);
+    // g_object_set(camera->splitmuxsink, "async-finalize", true, NULL);
+
+    /* Set caps properties */
+    if (camera->stream_enc == 0){
+        caps = gst_caps_new_simple("application/x-rtp", "media", G_TYPE_STRING, "video", "encoding-name", G_TYPE_STRING, "H264", NULL);
+    }
+    else {
+        caps = gst_caps_new_simple("application/x-rtp", "media", G_TYPE_STRING, "video", "encoding-name", G_TYPE_STRING, "H265", NULL);
+    }
+    g_object_set(camera->capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    /* pad added call back funtion */
+    g_signal_connect (camera->rtspsrc, "pad-added", G_CALLBACK (pad_added_handler), camera);
+    /* add PTS fixing probe to the parser's src pad */
+    add_pts_fix_probe(camera);
+    /* add keyframe indexing probe to the chunk file sink */
+    add_chunk_index_probe(camera);
+    /* chunk naming call back funtion */
+    g_signal_connect (camera->splitmuxsink, "format-location-full", G_CALLBACK (format_chunk_location), camera);
+
+    camera->last_valid_pts = GST_CLOCK_TIME_NONE;
+    camera->anchor_pts = GST_CLOCK_TIME_NONE;
+    gst_bin_add (GST_BIN (pipeline), camera->bin);
+    return TRUE;
+}
+
+/* Stop and drop the camera's bin. Runs on the main loop. */
+static void camera_teardown (CameraBranch *camera) {
+    if (!camera->bin)
+        return;
+    gst_element_set_state (camera->bin, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (pipeline), camera->bin);
+    camera_clear_elements (camera);
+}
+
+static gboolean camera_restart (gpointer data) {
+    CameraBranch *camera = (CameraBranch *) data;
+    camera->restart_id = 0;
+
+    /* Stopping: the camera stays down so the pipeline can finish */
+    if (ctrl_c_count > 0)
+        return G_SOURCE_REMOVE;
+
+    if (!camera_build (camera)) {
+        LOG(ERROR) << "[Recorder] - [" << camera->name << "] - Unable to rebuild camera.\n";
+        camera_schedule_restart (camera);
+        return G_SOURCE_REMOVE;
+    }
+    gst_element_sync_state_with_parent (camera->bin);
+    LOG(INFO) << "[Recorder] - [" << camera->name << "] - Camera restarted. \n";
+    return G_SOURCE_REMOVE;
+}
+
+/* Rebuild the camera later, backing off on every consecutive failure */
+static void camera_schedule_restart (CameraBranch *camera) {
+    gint restarts = g_atomic_int_get (&camera->restarts);
+    guint delay = MIN (CAMERA_RESTART_BASE_SEC << MIN (restarts, 5), CAMERA_RESTART_MAX_SEC);
+    LOG(WARNING) << "[Recorder] - [" << camera->name << "] - Restarting camera in " << delay << " sec. \n";
+    g_atomic_int_inc (&camera->restarts);
+    camera->restart_id = g_timeout_add_seconds (delay, camera_restart, camera);
+}
+
+/* Camera whose bin contains object, NULL for pipeline level objects.
+ * With a NULL object returns the first camera that is still running. */
+static CameraBranch *camera_from_object (GstObject *object) {
+    for (CameraBranch *camera : cameras) {
+        if (camera->bin && (!object || object == GST_OBJECT (camera->bin) ||
+                gst_object_has_as_ancestor (object, GST_OBJECT (camera->bin))))
+            return camera;
+    }
+    return NULL;
+}
+
+/* Send EOS to every running splitmuxsink so the open chunks get finalized */
+static void send_eos_to_cameras () {
+    for (CameraBranch *camera : cameras) {
+        if (camera->splitmuxsink)
+            gst_element_send_event(camera->splitmuxsink, gst_event_new_eos());
+    }
+}
+
 /* Stops a GStreamer pipeline after a specified timeout */
-static void stop_pipeline_after_timeout(CustomData *data, guint timeout_seconds) {
+static void stop_pipeline_after_timeout(guint timeout_seconds) {
     std::this_thread::sleep_for(std::chrono::seconds(timeout_seconds));
 
     // 1. Send EOS event to splitmuxsink
-    GstEvent *eos_event = gst_event_new_eos();
-    gst_element_send_event(splitmuxsink, eos_event);
+    send_eos_to_cameras();
 
     // 2. Wait for EOS message on the bus (optional but recommended)
     GstBus *bus = gst_element_get_bus(pipeline);
@@ -299,7 +623,7 @@ static void stop_pipeline_after_timeout(CustomData *data, guint timeout_seconds)
             gst_message_unref(msg);
             break; // EOS received, proceed to stop the pipeline
         }
-    } while (true); 
+    } while (true);
 
     // 3. Set the pipeline to NULL state
     GstStateChangeReturn ret;
@@ -318,8 +642,8 @@ static void stop_pipeline_after_timeout(CustomData *data, guint timeout_seconds)
     g_main_loop_quit(loop);
 }
 
-/* Signal handler function to finish recording stream and stop the pipeline if a stopping signal is received */
-static void signal_handler(int signum) {
+/* Finish recording stream and stop the pipeline if a stopping signal is received */
+static gboolean signal_handler (gpointer data) {
 
     ++ctrl_c_count;
 
@@ -333,34 +657,30 @@ static void signal_handler(int signum) {
       }
     }
 
-    // 1. Send EOS event to splitmuxsink
-    GstEvent *eos_event = gst_event_new_eos();
-    gst_element_send_event(splitmuxsink, eos_event);
+    // 1. Send EOS event to every camera's splitmuxsink
+    send_eos_to_cameras();
+    return G_SOURCE_CONTINUE;
 }
 
-/* Rename recording chunk files to human readable format */
-static gchararray rename_recording_chunk (GstElement * splitmux, guint fragment_id, const char* record_folder) {
+/* Name recording chunks after the local time of their first frame. The time
+ * comes from the frame's PTS relative to the camera's stream anchor, so a chunk
+ * opened late by a busy muxer still carries the time it was captured. */
+static gchararray format_chunk_location (GstElement * splitmux, guint fragment_id, GstSample *first_sample, CameraBranch *camera) {
+    gint64 utc_us = g_get_real_time ();
+    GstBuffer *buffer = first_sample ? gst_sample_get_buffer (first_sample) : NULL;
 
-    auto now = std::chrono::system_clock::now();
-    std::time_t time_now = std::chrono::system_clock::to_time_t(now);
+    if (buffer && GST_BUFFER_PTS_IS_VALID (buffer) && GST_CLOCK_TIME_IS_VALID (camera->anchor_pts))
+        utc_us = camera->anchor_utc_us + GST_CLOCK_DIFF (camera->anchor_pts, GST_BUFFER_PTS (buffer)) / 1000;
 
-    // Get time zone
-    tm* local_time = std::localtime(&time_now);
+    gchar stem[32];
+    gchar name[CHUNK_NAME_MAX];
+    g_snprintf (stem, sizeof (stem), "stream_%05u", fragment_id);
+    if (!chunk_name_format (name, sizeof (name), stem, utc_us, container == CONTAINER_MKV ? "mkv" : "mp4"))
+        LOG(ERROR) << "[Recorder] - [" << camera->name << "] - Chunk name truncated: " << name;
 
-    gchar* result_string = g_strdup_printf(
-        "%s/stream_%05u_%04d%02d%02d-%02d%02d%02d_%s.mp4",
-        record_folder, 
-        fragment_id,
-        local_time->tm_year + 1900, // tm_year is years since 1900
-        local_time->tm_mon + 1,      // tm_mon is 0-based
-        local_time->tm_mday,
-        local_time->tm_hour,
-        local_time->tm_min,
-        local_time->tm_sec,
-        local_time->tm_zone         // tm_zone directly holds the timezone string
-    );
+    gchar* result_string = g_strdup_printf ("%s/%s", camera->record_folder, name);
 
-    LOG(INFO) << "[Recorder] - " << result_string;
+    LOG(INFO) << "[Recorder] - [" << camera->name << "] - " << result_string;
 
     return result_string;
 }
@@ -371,17 +691,17 @@ static guint64 convert_to_nano_seconds (guint original_value) {
 
     if (large_value > (std::numeric_limits<guint64>::max() / 1e9)) {
         LOG(ERROR) << "[Recorder] - Error: Multiplication would cause overflow!\n";
-        return -1; 
+        return -1;
     }
 
-    return large_value * 1e9; 
+    return large_value * 1e9;
 }
 
 static gint createFolder(const char* folderPath) {
     struct stat st = {0};
 
     if (stat(folderPath, &st) == 0) {
-        return 0; 
+        return 0;
     }
 
     if (mkdir(folderPath, 0766) == 0) {
@@ -389,33 +709,110 @@ static gint createFolder(const char* folderPath) {
     } else {
         // Check if the failure was due to the folder already existing
         if (errno == EEXIST) {
-            return 0; 
+            return 0;
         } else {
-            return -1; 
+            return -1;
         }
     }
 }
 
 /* Function to add a probe and fix missing PTS */
 static GstPadProbeReturn fix_missing_pts(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    CameraBranch *camera = (CameraBranch *) user_data;
     GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
     GstClockTime pts = GST_BUFFER_PTS(buffer);
 
     if (pts == GST_CLOCK_TIME_NONE) {
         /* set it to the last known valid PTS from depay */
-        GST_BUFFER_PTS(buffer) = last_valid_pts;
-        LOG(INFO) << "[PTS Fix] - Missing PTS, using last known valid PTS: " << last_valid_pts << "\n";
+        GST_BUFFER_PTS(buffer) = camera->last_valid_pts;
+        LOG(INFO) << "[PTS Fix] - [" << camera->name << "] - Missing PTS, using last known valid PTS: " << camera->last_valid_pts << "\n";
     } else {
         /* Update the last valid PTS if present */
-        last_valid_pts = pts;
+        camera->last_valid_pts = pts;
+        if (!GST_CLOCK_TIME_IS_VALID (camera->anchor_pts)) {
+            camera->anchor_utc_us = g_get_real_time ();
+            camera->anchor_pts = pts;
+        }
+        /* Buffers are flowing again, reset the restart backoff */
+        if (g_atomic_int_get (&camera->restarts))
+            g_atomic_int_set (&camera->restarts, 0);
     }
 
     return GST_PAD_PROBE_OK;
 }
 
 /* Function to add the pad probe to the parser's src pad */
-static void add_pts_fix_probe(GstElement *parser) {
-    GstPad *parser_src_pad = gst_element_get_static_pad(parser, "src");
-    gst_pad_add_probe(parser_src_pad, GST_PAD_PROBE_TYPE_BUFFER, fix_missing_pts, NULL, NULL);
+static void add_pts_fix_probe(CameraBranch *camera) {
+    GstPad *parser_src_pad = gst_element_get_static_pad(camera->parse, "src");
+    gst_pad_add_probe(parser_src_pad, GST_PAD_PROBE_TYPE_BUFFER, fix_missing_pts, camera, NULL);
     gst_object_unref(parser_src_pad);
 }
+
+/* Track the byte offset of every buffer the muxer writes and index the
+ * keyframes. Buffers keep the PTS and delta flag of the parsed samples. */
+static GstPadProbeReturn index_chunk_data(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    CameraBranch *camera = (CameraBranch *) user_data;
+
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+        if (camera->header_rewrite)
+            return GST_PAD_PROBE_OK;
+        if (GST_BUFFER_PTS_IS_VALID(buffer)) {
+            gboolean keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+            /* A fragment's samples are only readable from its moof on */
+            guint64 offset = keyframe && camera->fragment_offset != G_MAXUINT64 ?
+                camera->fragment_offset : camera->write_offset;
+            /* Set by fix_missing_pts before the buffer reached the muxer */
+            if (GST_CLOCK_TIME_IS_VALID(camera->anchor_pts))
+                camera->index.set_anchor(camera->anchor_utc_us, camera->anchor_pts);
+            camera->index.add_buffer(GST_BUFFER_PTS(buffer), offset, keyframe);
+        } else if (container == CONTAINER_FRAGMENTED_MP4) {
+            /* Headers carry no PTS; the moof box opens every fragment */
+            guint8 box[8];
+            if (gst_buffer_extract(buffer, 0, box, sizeof(box)) == sizeof(box) && memcmp(box + 4, "moof", 4) == 0)
+                camera->fragment_offset = camera->write_offset;
+        }
+        camera->write_offset += gst_buffer_get_size(buffer);
+        return GST_PAD_PROBE_OK;
+    }
+
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+    switch (GST_EVENT_TYPE(event)) {
+        case GST_EVENT_STREAM_START:
+            /* splitmuxsink restarts the muxer and the sink for every chunk */
+            camera->index.begin();
+            camera->write_offset = 0;
+            camera->fragment_offset = G_MAXUINT64;
+            camera->header_rewrite = FALSE;
+            break;
+        case GST_EVENT_SEGMENT: {
+            const GstSegment *segment;
+            gst_event_parse_segment(event, &segment);
+            /* mp4mux seeks back to patch the header once all samples are written */
+            if (segment->format == GST_FORMAT_BYTES && segment->start != camera->write_offset)
+                camera->header_rewrite = TRUE;
+            break;
+        }
+        case GST_EVENT_EOS: {
+            gchar *location = NULL;
+            g_object_get(camera->filesink, "location", &location, NULL);
+            ChunkCatalogRecord record;
+            if (location && camera->index.finish(location, camera->write_offset, &record))
+                retention->add_chunk(camera->record_folder, record);
+            g_free(location);
+            camera->index.begin();
+            break;
+        }
+        default:
+            break;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+/* Function to add the indexing probe to the file sink's sink pad */
+static void add_chunk_index_probe(CameraBranch *camera) {
+    GstPad *sink_pad = gst_element_get_static_pad(camera->filesink, "sink");
+    gst_pad_add_probe(sink_pad, (GstPadProbeType) (GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+        index_chunk_data, camera, NULL);
+    gst_object_unref(sink_pad);
+}
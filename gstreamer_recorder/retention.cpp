@@ -0,0 +1,164 @@
+#include "retention.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <chrono>
+#include <glog/logging.h>
+
+/* linux/ioprio.h is not installed everywhere */
+#define RETENTION_IOPRIO_WHO_PROCESS 1
+#define RETENTION_IOPRIO_CLASS_IDLE 3
+#define RETENTION_IOPRIO_CLASS_SHIFT 13
+
+RetentionManager::RetentionManager(guint64 global_budget, guint64 folder_budget)
+    : global_budget(global_budget), folder_budget(folder_budget), sidecar_suffixes{CHUNK_INDEX_SUFFIX} {
+}
+
+RetentionManager::~RetentionManager() {
+    stop();
+}
+
+/* Chunks can close out of order, keep the oldest at the front */
+static void
+insert_chunk(std::deque<ChunkCatalogRecord> &chunks, const ChunkCatalogRecord &record)
+{
+    auto it = chunks.end();
+    while (it != chunks.begin() && (it - 1)->first_utc_us > record.first_utc_us)
+        --it;
+    chunks.insert(it, record);
+}
+
+void RetentionManager::add_folder(const std::string &folder) {
+    std::vector<ChunkCatalogRecord> records;
+    chunk_catalog_load(folder.c_str(), &records);
+
+    std::lock_guard<std::mutex> guard(lock);
+    Folder &entry = folders[folder];
+    for (const ChunkCatalogRecord &record : records) {
+        insert_chunk(entry.chunks, record);
+        entry.bytes += record.file_size;
+        total_bytes += record.file_size;
+    }
+    LOG(INFO) << "[Retention] - " << folder << ": " << records.size() << " chunks, "
+        << entry.bytes / (1024 * 1024) << " MB";
+}
+
+void RetentionManager::add_chunk(const std::string &folder, const ChunkCatalogRecord &record) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Folder &entry = folders[folder];
+        insert_chunk(entry.chunks, record);
+        entry.bytes += record.file_size;
+        total_bytes += record.file_size;
+    }
+    cond.notify_one();
+}
+
+void RetentionManager::add_sidecar_suffix(const std::string &suffix) {
+    std::lock_guard<std::mutex> guard(lock);
+    sidecar_suffixes.push_back(suffix);
+}
+
+void RetentionManager::start() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (running || (!global_budget && !folder_budget))
+        return;
+    running = true;
+    worker = std::thread(&RetentionManager::run, this);
+}
+
+void RetentionManager::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!running)
+            return;
+        running = false;
+    }
+    cond.notify_one();
+    worker.join();
+}
+
+gboolean RetentionManager::pick_evictions(std::vector<Eviction> *evictions) {
+    std::map<std::string, std::vector<std::string>> picked;
+    guint count = 0;
+
+    while (count < RETENTION_BATCH_MAX) {
+        std::map<std::string, Folder>::iterator victim = folders.end();
+        for (auto it = folders.begin(); it != folders.end(); ++it) {
+            if (it->second.chunks.empty())
+                continue;
+            /* A folder over its own budget goes first */
+            if (folder_budget && it->second.bytes > folder_budget) {
+                victim = it;
+                break;
+            }
+            /* Otherwise the oldest chunk of all folders, if over the global budget */
+            if (global_budget && total_bytes > global_budget &&
+                (victim == folders.end() ||
+                 it->second.chunks.front().first_utc_us < victim->second.chunks.front().first_utc_us))
+                victim = it;
+        }
+        if (victim == folders.end())
+            break;
+
+        const ChunkCatalogRecord &oldest = victim->second.chunks.front();
+        picked[victim->first].push_back(oldest.name);
+        victim->second.bytes -= oldest.file_size;
+        total_bytes -= oldest.file_size;
+        victim->second.chunks.pop_front();
+        count++;
+    }
+
+    for (auto &folder : picked) {
+        Eviction eviction;
+        eviction.folder = folder.first;
+        eviction.names = std::move(folder.second);
+        evictions->push_back(std::move(eviction));
+    }
+    return count > 0;
+}
+
+/* Delete a batch of chunks of one folder relative to its directory fd, then
+ * drop their records from the catalog */
+void RetentionManager::evict(const Eviction &eviction) {
+    int dir_fd = open(eviction.folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        LOG(ERROR) << "[Retention] - Unable to open " << eviction.folder << ": " << strerror(errno);
+        return;
+    }
+    for (const std::string &name : eviction.names) {
+        if (unlinkat(dir_fd, name.c_str(), 0) != 0 && errno != ENOENT)
+            LOG(ERROR) << "[Retention] - Unable to delete " << eviction.folder << "/" << name << ": " << strerror(errno);
+        for (const std::string &suffix : sidecar_suffixes) {
+            std::string sidecar_name = name + suffix;
+            unlinkat(dir_fd, sidecar_name.c_str(), 0);
+        }
+    }
+    close(dir_fd);
+
+    chunk_catalog_drop(eviction.folder.c_str(), eviction.names);
+    LOG(INFO) << "[Retention] - Deleted " << eviction.names.size() << " chunks from " << eviction.folder;
+}
+
+void RetentionManager::run() {
+    /* Deleting old footage must never compete with recording */
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+    syscall(SYS_ioprio_set, RETENTION_IOPRIO_WHO_PROCESS, 0,
+        RETENTION_IOPRIO_CLASS_IDLE << RETENTION_IOPRIO_CLASS_SHIFT);
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (running) {
+        std::vector<Eviction> evictions;
+        if (!pick_evictions(&evictions)) {
+            cond.wait_for(guard, std::chrono::seconds(RETENTION_CHECK_INTERVAL_SEC));
+            continue;
+        }
+        guard.unlock();
+        for (const Eviction &eviction : evictions)
+            evict(eviction);
+        guard.lock();
+    }
+}
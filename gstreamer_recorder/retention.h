@@ -0,0 +1,65 @@
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include <glib.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "chunk_index.h"
+
+/* Chunks deleted per pass before the catalog is rewritten */
+#define RETENTION_BATCH_MAX 64
+/* Budgets are also re-checked on this period when no chunk closes */
+#define RETENTION_CHECK_INTERVAL_SEC 10
+
+/* Keeps recording folders within byte budgets. Every folder's chunk list is
+ * loaded once from its chunks.catalog and then kept up to date by add_chunk(),
+ * so the directory is never scanned. Oldest chunks are deleted first on a low
+ * priority (nice 19, idle I/O class) thread. */
+class RetentionManager {
+public:
+    /* Budgets in bytes, 0 = unlimited. folder_budget applies to each folder on
+     * its own, global_budget to all folders together. */
+    RetentionManager(guint64 global_budget, guint64 folder_budget);
+    ~RetentionManager();
+
+    /* Start managing folder, loading its catalog */
+    void add_folder(const std::string &folder);
+    /* Account a chunk that was just appended to folder's catalog */
+    void add_chunk(const std::string &folder, const ChunkCatalogRecord &record);
+    /* Also delete <chunk><suffix> with every chunk, like the .idx sidecar */
+    void add_sidecar_suffix(const std::string &suffix);
+
+    void start();
+    void stop();
+
+private:
+    struct Folder {
+        std::deque<ChunkCatalogRecord> chunks;   // oldest first
+        guint64 bytes = 0;
+    };
+    struct Eviction {
+        std::string folder;
+        std::vector<std::string> names;
+    };
+
+    guint64 global_budget;
+    guint64 folder_budget;
+    guint64 total_bytes = 0;
+    std::map<std::string, Folder> folders;
+    std::vector<std::string> sidecar_suffixes;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::thread worker;
+    bool running = false;
+
+    void run();
+    /* Pop up to RETENTION_BATCH_MAX oldest chunks over budget, lock held */
+    gboolean pick_evictions(std::vector<Eviction> *evictions);
+    void evict(const Eviction &eviction);
+};
+
+#endif // RETENTION_H
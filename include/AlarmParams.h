@@ -0,0 +1,74 @@
+#ifndef ALARMPARAMS_H
+#define ALARMPARAMS_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Config group and keys of the per-camera alarm config file */
+#define CONFIG_GROUP_ALARM "alarm"
+#define CONFIG_ALARM_WINDOW "alarm-window"
+#define CONFIG_ALARM_PERSON_FRAMES_LIMIT "person-detected-frames-limit"
+#define CONFIG_ALARM_VEHICLE_FRAMES_LIMIT "vehicle-detected-frames-limit"
+#define CONFIG_ALARM_PERSON_CLASS_ID "person-class-id"
+#define CONFIG_ALARM_VEHICLE_CLASS_IDS "vehicle-class-ids"
+#define CONFIG_ALARM_PERSON_DETECTION "person-detection"
+#define CONFIG_ALARM_VEHICLE_DETECTION "vehicle-detection"
+#define CONFIG_ALARM_INCIDENT_START_TIME "incident-start-time"
+#define CONFIG_ALARM_INCIDENT_DURATION "incident-duration"
+#define CONFIG_ALARM_BLOCK_MOTION_THRESHOLD "block-motion-threshold"
+#define CONFIG_ALARM_BOX_MOTION_PERCENTAGE "box-motion-percentage"
+#define CONFIG_ALARM_BACKOFF_BASE_INTERVAL "backoff-base-interval"
+#define CONFIG_ALARM_BACKOFF_MAX_INTERVAL "backoff-max-interval"
+#define CONFIG_ALARM_RECORDING_FREQUENCY "recording-frequency-threshold"
+
+/* Everything the alarm probe reads per buffer. The compile-time #defines in
+ * pipeline.h are only the defaults. */
+struct AlarmParams {
+    int alarm_window;
+    int person_detected_frames_limit;
+    int vehicle_detected_frames_limit;
+    int person_class_id;
+    std::vector<int> vehicle_class_ids;
+    gboolean person_detection_enabled;
+    gboolean vehicle_detection_enabled;
+    guint incident_start_time;        // seconds before the alarm
+    guint incident_duration;          // seconds
+    double block_motion_threshold;
+    double box_motion_percentage;
+    int backoff_base_interval;        // seconds
+    int backoff_max_interval;         // seconds
+    int recording_frequency_threshold;
+
+    bool is_vehicle_class(int class_id) const;
+};
+
+/* Owner of the live parameter block. The streaming thread takes a reference
+ * with an atomic load; reloads run on the main loop and swap the pointer. A
+ * replaced block is freed when the last reader drops its reference. */
+class AlarmParamsStore {
+public:
+    AlarmParamsStore(const AlarmParams &base, const std::string &config_path);
+
+    std::shared_ptr<const AlarmParams> get() const { return std::atomic_load(&current); }
+
+    /* Re-read the config file on top of the base values. Keeps the current
+     * block if the file is invalid. */
+    gboolean reload();
+
+    /* Reload on SIGHUP and on file changes (inotify via GFileMonitor) */
+    void watch();
+
+private:
+    AlarmParams base;
+    std::string config_path;
+    std::shared_ptr<const AlarmParams> current;
+    GFileMonitor *monitor;
+};
+
+/* Overlay keys present in the [alarm] group of config_path onto params */
+gboolean alarm_params_load(const char *config_path, AlarmParams *params);
+
+#endif // ALARMPARAMS_H
@@ -0,0 +1,73 @@
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include <glog/logging.h>
+#include <cstdint>
+
+/* Highest VLOG level compiled into the binary. Call sites above this level are
+ * removed by the preprocessor/optimizer and cost nothing at runtime.
+ * Override with -DPIPELINE_LOG_MAX_VLEVEL=<n> (see LOG_MAX_VLEVEL in Makefile). */
+#ifndef PIPELINE_LOG_MAX_VLEVEL
+#define PIPELINE_LOG_MAX_VLEVEL 1
+#endif
+
+#define ASYNC_LOG_RING_SIZE 1024   // slots, power of two
+#define ASYNC_LOG_LINE_MAX 256     // bytes per formatted line
+
+/* Token bucket guarding one log call site. Each site is expected to be hit
+ * from a single streaming thread, so no synchronisation is done here. */
+class LogRateLimiter {
+public:
+    LogRateLimiter(double rate_per_sec, double burst);
+    bool allow();
+    /* Lines rejected since the last allowed one, reported with the next line */
+    uint64_t take_suppressed();
+
+private:
+    double rate;
+    double burst;
+    double tokens;
+    int64_t last_refill_us;
+    uint64_t suppressed;
+};
+
+/* Start/stop the background writer. Until started, lines go straight to glog. */
+void async_log_start();
+void async_log_stop();
+
+/* Format a line into the ring buffer; never blocks and never touches disk.
+ * Lines are dropped (and counted) when the ring is full. */
+void async_log_write(int severity, const char *file, int line, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+uint64_t async_log_dropped();
+
+/* printf style, key=value structured logging routed through the ring buffer */
+#define ALOG(severity, fmt, ...) \
+    async_log_write(google::GLOG_##severity, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+
+/* Same as ALOG but limited to `rate` lines per second with bursts of `burst` */
+#define ALOG_RATE(severity, rate, burst, fmt, ...) \
+    do { \
+        static LogRateLimiter _log_site_limiter((rate), (burst)); \
+        if (_log_site_limiter.allow()) { \
+            uint64_t _log_suppressed = _log_site_limiter.take_suppressed(); \
+            async_log_write(google::GLOG_##severity, __FILE__, __LINE__, \
+                fmt " suppressed=%lu", ##__VA_ARGS__, (unsigned long) _log_suppressed); \
+        } \
+    } while (0)
+
+/* Verbose logging stripped at compile time above PIPELINE_LOG_MAX_VLEVEL */
+#define AVLOG(level, fmt, ...) \
+    do { \
+        if ((level) <= PIPELINE_LOG_MAX_VLEVEL && VLOG_IS_ON(level)) \
+            ALOG(INFO, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#define AVLOG_RATE(level, rate, burst, fmt, ...) \
+    do { \
+        if ((level) <= PIPELINE_LOG_MAX_VLEVEL && VLOG_IS_ON(level)) \
+            ALOG_RATE(INFO, rate, burst, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#endif // ASYNCLOG_H
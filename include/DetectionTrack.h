@@ -0,0 +1,57 @@
+#ifndef DETECTIONTRACK_H
+#define DETECTIONTRACK_H
+
+#include <glib.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/* Sidecar next to an incident clip, e.g. incident_..._.mp4.vtt */
+#define DETECTION_TRACK_SUFFIX ".vtt"
+/* A cue never outlasts its frame by more than this when frames stop coming */
+#define DETECTION_TRACK_CUE_MAX_MS 200
+/* History kept beyond the incident window for late callbacks */
+#define DETECTION_TRACK_MARGIN_SEC 5
+
+/* One object of a frame, coordinates normalised to [0, 1] */
+struct DetectionBox {
+    guint64 object_id;
+    gint class_id;
+    gfloat confidence;
+    gfloat left;
+    gfloat top;
+    gfloat width;
+    gfloat height;
+};
+
+/* Rolling history of per-frame detections by wall clock time. Incident clips
+ * are recorded passthrough from the camera's H.264, and the boxes of the clip's
+ * time window are written as a WebVTT metadata track for the player to overlay
+ * instead of re-encoding the clip with the boxes drawn in. */
+class DetectionTrack {
+public:
+    explicit DetectionTrack(guint history_sec);
+
+    /* Detections of one frame, frames without objects end the previous cue.
+     * Called from the streaming thread. */
+    void add_frame(gint64 utc_us, std::vector<DetectionBox> &&boxes);
+
+    /* Keep at least history_sec of frames, e.g. after the incident window grew */
+    void set_history(guint history_sec);
+
+    /* Write <clip_path>.vtt with one cue per frame in [start_utc_us, end_utc_us],
+     * timed relative to start_utc_us */
+    gboolean write_webvtt(const gchar *clip_path, gint64 start_utc_us, gint64 end_utc_us);
+
+private:
+    struct Frame {
+        gint64 utc_us;
+        std::vector<DetectionBox> boxes;
+    };
+
+    std::mutex lock;
+    std::deque<Frame> frames;   // oldest first
+    gint64 history_us;
+};
+
+#endif // DETECTIONTRACK_H
@@ -9,6 +9,8 @@ public:
     int get_sum() const;
     int get_size() const;
     void reset_counter();
+    int get_max_size() const;
+    void resize(int newMaxSize);
 
 private:
     int* array;
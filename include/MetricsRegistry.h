@@ -0,0 +1,57 @@
+#ifndef METRICSREGISTRY_H
+#define METRICSREGISTRY_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Monotonic counter updated from the streaming thread. Increments are relaxed
+ * atomics on their own cache line, so the hot path never takes a lock. */
+class MetricsCounter {
+public:
+    void inc(uint64_t value = 1) { count.fetch_add(value, std::memory_order_relaxed); }
+    uint64_t get() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<uint64_t> count{0};
+};
+
+/* Registry of counters and gauges rendered in the Prometheus text format.
+ * Metrics are registered once during pipeline setup, before the main loop
+ * starts; after that only the counters themselves are touched. */
+class MetricsRegistry {
+public:
+    MetricsCounter *add_counter(const std::string &name, const std::string &help);
+    /* Counter kept elsewhere, e.g. by a library, sampled at scrape time */
+    void add_sampled_counter(const std::string &name, const std::string &help, std::function<uint64_t()> sample);
+    /* Gauges are sampled on the main loop at scrape time */
+    void add_gauge(const std::string &name, const std::string &help, std::function<double()> sample);
+    /* Labels attached to every sample, e.g. camera_id="3" */
+    void set_const_labels(const std::string &labels);
+    std::string render() const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string help;
+        std::unique_ptr<MetricsCounter> counter;
+        std::function<uint64_t()> sampled_counter;
+        std::function<double()> gauge;
+    };
+    std::vector<Entry> entries;
+    std::string const_labels;
+};
+
+/* Process wide registry */
+MetricsRegistry &metrics_registry();
+
+/* Serve the registry on http://127.0.0.1:<port>/metrics from the default main
+ * context. Returns NULL if the port could not be bound. */
+GSocketService *metrics_http_server_start(MetricsRegistry *registry, guint port);
+
+#endif // METRICSREGISTRY_H
@@ -0,0 +1,49 @@
+#ifndef SOURCEWATCHDOG_H
+#define SOURCEWATCHDOG_H
+
+#include <glib.h>
+#include <atomic>
+
+/* Stall detection and reconnect backoff of the RTSP source branch. Times are
+ * g_get_monotonic_time() microseconds passed in by the caller, so the policy
+ * runs the same under a test clock. buffer_seen() is called from the
+ * streaming thread, everything else from the main loop. */
+class SourceWatchdog {
+public:
+    enum Verdict {
+        SOURCE_WAITING,     // no buffer yet or streaming, nothing to do
+        SOURCE_STARTED,     // first buffer of the current branch
+        SOURCE_STALLED      // no buffer for stall_timeout, rebuild the branch
+    };
+
+    SourceWatchdog(guint stall_timeout_sec, guint base_ms, guint max_ms, gdouble jitter);
+
+    /* A new branch was built, its stall timer starts now */
+    void branch_created(gint64 now_us);
+    void buffer_seen(gint64 now_us) { last_buffer_us.store(now_us, std::memory_order_relaxed); }
+
+    /* Periodic check. A connection that stayed up for stall_timeout resets
+     * the backoff. */
+    Verdict tick(gint64 now_us);
+
+    /* Delay before the next rebuild, doubling per attempt up to max_ms and
+     * spread by +-jitter. random is uniform in [0, 1). Counts the attempt. */
+    guint next_reconnect_delay_ms(gdouble random);
+
+    guint attempts() const { return reconnect_attempts; }
+    /* When the current branch started streaming, 0 while it is not */
+    gint64 up_since_us() const { return streaming_since_us; }
+
+private:
+    gint64 stall_timeout_us;
+    guint base_ms;
+    guint max_ms;
+    gdouble jitter;
+
+    std::atomic<gint64> last_buffer_us{0};
+    gint64 created_us = 0;
+    gint64 streaming_since_us = 0;
+    guint reconnect_attempts = 0;
+};
+
+#endif // SOURCEWATCHDOG_H
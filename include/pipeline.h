@@ -19,8 +19,16 @@
 #include <SimpleAmqpClient/SimpleAmqpClient.h>
 #include <unordered_map>
 #include <chrono>
+#include <atomic>
 
 #include "FixedSizeCounter.h"
+#include "MetricsRegistry.h"
+#include "AsyncLog.h"
+#include "AlarmParams.h"
+#include "DetectionTrack.h"
+#include "SourceWatchdog.h"
+#include "chunk_name.h"
+#include "retention.h"
 
 #pragma once
 
@@ -29,8 +37,9 @@
 #define SMART_RECORD_LOG_FILE "/configs/smart_record.log"
 #define PGIE_CONFIG_FILE "/configs/model_config.txt"
 #define NVDSANALYTICS_CONFIG_FILE "/configs/config_nvdsanalytics.txt"
+#define ALARM_CONFIG_FILE "/configs/alarm_config.txt"
 
-/* Alarm metrics */
+/* Alarm metrics, defaults for the [alarm] group of ALARM_CONFIG_FILE */
 #define ALARM_WINDOW 100
 #define PERSON_DETECTED_FRAMES_LIMIT 20
 #define VEHICLE_DETECTED_FRAMES_LIMIT 20
@@ -44,11 +53,23 @@
 // /* RTSP source*/
 // #define PROTOCOL 4   //tcp protocol
 
+/* Source branch recovery */
+#define SOURCE_STALL_TIMEOUT_SEC 10     // no buffers on the depay src pad for this long triggers a reconnect
+#define SOURCE_WATCHDOG_INTERVAL_SEC 1
+#define SOURCE_RECONNECT_BASE_MS 250
+#define SOURCE_RECONNECT_MAX_MS 30000
+#define SOURCE_RECONNECT_JITTER 0.2     // +-20% of the backoff delay
+
 /* Stream Muxer*/
 #define MUXER_OUTPUT_WIDTH 640
 #define MUXER_OUTPUT_HEIGHT 360
 #define MUXER_BATCH_TIMEOUT_USEC 40000
 
+/* Bounding boxes on incident clips */
+#define BBOX_DISABLED 0
+#define BBOX_BURN_IN 1          // re-encode the OSD output into the clip
+#define BBOX_SIDECAR 2          // passthrough clip plus a WebVTT detection track
+
 /* OSD */
 #define OSD_PROCESS_MODE 1
 #define OSD_DISPLAY_TEXT 1
@@ -62,7 +83,10 @@
 #define SMART_REC_DURATION 8
 
 /* Stream Recording */
-#define STREAM_REC_CONTAINER NVDSSR_CONTAINER_MP4
+#define STREAM_REC_CONTAINER_MP4 0          // moov at end, unreadable until finalized
+#define STREAM_REC_CONTAINER_FRAGMENTED_MP4 1
+#define STREAM_REC_CONTAINER_MKV 2
+#define STREAM_REC_FRAGMENT_DURATION_MS 2000
 #define STREAM_REC_CACHE_SIZE_SEC 15
 #define STREAM_REC_DEFAULT_DURATION 10800
 #define STREAM_REC_START_TIME 2
@@ -70,6 +94,13 @@
 #define STREAM_REC_HEIGHT 0
 #define STREAM_REC_WIDTH 0
 
+/* Queues behind tee_pre_decode. Record branches drop what exceeds their
+ * budget, the decode branch never drops. */
+#define RECORD_QUEUE_MAX_TIME_MS 2000
+#define RECORD_QUEUE_MAX_BYTES (4 * 1024 * 1024)
+#define DECODE_QUEUE_MAX_TIME_MS 1000
+#define DECODE_QUEUE_MAX_BUFFERS 60
+
 /* Tracker */
 #define CONFIG_GROUP_TRACKER "tracker"
 #define CONFIG_GROUP_TRACKER_WIDTH "tracker-width"
@@ -117,6 +148,8 @@ void smart_record_event_generator (gpointer);
 
 void reset_person_frame_counters();
 
+void update_recording_interval(const AlarmParams *);
+
 static GstPadProbeReturn
 osd_sink_pad_buffer_probe (GstPad *, GstPadProbeInfo *, gpointer);
 
@@ -126,3 +159,21 @@ cb_newpad_audio_parsebin (GstElement *, GstPad *, gpointer);
 static void
 cb_newpad (GstElement *, GstPad *, gpointer);
 
+static void
+cb_recordbin_element_added (GstBin *, GstBin *, GstElement *, gpointer);
+
+static gboolean
+create_source_branch (const gchar *);
+
+static gboolean
+rebuild_source_branch (gpointer);
+
+static void
+schedule_source_rebuild (const gchar *);
+
+static gboolean
+source_watchdog_tick (gpointer);
+
+static GstPadProbeReturn
+source_depay_src_pad_buffer_probe (GstPad *, GstPadProbeInfo *, gpointer);
+
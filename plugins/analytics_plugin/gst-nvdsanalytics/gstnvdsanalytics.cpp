@@ -23,16 +23,16 @@
 
 #include <string.h>
 #include <string>
-#include <sstream>
 #include <iostream>
 #include <ostream>
 #include <fstream>
 #include <cstring>
-#include <map>
+#include <algorithm>
 #include <cmath>
 #include "gstnvdsanalytics.h"
 #include "nvdsanalytics_property_parser.h"
 #include "nvdsanalytics_property_yaml_parser.h"
+#include "nvdsanalytics_config_cache.h"
 #include <sys/time.h>
 GST_DEBUG_CATEGORY_STATIC (gst_nvdsanalytics_debug);
 #define GST_CAT_DEFAULT gst_nvdsanalytics_debug
@@ -45,7 +45,9 @@ enum
   PROP_0,
   PROP_UNIQUE_ID,
   PROP_ENABLE,
-  PROP_CONFIG_FILE
+  PROP_CONFIG_FILE,
+  PROP_CONFIG_CACHE,
+  PROP_DISPLAY_META
 };
 
 /* Default values for properties */
@@ -54,6 +56,8 @@ enum
 #define DEFAULT_HEIGHT 1080
 #define DEFAULT_FONT_SIZE 12
 #define DEFAULT_OSD_MODE 2
+#define DEFAULT_CONFIG_CACHE TRUE
+#define DEFAULT_DISPLAY_META TRUE
 
 
 typedef void DsExampleOutput;
@@ -163,6 +167,24 @@ gst_nvdsanalytics_class_init (GstNvDsAnalyticsClass * klass)
           "DsAnalytics Config File",
           NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+  g_object_class_install_property (gobject_class, PROP_CONFIG_CACHE,
+      g_param_spec_boolean ("config-cache", "DsAnalytics Config Cache",
+          "Load the config and its rasterised zones from a compiled cache in"
+          " $XDG_CACHE_HOME/" NVDSANALYTICS_CONFIG_CACHE_DIR " while config-file"
+          " keeps the contents it was compiled from, and write one after parsing"
+          " the config."
+          " Set before config-file",
+          DEFAULT_CONFIG_CACHE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DISPLAY_META,
+      g_param_spec_boolean ("display-meta", "Attach display meta",
+          "Draw zones, counts and object status through display meta and"
+          " object labels. Disable when no OSD consumes them, the analytics"
+          " user meta is attached either way",
+          DEFAULT_DISPLAY_META,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
   /* Set sink and src pad capabilities */
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gst_nvdsanalytics_src_template));
@@ -199,11 +221,18 @@ gst_nvdsanalytics_init (GstNvDsAnalytics * nvdsanalytics)
 
   nvdsanalytics->config_file_path = NULL;
   nvdsanalytics->config_file_parse_successful = FALSE;
+  nvdsanalytics->config_cache = DEFAULT_CONFIG_CACHE;
+  nvdsanalytics->display_meta = DEFAULT_DISPLAY_META;
   nvdsanalytics->enable = TRUE;
   nvdsanalytics->stream_analytics_info =
       new std::unordered_map < gint, StreamInfo >[1];
   nvdsanalytics->stream_analytics_ctx =
       new std::unordered_map < gint, NvDsAnalyticCtxUptr >[1];
+  nvdsanalytics->stream_analytics_state =
+      new std::unordered_map < gint, StreamAnalyticsState >[1];
+  nvdsanalytics->stream_osd_template =
+      new std::unordered_map < gint, NvDsAnalyticsOsdTemplate >[1];
+  nvdsanalytics->meta_pool = nvdsanalytics_meta_pool_new ();
   g_mutex_init (&nvdsanalytics->analytic_mutex);
 
   /* This quark is required to identify NvDsMeta when iterating through
@@ -224,8 +253,13 @@ gst_nvdsanalytics_finalize (GObject * object)
 
   nvdsanalytics->stream_analytics_info->clear ();
   nvdsanalytics->stream_analytics_ctx->clear ();
+  nvdsanalytics->stream_analytics_state->clear ();
+  nvdsanalytics->stream_osd_template->clear ();
   delete[]nvdsanalytics->stream_analytics_info;
   delete[]nvdsanalytics->stream_analytics_ctx;
+  delete[]nvdsanalytics->stream_analytics_state;
+  delete[]nvdsanalytics->stream_osd_template;
+  nvdsanalytics_meta_pool_unref (nvdsanalytics->meta_pool);
   g_mutex_clear (&nvdsanalytics->analytic_mutex);
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -253,24 +287,45 @@ gst_nvdsanalytics_set_property (GObject * object, guint prop_id,
       /* Parse the initialization parameters from the config file. This function
         * gives preference to values set through the set_property function over
         * the values set in the config file. */
-      if (g_str_has_suffix(nvdsanalytics->config_file_path, ".yml") ||
-          g_str_has_suffix(nvdsanalytics->config_file_path, ".yaml"))
-      {
-          nvdsanalytics->config_file_parse_successful =
-                nvdsanalytics_parse_yaml_config_file (nvdsanalytics,
-                nvdsanalytics->config_file_path);
+      /* A compiled cache of this exact config skips the text parse. */
+      if (nvdsanalytics->config_cache &&
+          nvdsanalytics_load_config_cache (nvdsanalytics,
+              nvdsanalytics->config_file_path)) {
+          nvdsanalytics->config_file_parse_successful = TRUE;
       } else {
-          nvdsanalytics->config_file_parse_successful =
-                nvdsanalytics_parse_config_file (nvdsanalytics,
+        if (g_str_has_suffix(nvdsanalytics->config_file_path, ".yml") ||
+            g_str_has_suffix(nvdsanalytics->config_file_path, ".yaml"))
+        {
+            nvdsanalytics->config_file_parse_successful =
+                  nvdsanalytics_parse_yaml_config_file (nvdsanalytics,
+                  nvdsanalytics->config_file_path);
+        } else {
+            nvdsanalytics->config_file_parse_successful =
+                  nvdsanalytics_parse_config_file (nvdsanalytics,
+                  nvdsanalytics->config_file_path);
+        }
+        /* Saving compiles the zones of the new config into the new state */
+        if (nvdsanalytics->config_file_parse_successful) {
+          nvdsanalytics->stream_analytics_state->clear();
+          if (nvdsanalytics->config_cache)
+            nvdsanalytics_save_config_cache (nvdsanalytics,
                 nvdsanalytics->config_file_path);
+        }
       }
 
       if (nvdsanalytics->config_file_parse_successful){
         nvdsanalytics->stream_analytics_ctx->clear();
+        nvdsanalytics->stream_osd_template->clear();
       }
       g_mutex_unlock (&nvdsanalytics->analytic_mutex);
     }
 
+      break;
+    case PROP_CONFIG_CACHE:
+      nvdsanalytics->config_cache = g_value_get_boolean (value);
+      break;
+    case PROP_DISPLAY_META:
+      nvdsanalytics->display_meta = g_value_get_boolean (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -297,6 +352,12 @@ gst_nvdsanalytics_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_FILE:
       g_value_set_string (value, nvdsanalytics->config_file_path);
       break;
+    case PROP_CONFIG_CACHE:
+      g_value_set_boolean (value, nvdsanalytics->config_cache);
+      break;
+    case PROP_DISPLAY_META:
+      g_value_set_boolean (value, nvdsanalytics->display_meta);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -462,7 +523,8 @@ gst_nvdsanalytics_transform_ip (GstBaseTransform * btrans, GstBuffer * inbuf)
     }
     // stream_analytics_ctx[frame_meta->pad_index]->processSource (process_params);
 
-    processSource (process_params, stream_analytics_info[frame_meta->pad_index]);
+    processSource (process_params, stream_analytics_info[frame_meta->pad_index],
+        (*nvdsanalytics->stream_analytics_state)[frame_meta->pad_index]);
 
     cnt = 0;
     //FIXME: Assumes no meta reordering
@@ -496,8 +558,8 @@ copy_obj_nvdsanalytics_meta (gpointer data, gpointer user_data)
   NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
   NvDsAnalyticsObjInfo *src_user_metadata =
       (NvDsAnalyticsObjInfo *) user_meta->user_meta_data;
-  NvDsAnalyticsObjInfo *dst_user_metadata = new NvDsAnalyticsObjInfo[1];
-  *dst_user_metadata = *src_user_metadata;
+  NvDsAnalyticsObjInfo *dst_user_metadata =
+      nvdsanalytics_meta_pool_copy_obj (src_user_metadata);
   return (gpointer) dst_user_metadata;
 }
 
@@ -508,7 +570,7 @@ release_obj_nvdsanalytics_meta (gpointer data, gpointer user_data)
   NvDsAnalyticsObjInfo *user_meta_data =
       (NvDsAnalyticsObjInfo *) user_meta->user_meta_data;
   if (user_meta_data) {
-    delete[]user_meta_data;
+    nvdsanalytics_meta_pool_release_obj (user_meta_data);
     user_meta->user_meta_data = NULL;
   }
 }
@@ -516,7 +578,7 @@ release_obj_nvdsanalytics_meta (gpointer data, gpointer user_data)
 #define CHECK_AQUIRE_USER_OBJ_META \
    if (user_meta == NULL) { \
       user_meta = nvds_acquire_user_meta_from_pool(batch_meta); \
-      user_obj_meta = new NvDsAnalyticsObjInfo[1];\
+      user_obj_meta = nvdsanalytics_meta_pool_acquire_obj (nvdsanalytics->meta_pool);\
       user_meta->user_meta_data = (void*)user_obj_meta; \
       user_meta->base_meta.meta_type = user_meta_type; \
       user_meta->base_meta.copy_func =  (NvDsMetaCopyFunc)copy_obj_nvdsanalytics_meta;\
@@ -548,8 +610,8 @@ copy_frame_nvdsanalytics_meta (gpointer data, gpointer user_data)
   NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
   NvDsAnalyticsFrameMeta *src_user_metadata =
       (NvDsAnalyticsFrameMeta *) user_meta->user_meta_data;
-  NvDsAnalyticsFrameMeta *dst_user_metadata = new NvDsAnalyticsFrameMeta[1];
-  *dst_user_metadata = *src_user_metadata;
+  NvDsAnalyticsFrameMeta *dst_user_metadata =
+      nvdsanalytics_meta_pool_copy_frame (src_user_metadata);
   return (gpointer) dst_user_metadata;
 }
 
@@ -560,7 +622,7 @@ release_frame_nvdsanalytics_meta (gpointer data, gpointer user_data)
   NvDsAnalyticsFrameMeta *user_meta_data =
       (NvDsAnalyticsFrameMeta *) user_meta->user_meta_data;
   if (user_meta_data) {
-    delete[]user_meta_data;
+    nvdsanalytics_meta_pool_release_frame (user_meta_data);
     user_meta->user_meta_data = NULL;
   }
 }
@@ -568,7 +630,7 @@ release_frame_nvdsanalytics_meta (gpointer data, gpointer user_data)
 #define CHECK_AQUIRE_USER_FRAME_META \
    if (user_meta == NULL) { \
       user_meta = nvds_acquire_user_meta_from_pool(batch_meta); \
-      user_frame_meta = new NvDsAnalyticsFrameMeta[1];\
+      user_frame_meta = nvdsanalytics_meta_pool_acquire_frame (nvdsanalytics->meta_pool);\
       user_meta->user_meta_data = (void*)user_frame_meta; \
       user_meta->base_meta.meta_type = user_meta_type; \
       user_meta->base_meta.copy_func =  (NvDsMetaCopyFunc)copy_frame_nvdsanalytics_meta;\
@@ -609,341 +671,266 @@ get_arrow_head (gint x1, gint y1,
 
 
 static void
-attach_framemeta_analytics_metadata (GstNvDsAnalytics * nvdsanalytics,
-    NvDsFrameMeta * frame_meta, NvDsAnalyticProcessParams & process_params,
-    gint stream_id)
+append_osd_line (NvDsAnalyticsOsdTemplate & tmpl, gint x1, gint y1,
+    gint x2, gint y2, NvOSD_ColorParams color)
 {
-  NvDsBatchMeta *batch_meta = frame_meta->base_meta.batch_meta;
-  std::unordered_map < int, StreamInfo > &stream_analytics_info =
-      *(nvdsanalytics->stream_analytics_info);
-  NvDsDisplayMeta *display_meta = NULL;
-  NvOSD_TextParams *txt_params = NULL;
-  NvOSD_LineParams *line_params = NULL;
-  NvDsUserMeta *user_meta = NULL;
-  NvDsAnalyticsFrameMeta *user_frame_meta = NULL;
-  NvDsMetaType user_meta_type = NVDS_USER_FRAME_META_NVDSANALYTICS;
-  std::stringstream str_obj_cnt;
-
-  nvds_acquire_meta_lock (batch_meta);
+  NvOSD_LineParams line_params;
+  memset (&line_params, 0, sizeof (line_params));
+  line_params.x1 = x1;
+  line_params.y1 = y1;
+  line_params.x2 = x2;
+  line_params.y2 = y2;
+  line_params.line_width = 2;
+  line_params.line_color = color;
+  tmpl.lines.push_back (line_params);
+}
 
-  CHECK_AQUIRE_USER_FRAME_META;
-  if (user_frame_meta) {
-    user_frame_meta->objCnt = process_params.objCnt;
-    if (nvdsanalytics->display_obj_cnt) {
-      std::map < uint32_t, uint32_t > ordObjCnt (begin (process_params.objCnt),
-          end (process_params.objCnt));
-      str_obj_cnt << "Count for";
-    for (auto & each_cls_cnt:ordObjCnt) {
-        str_obj_cnt << " ClassId" << each_cls_cnt.first <<
-            "=" << each_cls_cnt.second;
-      }
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      txt_params = GET_TEXT_PARAMS;
-      txt_params->display_text =
-          (gchar *) g_malloc0 (str_obj_cnt.str ().size () + 1);
-      snprintf (txt_params->display_text, str_obj_cnt.str ().size () + 1, "%s",
-          str_obj_cnt.str ().c_str ());
-      txt_params->x_offset = 5;
-      txt_params->y_offset = 5;
-
-      /* Font , font-color and font-size */
-      txt_params->font_params = (NvOSD_FontParams) {
-        (gchar *) "Serif", nvdsanalytics->font_size, {
-        1.0, 1.0, 0.0, 1.0}
-      };
-      txt_params->set_bg_clr = 1;
-      txt_params->text_bg_clr = (NvOSD_ColorParams) {
-      0.0, 0.0, 0, 1.0};
-      display_meta->num_labels++;
-    }
+/* Closed outline of a zone */
+static void
+append_osd_polygon (NvDsAnalyticsOsdTemplate & tmpl,
+    const std::vector < std::pair < int, int >>&pts, NvOSD_ColorParams color)
+{
+  for (gsize i = 0; i < pts.size (); i++) {
+    const std::pair < int, int >&next = pts[(i + 1) % pts.size ()];
+    append_osd_line (tmpl, pts[i].first, pts[i].second, next.first,
+        next.second, color);
   }
-  int roi_counter = 1; // Initialize counter to grab ROI
-for (auto & roi:stream_analytics_info[stream_id].roi_info) {
-    if (!roi.enable)
-      continue;
-    guint icnt = 0;
-    txt_params = NULL;
-    CHECK_AQUIRE_USER_FRAME_META;
-    if (user_frame_meta)
-      user_frame_meta->objInROIcnt[roi.roi_label] =
-          process_params.objInROIcnt[roi.roi_label + std::to_string(roi_counter)];
-
-    if (nvdsanalytics->osd_mode) {
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      txt_params = GET_TEXT_PARAMS;
-      txt_params->display_text = (gchar *) g_malloc0 (MAX_LABEL_SIZE);
-      //display only label
-      std::string ZONE = "zone";
-      if (nvdsanalytics->osd_mode == 2)
-        snprintf (txt_params->display_text, MAX_LABEL_SIZE, "%s %d",
-            ZONE.c_str (), roi_counter);
-      else
-        snprintf (txt_params->display_text, MAX_LABEL_SIZE, "%s",
-            roi.roi_label.c_str ());
-
-      /* Now set the offsets where the string should appear */
-      txt_params->x_offset = roi.roi_pts[0].first;
-      txt_params->y_offset = roi.roi_pts[1].second;
-
-      /* Font , font-color and font-size */
-      txt_params->font_params = (NvOSD_FontParams) {
-        (gchar *) "Serif", nvdsanalytics->font_size, {
-        1.0, 1.0, 0.0, 1.0}
-      };
-      txt_params->set_bg_clr = 1;
-      txt_params->text_bg_clr = (NvOSD_ColorParams) {
-      0.0, 0.0, 0, 1.0};
-      display_meta->num_labels++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
+}
 
-      for (icnt = 1; icnt < roi.roi_pts.size (); icnt++) {
-        line_params = GET_LINE_PARAMS;
-        line_params->x1 = roi.roi_pts[icnt - 1].first;
-        line_params->y1 = roi.roi_pts[icnt - 1].second;
-        line_params->x2 = roi.roi_pts[icnt].first;
-        line_params->y2 = roi.roi_pts[icnt].second;
-        line_params->line_color = (NvOSD_ColorParams) {
-        1.0, 1.0, 0, 1.0};
-        line_params->line_width = 2;
-        display_meta->num_lines++;
-        CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      }
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = roi.roi_pts[icnt - 1].first;
-      line_params->y1 = roi.roi_pts[icnt - 1].second;
-      line_params->x2 = roi.roi_pts[0].first;
-      line_params->y2 = roi.roi_pts[0].second;
-      line_params->line_color = (NvOSD_ColorParams) {
-      1.0, 1.0, 0, 1.0};
-      line_params->line_width = 2;
-      display_meta->num_lines++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-    }
-    roi_counter++;
-  }
+/* Line from (x1, y1) to (x2, y2) with its head at (x2, y2) */
+static void
+append_osd_arrow (NvDsAnalyticsOsdTemplate & tmpl, gint x1, gint y1,
+    gint x2, gint y2, NvOSD_ColorParams color)
+{
+  gint x3, y3, x4, y4;
 
-for (auto & roi:stream_analytics_info[stream_id].overcrowding_info) {
-    if (!roi.enable)
-      continue;
-    guint icnt = 0;
-    CHECK_AQUIRE_USER_FRAME_META;
-
-    if (user_frame_meta) {
-      user_frame_meta->ocStatus[roi.oc_label] =
-          process_params.ocStatus[roi.oc_label].overCrowding;
-      user_frame_meta->objInROIcnt[roi.oc_label] =
-          process_params.ocStatus[roi.oc_label].overCrowdingCount;
-    }
+  get_arrow_head (x1, y1, x2, y2, x3, y3, x4, y4);
+  append_osd_line (tmpl, x1, y1, x2, y2, color);
+  append_osd_line (tmpl, x3, y3, x2, y2, color);
+  append_osd_line (tmpl, x4, y4, x2, y2, color);
+}
 
-    if (nvdsanalytics->osd_mode) {
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      txt_params = GET_TEXT_PARAMS;
-      txt_params->display_text = (gchar *) g_malloc0 (MAX_LABEL_SIZE);
-
-      if (nvdsanalytics->osd_mode == 2) {
-        if (process_params.ocStatus[roi.oc_label].overCrowding)
-          snprintf (txt_params->display_text, MAX_LABEL_SIZE,
-              "%s OverCrowding=True, Count=%d", roi.oc_label.c_str (),
-              process_params.ocStatus[roi.oc_label].overCrowdingCount);
-        else
-          snprintf (txt_params->display_text, MAX_LABEL_SIZE,
-              "%s OverCrowding=False, Count=%d", roi.oc_label.c_str (),
-              process_params.ocStatus[roi.oc_label].overCrowdingCount);
-      } else
-        snprintf (txt_params->display_text, MAX_LABEL_SIZE, "%s",
-            roi.oc_label.c_str ());
-      /* Now set the offsets where the string should appear */
-      txt_params->x_offset = roi.roi_pts[0].first;
-      txt_params->y_offset = roi.roi_pts[1].second;
-      /* Font , font-color and font-size */
-      txt_params->font_params = (NvOSD_FontParams) {
-        (gchar *) "Serif", nvdsanalytics->font_size, {
-        1.0, 0.5, 0.0, 1.0}
-      };
-      txt_params->set_bg_clr = 1;
-      txt_params->text_bg_clr = (NvOSD_ColorParams) {
-      0.0, 0.0, 0, 1.0};
-      display_meta->num_labels++;
+static void
+append_osd_label (GstNvDsAnalytics * nvdsanalytics,
+    NvDsAnalyticsOsdTemplate & tmpl, gint x, gint y, NvOSD_ColorParams color,
+    NvDsAnalyticsOsdLabelKind kind, const std::string & text)
+{
+  NvDsAnalyticsOsdLabel label;
+  memset (&label.params, 0, sizeof (label.params));
+  label.params.x_offset = x;
+  label.params.y_offset = y;
+  /* Font , font-color and font-size */
+  label.params.font_params = (NvOSD_FontParams) {
+    (gchar *) "Serif", nvdsanalytics->font_size, color
+  };
+  label.params.set_bg_clr = 1;
+  label.params.text_bg_clr = (NvOSD_ColorParams) {
+  0.0, 0.0, 0, 1.0};
+  label.kind = kind;
+  label.text = text;
+  tmpl.labels.push_back (label);
+}
 
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
+/* The zone geometry only changes with the config, so the outlines, arrows
+ * and label placement of a stream are built once and copied per frame */
+static void
+build_osd_template (GstNvDsAnalytics * nvdsanalytics,
+    StreamInfo & stream_info, NvDsAnalyticsOsdTemplate & tmpl)
+{
+  const NvOSD_ColorParams roi_color = { 1.0, 1.0, 0.0, 1.0 };
+  const NvOSD_ColorParams oc_color = { 1.0, 0.5, 0.0, 1.0 };
+  const NvOSD_ColorParams dir_color = { 1.0, 0.0, 0.0, 1.0 };
+  const NvOSD_ColorParams lc_color = { 0.0, 1.0, 0.0, 1.0 };
+  gchar text[MAX_LABEL_SIZE];
+  int roi_counter = 1; // Zone number shown on the OSD
+
+  tmpl.lines.clear ();
+  tmpl.labels.clear ();
+
+  for (auto & roi:stream_info.roi_info) {
+    if (!roi.enable || roi.roi_pts.size () < 2)
+      continue;
+    //display only label
+    if (nvdsanalytics->osd_mode == 2)
+      snprintf (text, MAX_LABEL_SIZE, "zone %d", roi_counter);
+    else
+      snprintf (text, MAX_LABEL_SIZE, "%s", roi.roi_label.c_str ());
+    append_osd_label (nvdsanalytics, tmpl, roi.roi_pts[0].first,
+        roi.roi_pts[1].second, roi_color, OSD_LABEL_STATIC, text);
+    append_osd_polygon (tmpl, roi.roi_pts, roi_color);
+    roi_counter++;
+  }
 
-      for (icnt = 1; icnt < roi.roi_pts.size (); icnt++) {
-        line_params = GET_LINE_PARAMS;
-        line_params->x1 = roi.roi_pts[icnt - 1].first;
-        line_params->y1 = roi.roi_pts[icnt - 1].second;
-        line_params->x2 = roi.roi_pts[icnt].first;
-        line_params->y2 = roi.roi_pts[icnt].second;
-        line_params->line_color = (NvOSD_ColorParams) {
-        1.0, 0.5, 0, 1.0};
-        line_params->line_width = 2;
-        display_meta->num_lines++;
-        CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      }
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = roi.roi_pts[icnt - 1].first;
-      line_params->y1 = roi.roi_pts[icnt - 1].second;
-      line_params->x2 = roi.roi_pts[0].first;
-      line_params->y2 = roi.roi_pts[0].second;
-      line_params->line_color = (NvOSD_ColorParams) {
-      1.0, 0.5, 0, 1.0};
-      line_params->line_width = 2;
-      display_meta->num_lines++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-    }
+  for (auto & roi:stream_info.overcrowding_info) {
+    if (!roi.enable || roi.roi_pts.size () < 2)
+      continue;
+    append_osd_label (nvdsanalytics, tmpl, roi.roi_pts[0].first,
+        roi.roi_pts[1].second, oc_color,
+        nvdsanalytics->osd_mode == 2 ? OSD_LABEL_OC : OSD_LABEL_STATIC,
+        roi.oc_label);
+    append_osd_polygon (tmpl, roi.roi_pts, oc_color);
   }
 
-for (auto & roi:stream_analytics_info[stream_id].direction_info) {
-    gint x3, y3, x4, y4;
+  for (auto & roi:stream_info.direction_info) {
     if (!roi.enable)
       continue;
+    append_osd_label (nvdsanalytics, tmpl, roi.x1y1.first, roi.x1y1.second,
+        dir_color, OSD_LABEL_STATIC, roi.dir_label);
+    append_osd_arrow (tmpl, roi.x1y1.first, roi.x1y1.second,
+        roi.x2y2.first, roi.x2y2.second, dir_color);
+  }
 
-    if (nvdsanalytics->osd_mode) {
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      txt_params = GET_TEXT_PARAMS;
-      txt_params->display_text = (gchar *) g_malloc0 (MAX_LABEL_SIZE);
-      snprintf (txt_params->display_text, MAX_LABEL_SIZE, "%s",
-          roi.dir_label.c_str ());
-      /* Now set the offsets where the string should appear */
-      txt_params->x_offset = roi.x1y1.first;
-      txt_params->y_offset = roi.x1y1.second;
-      /* Font , font-color and font-size */
-      txt_params->font_params = (NvOSD_FontParams) {
-        (gchar *) "Serif", nvdsanalytics->font_size, {
-        1.0, 0.0, 0.0, 1.0}
-      };
-      txt_params->set_bg_clr = 1;
-      txt_params->text_bg_clr = (NvOSD_ColorParams) {
-      0.0, 0.0, 0, 1.0};
-      display_meta->num_labels++;
+  for (auto & roi:stream_info.linecrossing_info) {
+    if (!roi.enable || roi.lcdir_pts.size () < 4)
+      continue;
+    if (nvdsanalytics->osd_mode == 2)
+      append_osd_label (nvdsanalytics, tmpl, roi.lcdir_pts[3].first,
+          roi.lcdir_pts[3].second, lc_color, OSD_LABEL_LC, roi.lc_label);
+    else
+      append_osd_label (nvdsanalytics, tmpl, roi.lcdir_pts[3].first,
+          roi.lcdir_pts[3].second, lc_color, OSD_LABEL_STATIC,
+          roi.lc_label + " ");
+    append_osd_arrow (tmpl, roi.lcdir_pts[0].first, roi.lcdir_pts[0].second,
+        roi.lcdir_pts[1].first, roi.lcdir_pts[1].second, lc_color);
+    append_osd_line (tmpl, roi.lcdir_pts[2].first, roi.lcdir_pts[2].second,
+        roi.lcdir_pts[3].first, roi.lcdir_pts[3].second, lc_color);
+  }
+  tmpl.built = TRUE;
+}
 
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = roi.x1y1.first;
-      line_params->y1 = roi.x1y1.second;
-      line_params->x2 = roi.x2y2.first;
-      line_params->y2 = roi.x2y2.second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      1.0, 0.0, 0, 1.0};
-      display_meta->num_lines++;
+/* "Count for ClassId0=3 ClassId2=1", classes in ascending order. The
+ * scratch vectors of the template keep their capacity across frames. */
+static const gchar *
+format_obj_cnt (NvDsAnalyticsOsdTemplate & tmpl,
+    NvDsAnalyticProcessParams & process_params)
+{
+  gchar cls_cnt[64];
+
+  tmpl.class_cnt.assign (process_params.objCnt.begin (),
+      process_params.objCnt.end ());
+  std::sort (tmpl.class_cnt.begin (), tmpl.class_cnt.end ());
+  tmpl.obj_cnt_text.assign ("Count for");
+  for (auto & each_cls_cnt:tmpl.class_cnt) {
+    snprintf (cls_cnt, sizeof (cls_cnt), " ClassId%d=%u", each_cls_cnt.first,
+        each_cls_cnt.second);
+    tmpl.obj_cnt_text.append (cls_cnt);
+  }
+  return tmpl.obj_cnt_text.c_str ();
+}
 
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
+static void
+attach_display_meta (GstNvDsAnalytics * nvdsanalytics,
+    NvDsFrameMeta * frame_meta, NvDsAnalyticProcessParams & process_params,
+    NvDsAnalyticsOsdTemplate & tmpl)
+{
+  NvDsBatchMeta *batch_meta = frame_meta->base_meta.batch_meta;
+  NvDsDisplayMeta *display_meta = NULL;
+  NvOSD_TextParams *txt_params = NULL;
+  gchar text[MAX_LABEL_SIZE];
+
+  if (nvdsanalytics->display_obj_cnt) {
+    CHECK_ATTACH_AQUIRE_DISPLAY_META;
+    txt_params = GET_TEXT_PARAMS;
+    memset (txt_params, 0, sizeof (*txt_params));
+    /* display_text is released with g_free by the display meta */
+    txt_params->display_text = g_strdup (format_obj_cnt (tmpl, process_params));
+    txt_params->x_offset = 5;
+    txt_params->y_offset = 5;
+    txt_params->font_params = (NvOSD_FontParams) {
+      (gchar *) "Serif", nvdsanalytics->font_size, {
+      1.0, 1.0, 0.0, 1.0}
+    };
+    txt_params->set_bg_clr = 1;
+    txt_params->text_bg_clr = (NvOSD_ColorParams) {
+    0.0, 0.0, 0, 1.0};
+    display_meta->num_labels++;
+  }
 
-      get_arrow_head (line_params->x1, line_params->y1,
-          line_params->x2, line_params->y2, x3, y3, x4, y4);
-
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = x3;
-      line_params->y1 = y3;
-      line_params->x2 = roi.x2y2.first;
-      line_params->y2 = roi.x2y2.second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      1.0, 0.0, 0, 1.0};
-      display_meta->num_lines++;
+  if (nvdsanalytics->osd_mode) {
+    for (auto & label:tmpl.labels) {
+      const gchar *display_text = label.text.c_str ();
+      if (label.kind == OSD_LABEL_OC) {
+        OverCrowdStatus & oc = process_params.ocStatus[label.text];
+        snprintf (text, MAX_LABEL_SIZE, "%s OverCrowding=%s, Count=%d",
+            label.text.c_str (), oc.overCrowding ? "True" : "False",
+            oc.overCrowdingCount);
+        display_text = text;
+      } else if (label.kind == OSD_LABEL_LC) {
+        snprintf (text, MAX_LABEL_SIZE, "%s=%lu", label.text.c_str (),
+            process_params.objLCCumCnt[label.text]);
+        display_text = text;
+      }
       CHECK_ATTACH_AQUIRE_DISPLAY_META;
+      txt_params = GET_TEXT_PARAMS;
+      *txt_params = label.params;
+      txt_params->display_text = g_strdup (display_text);
+      display_meta->num_labels++;
+    }
 
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = x4;
-      line_params->y1 = y4;
-      line_params->x2 = roi.x2y2.first;
-      line_params->y2 = roi.x2y2.second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      1.0, 0.0, 0, 1.0};
-      display_meta->num_lines++;
+    for (gsize i = 0; i < tmpl.lines.size ();) {
       CHECK_ATTACH_AQUIRE_DISPLAY_META;
+      gsize n = MIN (tmpl.lines.size () - i,
+          (gsize) (MAX_ELEMENTS_IN_DISPLAY_META - 1 - display_meta->num_lines));
+      memcpy (GET_LINE_PARAMS, &tmpl.lines[i], n * sizeof (NvOSD_LineParams));
+      display_meta->num_lines += n;
+      i += n;
     }
   }
 
-for (auto & roi:stream_analytics_info[stream_id].linecrossing_info) {
-    gint x3, y3, x4, y4;
-    if (!roi.enable)
-      continue;
+  ATTACH_DISPLAY_META;
+}
 
-    CHECK_AQUIRE_USER_FRAME_META;
-    if (user_frame_meta) {
-      user_frame_meta->objLCCurrCnt[roi.lc_label] =
-          process_params.objLCCurrCnt[roi.lc_label];
-      user_frame_meta->objLCCumCnt[roi.lc_label] =
-          process_params.objLCCumCnt[roi.lc_label];
-    }
+static void
+attach_framemeta_analytics_metadata (GstNvDsAnalytics * nvdsanalytics,
+    NvDsFrameMeta * frame_meta, NvDsAnalyticProcessParams & process_params,
+    gint stream_id)
+{
+  NvDsBatchMeta *batch_meta = frame_meta->base_meta.batch_meta;
+  StreamInfo & stream_info = (*nvdsanalytics->stream_analytics_info)[stream_id];
+  NvDsUserMeta *user_meta = NULL;
+  NvDsAnalyticsFrameMeta *user_frame_meta = NULL;
+  NvDsMetaType user_meta_type = NVDS_USER_FRAME_META_NVDSANALYTICS;
 
-    if (nvdsanalytics->osd_mode) {
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-      txt_params = GET_TEXT_PARAMS;
-      txt_params->display_text = (gchar *) g_malloc0 (MAX_LABEL_SIZE);
-
-      if (nvdsanalytics->osd_mode == 2)
-        snprintf (txt_params->display_text, MAX_LABEL_SIZE, "%s=%lu",
-            roi.lc_label.c_str (), process_params.objLCCumCnt[roi.lc_label]);
-      else
-        snprintf (txt_params->display_text, MAX_LABEL_SIZE, "%s ",
-            roi.lc_label.c_str ());
-
-      /* Now set the offsets where the string should appear */
-      txt_params->x_offset = roi.lcdir_pts[3].first;
-      txt_params->y_offset = roi.lcdir_pts[3].second;
-
-      /* Font , font-color and font-size */
-      txt_params->font_params = (NvOSD_FontParams) {
-        (gchar *) "Serif", nvdsanalytics->font_size, {
-        0.0, 1.0, 0.0, 1.0}
-      };
-      txt_params->set_bg_clr = 1;
-      txt_params->text_bg_clr = (NvOSD_ColorParams) {
-      0.0, 0.0, 0, 1.0};
-      display_meta->num_labels++;
+  nvds_acquire_meta_lock (batch_meta);
 
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = roi.lcdir_pts[0].first;
-      line_params->y1 = roi.lcdir_pts[0].second;
-      line_params->x2 = roi.lcdir_pts[1].first;
-      line_params->y2 = roi.lcdir_pts[1].second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      0.0, 1.0, 0, 1.0};
-      display_meta->num_lines++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
+  CHECK_AQUIRE_USER_FRAME_META;
+  user_frame_meta->objCnt = process_params.objCnt;
 
-      get_arrow_head (line_params->x1, line_params->y1,
-          line_params->x2, line_params->y2, x3, y3, x4, y4);
-
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = x3;
-      line_params->y1 = y3;
-      line_params->x2 = roi.lcdir_pts[1].first;
-      line_params->y2 = roi.lcdir_pts[1].second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      0.0, 1.0, 0, 1.0};
-      display_meta->num_lines++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
+  for (auto & roi:stream_info.roi_info) {
+    if (!roi.enable)
+      continue;
+    user_frame_meta->objInROIcnt[roi.roi_label] =
+        process_params.objInROIcnt[roi.roi_label];
+  }
 
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = x4;
-      line_params->y1 = y4;
-      line_params->x2 = roi.lcdir_pts[1].first;
-      line_params->y2 = roi.lcdir_pts[1].second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      0.0, 1.0, 0, 1.0};
-      display_meta->num_lines++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
+  for (auto & roi:stream_info.overcrowding_info) {
+    if (!roi.enable)
+      continue;
+    user_frame_meta->ocStatus[roi.oc_label] =
+        process_params.ocStatus[roi.oc_label].overCrowding;
+    user_frame_meta->objInROIcnt[roi.oc_label] =
+        process_params.ocStatus[roi.oc_label].overCrowdingCount;
+  }
 
-      line_params = GET_LINE_PARAMS;
-      line_params->x1 = roi.lcdir_pts[2].first;
-      line_params->y1 = roi.lcdir_pts[2].second;
-      line_params->x2 = roi.lcdir_pts[3].first;
-      line_params->y2 = roi.lcdir_pts[3].second;
-      line_params->line_width = 2;
-      line_params->line_color = (NvOSD_ColorParams) {
-      0.0, 1.0, 0, 1.0};
-      display_meta->num_lines++;
-      CHECK_ATTACH_AQUIRE_DISPLAY_META;
-    }
+  for (auto & roi:stream_info.linecrossing_info) {
+    if (!roi.enable)
+      continue;
+    user_frame_meta->objLCCurrCnt[roi.lc_label] =
+        process_params.objLCCurrCnt[roi.lc_label];
+    user_frame_meta->objLCCumCnt[roi.lc_label] =
+        process_params.objLCCumCnt[roi.lc_label];
+  }
+
+  /* Nothing draws the display meta without a downstream OSD */
+  if (nvdsanalytics->display_meta &&
+      (nvdsanalytics->osd_mode || nvdsanalytics->display_obj_cnt)) {
+    NvDsAnalyticsOsdTemplate & tmpl =
+        (*nvdsanalytics->stream_osd_template)[stream_id];
+    if (!tmpl.built)
+      build_osd_template (nvdsanalytics, stream_info, tmpl);
+    attach_display_meta (nvdsanalytics, frame_meta, process_params, tmpl);
   }
 
-  ATTACH_DISPLAY_META;
   ATTACH_USER_FRAME_META;
 
   nvds_release_meta_lock (batch_meta);
@@ -965,7 +952,7 @@ attach_metadata_object (GstNvDsAnalytics * nvdsanalytics,
   CHECK_AQUIRE_USER_OBJ_META;
   nvds_acquire_meta_lock (batch_meta);
   // To display dynamic information
-  if (nvdsanalytics->osd_mode == 2) {
+  if (nvdsanalytics->display_meta && nvdsanalytics->osd_mode == 2) {
     NvOSD_TextParams & text_params = obj_meta->text_params;
     NvOSD_RectParams & rect_params = obj_meta->rect_params;
 
@@ -27,6 +27,7 @@
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include "nvbufsurface.h"
@@ -35,6 +36,7 @@
 #include "nvds_analytics.h"
 #include "nvds_analytics_meta.h"
 #include "process_source.h"
+#include "nvdsanalytics_meta_pool.h"
 
 /* Package and library details required for plugin_init */
 #define PACKAGE "nvdsanalytics"
@@ -45,6 +47,35 @@
 #define URL "http://nvidia.com/"
 
 
+/* How the text of an OSD label is made each frame */
+enum NvDsAnalyticsOsdLabelKind
+{
+  OSD_LABEL_STATIC,             // text as is
+  OSD_LABEL_OC,                 // overcrowding status and count of zone text
+  OSD_LABEL_LC                  // cumulative crossings of line text
+};
+
+struct NvDsAnalyticsOsdLabel
+{
+  NvOSD_TextParams params;      // placement and font, display_text unset
+  NvDsAnalyticsOsdLabelKind kind;
+  std::string text;
+};
+
+/* Display meta of a stream that only depends on the config: zone outlines,
+ * arrows and label placement. Built on the first frame after a config load
+ * and copied into the display meta of every frame. */
+struct NvDsAnalyticsOsdTemplate
+{
+  gboolean built = FALSE;
+  std::vector<NvOSD_LineParams> lines;
+  std::vector<NvDsAnalyticsOsdLabel> labels;
+
+  // Scratch for the object count text, reused across frames
+  std::vector<std::pair<int, uint32_t>> class_cnt;
+  std::string obj_cnt_text;
+};
+
 G_BEGIN_DECLS
 /* Standard boilerplate stuff */
 typedef struct _GstNvDsAnalytics GstNvDsAnalytics;
@@ -89,10 +120,22 @@ struct _GstNvDsAnalytics
   // Config file parsing status for dsanalytics
   gboolean config_file_parse_successful;
 
+  // Load / write the compiled config cache in the user's cache directory
+  gboolean config_cache;
+
   std::unordered_map<gint, StreamInfo> *stream_analytics_info;
 
   std::unordered_map<gint, NvDsAnalyticCtxUptr> *stream_analytics_ctx;
 
+  // Per stream trajectories and counters, keyed like stream_analytics_info
+  std::unordered_map<gint, StreamAnalyticsState> *stream_analytics_state;
+
+  // Per stream static display meta, keyed like stream_analytics_info
+  std::unordered_map<gint, NvDsAnalyticsOsdTemplate> *stream_osd_template;
+
+  // Recycled analytics user meta, may outlive the element
+  NvDsAnalyticsMetaPool *meta_pool;
+
   GMutex analytic_mutex;
 
   gboolean enable;
@@ -107,6 +150,9 @@ struct _GstNvDsAnalytics
   guint obj_cnt_win_in_ms;
 
   gboolean display_obj_cnt;
+
+  // Attach display meta and object labels for a downstream OSD
+  gboolean display_meta;
 };
 
 // Boiler plate stuff
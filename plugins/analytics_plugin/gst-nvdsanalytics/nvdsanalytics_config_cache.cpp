@@ -0,0 +1,580 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2020-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include "nvdsanalytics_config_cache.h"
+
+GST_DEBUG_CATEGORY (NVDSANALYTICS_CFG_CACHE_CAT);
+
+/* Bump whenever the layout below, one of the config structs or the way
+ * zones are rasterised changes */
+#define CONFIG_CACHE_MAGIC "DSANCFG"
+#define CONFIG_CACHE_VERSION 3
+
+/* The file is this header followed by payload_size bytes of payload. The
+ * payload is the property group, then per stream its zones, lines and
+ * directions followed by the compiled zone raster and grid, every field in
+ * native byte order. The source checksum covers the contents of the text
+ * config, so an edit that keeps its size and modification second still
+ * invalidates the cache; the payload checksum catches a cache damaged on
+ * disk before the reader bounds checks every field. */
+typedef struct {
+  gchar magic[8];
+  guint32 version;
+  guint32 header_size;
+  guint64 source_size;       // of the text config the cache was compiled from
+  guint64 source_checksum;
+  guint64 payload_size;
+  guint64 payload_checksum;
+} ConfigCacheHeader;
+
+/* FNV-1a, enough to tell an edited config or a damaged cache apart */
+static guint64
+config_cache_checksum (const guint8 *data, gsize size)
+{
+  guint64 hash = G_GUINT64_CONSTANT (0xcbf29ce484222325);
+  for (gsize i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= G_GUINT64_CONSTANT (0x100000001b3);
+  }
+  return hash;
+}
+
+static void
+init_debug_category (void)
+{
+  if (!NVDSANALYTICS_CFG_CACHE_CAT) {
+    GST_DEBUG_CATEGORY_INIT (NVDSANALYTICS_CFG_CACHE_CAT, "nvdsanalytics_cache", 0,
+        "nvdsanalytics compiled config cache");
+  }
+}
+
+/* <user cache dir>/nvdsanalytics/<SHA-1 of the absolute config path>.cache */
+static gchar *
+config_cache_path (const gchar *cfg_file_path)
+{
+  gchar *source = g_canonicalize_filename (cfg_file_path, NULL);
+  gchar *name = g_compute_checksum_for_string (G_CHECKSUM_SHA1, source, -1);
+  gchar *file = g_strconcat (name, NVDSANALYTICS_CONFIG_CACHE_SUFFIX, NULL);
+  gchar *path = g_build_filename (g_get_user_cache_dir (),
+      NVDSANALYTICS_CONFIG_CACHE_DIR, file, NULL);
+  g_free (file);
+  g_free (name);
+  g_free (source);
+  return path;
+}
+
+/* Writer */
+
+template <typename T>
+static void
+put (std::string &out, T value)
+{
+  out.append ((const gchar *) &value, sizeof (value));
+}
+
+static void
+put_string (std::string &out, const std::string &value)
+{
+  put<guint32> (out, value.size ());
+  out.append (value);
+}
+
+static void
+put_ints (std::string &out, const std::vector<int> &values)
+{
+  put<guint32> (out, values.size ());
+  out.append ((const gchar *) values.data (), values.size () * sizeof (int));
+}
+
+static void
+put_points (std::string &out, const std::vector<std::pair<int, int>> &points)
+{
+  put<guint32> (out, points.size ());
+  for (const std::pair<int, int> &p : points) {
+    put<gint32> (out, p.first);
+    put<gint32> (out, p.second);
+  }
+}
+
+static void
+put_u32s (std::string &out, const std::vector<guint32> &values)
+{
+  put<guint32> (out, values.size ());
+  out.append ((const gchar *) values.data (), values.size () * sizeof (guint32));
+}
+
+/* The zone raster as runs of equal pixels per row, then the grid */
+static void
+put_zones (std::string &out, const StreamAnalyticsState &state)
+{
+  const cv::Mat &labels = state.zone_labels;
+  put<gint32> (out, labels.rows);
+  put<gint32> (out, labels.cols);
+  for (gint y = 0; y < labels.rows; y++) {
+    const guint32 *row = labels.ptr<guint32> (y);
+    gsize count_at = out.size ();
+    guint32 runs = 0;
+    put<guint32> (out, 0);
+    for (gint x = 0; x < labels.cols; runs++) {
+      gint start = x;
+      while (x < labels.cols && row[x] == row[start])
+        x++;
+      put<guint32> (out, x - start);
+      put<guint32> (out, row[start]);
+    }
+    memcpy (&out[count_at], &runs, sizeof (runs));
+  }
+
+  ZoneGrid::Layout grid = state.zone_grid.layout ();
+  put<gint32> (out, grid.cols);
+  put<gint32> (out, grid.rows);
+  put<guint32> (out, grid.boxes.size ());
+  for (const ZoneBox &box : grid.boxes) {
+    put<gint32> (out, box.x0);
+    put<gint32> (out, box.y0);
+    put<gint32> (out, box.x1);
+    put<gint32> (out, box.y1);
+  }
+  put_u32s (out, grid.cell_offsets);
+  put_u32s (out, grid.cell_zones);
+}
+
+static void
+put_stream (std::string &out, gint stream_id, const StreamInfo &info)
+{
+  put<gint32> (out, stream_id);
+  put<gint32> (out, info.config_width);
+  put<gint32> (out, info.config_height);
+
+  put<guint32> (out, info.roi_info.size ());
+  for (const ROIInfo &roi : info.roi_info) {
+    put<guint8> (out, roi.enable);
+    put<guint8> (out, roi.inverse_roi);
+    put<gint32> (out, roi.stream_id);
+    put_string (out, roi.roi_label);
+    put_points (out, roi.roi_pts);
+    put_ints (out, roi.operate_on_class);
+  }
+
+  put<guint32> (out, info.overcrowding_info.size ());
+  for (const OverCrowdingInfo &oc : info.overcrowding_info) {
+    put<guint8> (out, oc.enable);
+    put<gint32> (out, oc.stream_id);
+    put<gint32> (out, oc.time_threshold_in_ms);
+    put<gint32> (out, oc.object_threshold);
+    put_string (out, oc.oc_label);
+    put_points (out, oc.roi_pts);
+    put_ints (out, oc.operate_on_class);
+  }
+
+  put<guint32> (out, info.linecrossing_info.size ());
+  for (const LineCrossingInfo &lc : info.linecrossing_info) {
+    put<guint8> (out, lc.enable);
+    put<guint8> (out, lc.extended);
+    put<gint32> (out, lc.stream_id);
+    put<gint32> (out, (gint32) lc.mode);
+    put<gint32> (out, (gint32) lc.mode_dir);
+    put_string (out, lc.lc_label);
+    put_points (out, lc.lcdir_pts);
+    put_ints (out, lc.operate_on_class);
+  }
+
+  put<guint32> (out, info.direction_info.size ());
+  for (const DirectionInfo &dir : info.direction_info) {
+    put<guint8> (out, dir.enable);
+    put<gint32> (out, dir.stream_id);
+    put<gint32> (out, (gint32) dir.mode);
+    put_string (out, dir.dir_label);
+    put<gint32> (out, dir.x1y1.first);
+    put<gint32> (out, dir.x1y1.second);
+    put<gint32> (out, dir.x2y2.first);
+    put<gint32> (out, dir.x2y2.second);
+    put_ints (out, dir.operate_on_class);
+  }
+}
+
+/* Reader over the mapped payload. Every read is bounds checked, a short or
+ * inconsistent payload makes the whole cache stale. */
+
+typedef struct {
+  const guint8 *pos;
+  const guint8 *end;
+  gboolean ok;
+} ConfigCacheReader;
+
+template <typename T>
+static T
+get (ConfigCacheReader &in)
+{
+  T value = T ();
+  if (in.ok && (gsize) (in.end - in.pos) >= sizeof (T)) {
+    memcpy (&value, in.pos, sizeof (T));
+    in.pos += sizeof (T);
+  } else {
+    in.ok = FALSE;
+  }
+  return value;
+}
+
+/* Element count of a list of item_size byte entries, 0 if it would overrun */
+static guint32
+get_count (ConfigCacheReader &in, gsize item_size)
+{
+  guint32 count = get<guint32> (in);
+  if ((gsize) (in.end - in.pos) / item_size < count) {
+    in.ok = FALSE;
+    return 0;
+  }
+  return count;
+}
+
+static void
+get_string (ConfigCacheReader &in, std::string &value)
+{
+  guint32 size = get_count (in, 1);
+  value.assign ((const gchar *) in.pos, size);
+  in.pos += size;
+}
+
+static void
+get_ints (ConfigCacheReader &in, std::vector<int> &values)
+{
+  guint32 count = get_count (in, sizeof (int));
+  values.resize (count);
+  if (count)
+    memcpy (values.data (), in.pos, count * sizeof (int));
+  in.pos += count * sizeof (int);
+}
+
+static void
+get_points (ConfigCacheReader &in, std::vector<std::pair<int, int>> &points)
+{
+  guint32 count = get_count (in, 2 * sizeof (gint32));
+  points.clear ();
+  points.reserve (count);
+  for (guint32 i = 0; i < count; i++) {
+    gint32 x = get<gint32> (in);
+    points.push_back (std::make_pair (x, (int) get<gint32> (in)));
+  }
+}
+
+template <typename E>
+static E
+get_enum (ConfigCacheReader &in, gint32 last)
+{
+  gint32 value = get<gint32> (in);
+  if (value < 0 || value > last)
+    in.ok = FALSE;
+  return (E) value;
+}
+
+static void
+get_stream (ConfigCacheReader &in, StreamInfo &info)
+{
+  info.config_width = get<gint32> (in);
+  info.config_height = get<gint32> (in);
+
+  info.roi_info.resize (get_count (in, 1));
+  for (ROIInfo &roi : info.roi_info) {
+    roi.enable = get<guint8> (in);
+    roi.inverse_roi = get<guint8> (in);
+    roi.stream_id = get<gint32> (in);
+    get_string (in, roi.roi_label);
+    get_points (in, roi.roi_pts);
+    get_ints (in, roi.operate_on_class);
+  }
+
+  info.overcrowding_info.resize (get_count (in, 1));
+  for (OverCrowdingInfo &oc : info.overcrowding_info) {
+    oc.enable = get<guint8> (in);
+    oc.stream_id = get<gint32> (in);
+    oc.time_threshold_in_ms = get<gint32> (in);
+    oc.object_threshold = get<gint32> (in);
+    get_string (in, oc.oc_label);
+    get_points (in, oc.roi_pts);
+    get_ints (in, oc.operate_on_class);
+  }
+
+  info.linecrossing_info.resize (get_count (in, 1));
+  for (LineCrossingInfo &lc : info.linecrossing_info) {
+    lc.enable = get<guint8> (in);
+    lc.extended = get<guint8> (in);
+    lc.stream_id = get<gint32> (in);
+    lc.mode = get_enum<eMode> (in, (gint32) eMode::loose);
+    lc.mode_dir = get_enum<eModeDir> (in, (gint32) eModeDir::neg_to_pos);
+    get_string (in, lc.lc_label);
+    get_points (in, lc.lcdir_pts);
+    get_ints (in, lc.operate_on_class);
+  }
+
+  info.direction_info.resize (get_count (in, 1));
+  for (DirectionInfo &dir : info.direction_info) {
+    dir.enable = get<guint8> (in);
+    dir.stream_id = get<gint32> (in);
+    dir.mode = get_enum<eMode> (in, (gint32) eMode::loose);
+    get_string (in, dir.dir_label);
+    dir.x1y1.first = get<gint32> (in);
+    dir.x1y1.second = get<gint32> (in);
+    dir.x2y2.first = get<gint32> (in);
+    dir.x2y2.second = get<gint32> (in);
+    get_ints (in, dir.operate_on_class);
+  }
+}
+
+static void
+get_u32s (ConfigCacheReader &in, std::vector<guint32> &values)
+{
+  guint32 count = get_count (in, sizeof (guint32));
+  values.resize (count);
+  if (count)
+    memcpy (values.data (), in.pos, count * sizeof (guint32));
+  in.pos += count * sizeof (guint32);
+}
+
+/* The raster and grid put_zones wrote for info. Every pixel must carry a
+ * label and bits of zones info has, the grid its zones. */
+static void
+get_zones (ConfigCacheReader &in, const StreamInfo &info, StreamAnalyticsState &state)
+{
+  guint32 max_label = streamRois (info);
+  guint32 oc_bits = (1u << streamOcZones (info)) - 1;
+  gint rows = get<gint32> (in);
+  gint cols = get<gint32> (in);
+  if (!in.ok || rows != info.config_height || cols != info.config_width) {
+    in.ok = FALSE;
+    return;
+  }
+
+  cv::Mat labels (rows, cols, CV_32SC1);
+  for (gint y = 0; y < rows && in.ok; y++) {
+    guint32 *row = labels.ptr<guint32> (y);
+    guint32 runs = get_count (in, 2 * sizeof (guint32));
+    guint32 x = 0;
+    for (guint32 i = 0; i < runs; i++) {
+      guint32 length = get<guint32> (in);
+      guint32 value = get<guint32> (in);
+      if (length > (guint32) cols - x || (value & ZONE_ROI_LABEL_MASK) > max_label ||
+          ((value >> ZONE_OC_SHIFT) & ~oc_bits)) {
+        in.ok = FALSE;
+        return;
+      }
+      std::fill (row + x, row + x + length, value);
+      x += length;
+    }
+    if (x != (guint32) cols)
+      in.ok = FALSE;
+  }
+
+  ZoneGrid::Layout grid;
+  grid.cols = get<gint32> (in);
+  grid.rows = get<gint32> (in);
+  grid.boxes.resize (get_count (in, 4 * sizeof (gint32)));
+  for (ZoneBox &box : grid.boxes) {
+    box.x0 = get<gint32> (in);
+    box.y0 = get<gint32> (in);
+    box.x1 = get<gint32> (in);
+    box.y1 = get<gint32> (in);
+  }
+  get_u32s (in, grid.cell_offsets);
+  get_u32s (in, grid.cell_zones);
+  if (!in.ok || grid.boxes.size () != max_label + streamOcZones (info) ||
+      !state.zone_grid.restore (grid, cols, rows)) {
+    in.ok = FALSE;
+    return;
+  }
+  state.zone_labels = labels;
+  state.zones_compiled = TRUE;
+}
+
+/* An edited config changes size or checksum */
+static gboolean
+read_source (const gchar *cfg_file_path, guint64 *size, guint64 *checksum)
+{
+  GMappedFile *source = g_mapped_file_new (cfg_file_path, FALSE, NULL);
+  if (!source)
+    return FALSE;
+  *size = g_mapped_file_get_length (source);
+  *checksum = config_cache_checksum ((const guint8 *)
+      g_mapped_file_get_contents (source), *size);
+  g_mapped_file_unref (source);
+  return TRUE;
+}
+
+gboolean
+nvdsanalytics_load_config_cache (GstNvDsAnalytics *nvdsanalytics, const gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  gchar *cache_path = config_cache_path (cfg_file_path);
+  GMappedFile *cache = NULL;
+  ConfigCacheHeader header;
+  ConfigCacheReader in;
+  guint64 source_size, source_checksum;
+  std::unordered_map<gint, StreamInfo> streams;
+  std::unordered_map<gint, StreamAnalyticsState> states;
+  gint configuration_width, configuration_height;
+  guint32 stream_count;
+
+  init_debug_category ();
+
+  if (!g_file_test (cache_path, G_FILE_TEST_EXISTS))
+    goto done;
+  if (!read_source (cfg_file_path, &source_size, &source_checksum))
+    goto done;
+
+  cache = g_mapped_file_new (cache_path, FALSE, NULL);
+  if (!cache || g_mapped_file_get_length (cache) < sizeof (header)) {
+    GST_CAT_WARNING (NVDSANALYTICS_CFG_CACHE_CAT, "Ignoring unreadable cache %s", cache_path);
+    goto done;
+  }
+
+  memcpy (&header, g_mapped_file_get_contents (cache), sizeof (header));
+  if (memcmp (header.magic, CONFIG_CACHE_MAGIC, sizeof (header.magic)) ||
+      header.version != CONFIG_CACHE_VERSION || header.header_size != sizeof (header)) {
+    GST_CAT_INFO (NVDSANALYTICS_CFG_CACHE_CAT, "Cache %s has another format", cache_path);
+    goto done;
+  }
+  if (header.source_size != source_size || header.source_checksum != source_checksum) {
+    GST_CAT_INFO (NVDSANALYTICS_CFG_CACHE_CAT, "Cache %s is stale", cache_path);
+    goto done;
+  }
+
+  in.pos = (const guint8 *) g_mapped_file_get_contents (cache) + sizeof (header);
+  in.end = in.pos + (g_mapped_file_get_length (cache) - sizeof (header));
+  in.ok = TRUE;
+  if (header.payload_size != (guint64) (in.end - in.pos) ||
+      header.payload_checksum != config_cache_checksum (in.pos, header.payload_size)) {
+    GST_CAT_WARNING (NVDSANALYTICS_CFG_CACHE_CAT, "Ignoring corrupt cache %s", cache_path);
+    goto done;
+  }
+
+  /* Decode everything before touching the element, so a bad cache leaves it
+   * as it was */
+  {
+    gboolean enable = get<guint8> (in);
+    configuration_width = get<gint32> (in);
+    configuration_height = get<gint32> (in);
+    guint font_size = get<guint32> (in);
+    guint osd_mode = get<guint32> (in);
+    guint obj_cnt_win_in_ms = get<guint32> (in);
+    gboolean display_obj_cnt = get<guint8> (in);
+
+    stream_count = get_count (in, 1);
+    for (guint32 i = 0; i < stream_count && in.ok; i++) {
+      gint stream_id = get<gint32> (in);
+      get_stream (in, streams[stream_id]);
+      if (in.ok)
+        get_zones (in, streams[stream_id], states[stream_id]);
+    }
+    if (!in.ok || in.pos != in.end) {
+      GST_CAT_WARNING (NVDSANALYTICS_CFG_CACHE_CAT, "Ignoring corrupt cache %s", cache_path);
+      goto done;
+    }
+
+    nvdsanalytics->enable = enable;
+    nvdsanalytics->configuration_width = configuration_width;
+    nvdsanalytics->configuration_height = configuration_height;
+    nvdsanalytics->font_size = font_size;
+    nvdsanalytics->osd_mode = osd_mode;
+    nvdsanalytics->obj_cnt_win_in_ms = obj_cnt_win_in_ms;
+    nvdsanalytics->display_obj_cnt = display_obj_cnt;
+  }
+  nvdsanalytics->stream_analytics_info->swap (streams);
+  nvdsanalytics->stream_analytics_state->swap (states);
+
+  GST_CAT_INFO (NVDSANALYTICS_CFG_CACHE_CAT, "Loaded %u streams from cache %s",
+      stream_count, cache_path);
+  ret = TRUE;
+
+done:
+  if (cache)
+    g_mapped_file_unref (cache);
+  g_free (cache_path);
+  return ret;
+}
+
+gboolean
+nvdsanalytics_save_config_cache (GstNvDsAnalytics *nvdsanalytics, const gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  gchar *cache_path = config_cache_path (cfg_file_path);
+  gchar *cache_dir = g_path_get_dirname (cache_path);
+  GError *error = NULL;
+  ConfigCacheHeader header;
+  std::string file;
+  std::string payload;
+
+  init_debug_category ();
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, CONFIG_CACHE_MAGIC, sizeof (header.magic));
+  header.version = CONFIG_CACHE_VERSION;
+  header.header_size = sizeof (header);
+  if (!read_source (cfg_file_path, &header.source_size, &header.source_checksum))
+    goto done;
+
+  put<guint8> (payload, nvdsanalytics->enable);
+  put<gint32> (payload, nvdsanalytics->configuration_width);
+  put<gint32> (payload, nvdsanalytics->configuration_height);
+  put<guint32> (payload, nvdsanalytics->font_size);
+  put<guint32> (payload, nvdsanalytics->osd_mode);
+  put<guint32> (payload, nvdsanalytics->obj_cnt_win_in_ms);
+  put<guint8> (payload, nvdsanalytics->display_obj_cnt);
+  put<guint32> (payload, nvdsanalytics->stream_analytics_info->size ());
+  for (const std::pair<const gint, StreamInfo> &stream : *nvdsanalytics->stream_analytics_info) {
+    StreamAnalyticsState &state = (*nvdsanalytics->stream_analytics_state)[stream.first];
+    if (!state.zones_compiled)
+      compileStreamZones (stream.second, state);
+    put_stream (payload, stream.first, stream.second);
+    put_zones (payload, state);
+  }
+
+  header.payload_size = payload.size ();
+  header.payload_checksum = config_cache_checksum ((const guint8 *) payload.data (),
+      payload.size ());
+
+  file.reserve (sizeof (header) + payload.size ());
+  file.append ((const gchar *) &header, sizeof (header));
+  file.append (payload);
+
+  if (g_mkdir_with_parents (cache_dir, 0755) != 0) {
+    GST_CAT_WARNING (NVDSANALYTICS_CFG_CACHE_CAT, "Failed to create %s: %s",
+        cache_dir, g_strerror (errno));
+    goto done;
+  }
+  /* Written to a temporary file and renamed, a reader never maps half a cache */
+  if (!g_file_set_contents (cache_path, file.data (), file.size (), &error)) {
+    GST_CAT_WARNING (NVDSANALYTICS_CFG_CACHE_CAT, "Failed to write cache %s: %s",
+        cache_path, error->message);
+    g_error_free (error);
+    goto done;
+  }
+  ret = TRUE;
+
+done:
+  g_free (cache_dir);
+  g_free (cache_path);
+  return ret;
+}
@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2020-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NVDSANALYTICS_CONFIG_CACHE_H_
+#define NVDSANALYTICS_CONFIG_CACHE_H_
+
+#include <gst/gst.h>
+#include "gstnvdsanalytics.h"
+
+/* Compiled configs are written to this directory of the user's cache
+ * directory, e.g. ~/.cache/nvdsanalytics/<hash of the config path>.cache */
+#define NVDSANALYTICS_CONFIG_CACHE_DIR "nvdsanalytics"
+#define NVDSANALYTICS_CONFIG_CACHE_SUFFIX ".cache"
+
+/* Load the parsed configuration of cfg_file_path and the compiled zones of
+ * its streams from its cache, replacing stream_analytics_info and
+ * stream_analytics_state. Returns FALSE if there is no cache, or it is
+ * corrupt, of another format version or the config's size or checksum
+ * changed since; the caller then parses the text config. */
+gboolean
+nvdsanalytics_load_config_cache (GstNvDsAnalytics *nvdsanalytics, const gchar *cfg_file_path);
+
+/* Compile the zones of the configuration just parsed from cfg_file_path into
+ * stream_analytics_state, unless already compiled, and write both to its
+ * cache. Failing to write it only costs the next start a text parse. */
+gboolean
+nvdsanalytics_save_config_cache (GstNvDsAnalytics *nvdsanalytics, const gchar *cfg_file_path);
+
+#endif /* NVDSANALYTICS_CONFIG_CACHE_H_ */
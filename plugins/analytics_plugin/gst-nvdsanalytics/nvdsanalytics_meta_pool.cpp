@@ -0,0 +1,184 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2020-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+#include "nvdsanalytics_meta_pool.h"
+
+/* Status entries reserved in a new object instance */
+#define META_POOL_RESERVE_STATUS 4
+
+/* The pool an instance goes back to is kept next to it, so release needs
+ * nothing but the user_meta_data pointer. The meta is the first member and
+ * user_meta_data points at it. */
+struct PooledObjInfo
+{
+  NvDsAnalyticsObjInfo info;
+  NvDsAnalyticsMetaPool *pool;
+};
+
+struct PooledFrameMeta
+{
+  NvDsAnalyticsFrameMeta meta;
+  NvDsAnalyticsMetaPool *pool;
+};
+
+struct _NvDsAnalyticsMetaPool
+{
+  gint ref_count;             // owner plus instances handed out
+  GMutex lock;
+  std::vector<PooledObjInfo *> free_obj;
+  std::vector<PooledFrameMeta *> free_frame;
+};
+
+NvDsAnalyticsMetaPool *
+nvdsanalytics_meta_pool_new (void)
+{
+  NvDsAnalyticsMetaPool *pool = new NvDsAnalyticsMetaPool;
+  pool->ref_count = 1;
+  g_mutex_init (&pool->lock);
+  return pool;
+}
+
+void
+nvdsanalytics_meta_pool_unref (NvDsAnalyticsMetaPool *pool)
+{
+  if (!g_atomic_int_dec_and_test (&pool->ref_count))
+    return;
+  for (PooledObjInfo *obj : pool->free_obj)
+    delete obj;
+  for (PooledFrameMeta *frame : pool->free_frame)
+    delete frame;
+  g_mutex_clear (&pool->lock);
+  delete pool;
+}
+
+NvDsAnalyticsObjInfo *
+nvdsanalytics_meta_pool_acquire_obj (NvDsAnalyticsMetaPool *pool)
+{
+  PooledObjInfo *obj = NULL;
+
+  g_atomic_int_inc (&pool->ref_count);
+  g_mutex_lock (&pool->lock);
+  if (!pool->free_obj.empty ()) {
+    obj = pool->free_obj.back ();
+    pool->free_obj.pop_back ();
+  }
+  g_mutex_unlock (&pool->lock);
+
+  if (!obj) {
+    obj = new PooledObjInfo;
+    obj->pool = pool;
+    obj->info.roiStatus.reserve (META_POOL_RESERVE_STATUS);
+    obj->info.ocStatus.reserve (META_POOL_RESERVE_STATUS);
+    obj->info.lcStatus.reserve (META_POOL_RESERVE_STATUS);
+    obj->info.unique_id = 0;
+  }
+  return &obj->info;
+}
+
+NvDsAnalyticsFrameMeta *
+nvdsanalytics_meta_pool_acquire_frame (NvDsAnalyticsMetaPool *pool)
+{
+  PooledFrameMeta *frame = NULL;
+
+  g_atomic_int_inc (&pool->ref_count);
+  g_mutex_lock (&pool->lock);
+  if (!pool->free_frame.empty ()) {
+    frame = pool->free_frame.back ();
+    pool->free_frame.pop_back ();
+  }
+  g_mutex_unlock (&pool->lock);
+
+  if (!frame) {
+    frame = new PooledFrameMeta;
+    frame->pool = pool;
+    frame->meta.unique_id = 0;
+  }
+  return &frame->meta;
+}
+
+NvDsAnalyticsObjInfo *
+nvdsanalytics_meta_pool_copy_obj (const NvDsAnalyticsObjInfo *src)
+{
+  NvDsAnalyticsObjInfo *dst = nvdsanalytics_meta_pool_acquire_obj (
+      reinterpret_cast<const PooledObjInfo *> (src)->pool);
+  *dst = *src;
+  return dst;
+}
+
+NvDsAnalyticsFrameMeta *
+nvdsanalytics_meta_pool_copy_frame (const NvDsAnalyticsFrameMeta *src)
+{
+  NvDsAnalyticsFrameMeta *dst = nvdsanalytics_meta_pool_acquire_frame (
+      reinterpret_cast<const PooledFrameMeta *> (src)->pool);
+  *dst = *src;
+  return dst;
+}
+
+void
+nvdsanalytics_meta_pool_release_obj (NvDsAnalyticsObjInfo *info)
+{
+  PooledObjInfo *obj = reinterpret_cast<PooledObjInfo *> (info);
+  NvDsAnalyticsMetaPool *pool = obj->pool;
+
+  /* clear () keeps the capacity for the next object */
+  info->roiStatus.clear ();
+  info->ocStatus.clear ();
+  info->lcStatus.clear ();
+  info->dirStatus.clear ();
+  info->objStatus.clear ();
+  info->unique_id = 0;
+
+  g_mutex_lock (&pool->lock);
+  if (pool->free_obj.size () < NVDSANALYTICS_META_POOL_MAX_FREE) {
+    pool->free_obj.push_back (obj);
+    obj = NULL;
+  }
+  g_mutex_unlock (&pool->lock);
+  delete obj;
+  nvdsanalytics_meta_pool_unref (pool);
+}
+
+void
+nvdsanalytics_meta_pool_release_frame (NvDsAnalyticsFrameMeta *meta)
+{
+  PooledFrameMeta *frame = reinterpret_cast<PooledFrameMeta *> (meta);
+  NvDsAnalyticsMetaPool *pool = frame->pool;
+
+  /* Labels differ between streams, a recycled frame must not keep any */
+  meta->ocStatus.clear ();
+  meta->objInROIcnt.clear ();
+  meta->objLCCurrCnt.clear ();
+  meta->objLCCumCnt.clear ();
+  meta->objCnt.clear ();
+  meta->unique_id = 0;
+
+  g_mutex_lock (&pool->lock);
+  if (pool->free_frame.size () < NVDSANALYTICS_META_POOL_MAX_FREE) {
+    pool->free_frame.push_back (frame);
+    frame = NULL;
+  }
+  g_mutex_unlock (&pool->lock);
+  delete frame;
+  nvdsanalytics_meta_pool_unref (pool);
+}
@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2020-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NVDSANALYTICS_META_POOL_H_
+#define NVDSANALYTICS_META_POOL_H_
+
+#include <glib.h>
+#include "nvds_analytics_meta.h"
+
+/* Released instances kept per type for reuse, more are freed */
+#define NVDSANALYTICS_META_POOL_MAX_FREE 4096
+
+/* Recycles the NvDsAnalyticsObjInfo / NvDsAnalyticsFrameMeta attached as user
+ * meta, so their containers keep the capacity they grew to instead of being
+ * reallocated for every object and frame. Instances are released from the
+ * meta release_func on any thread, possibly after the element is gone; every
+ * instance handed out holds a reference on its pool. */
+typedef struct _NvDsAnalyticsMetaPool NvDsAnalyticsMetaPool;
+
+NvDsAnalyticsMetaPool *nvdsanalytics_meta_pool_new (void);
+
+/* Drop the owner's reference, the pool is freed with its last instance */
+void nvdsanalytics_meta_pool_unref (NvDsAnalyticsMetaPool *pool);
+
+/* Instances come back empty, except for the capacity of their containers */
+NvDsAnalyticsObjInfo *nvdsanalytics_meta_pool_acquire_obj (NvDsAnalyticsMetaPool *pool);
+NvDsAnalyticsFrameMeta *nvdsanalytics_meta_pool_acquire_frame (NvDsAnalyticsMetaPool *pool);
+
+/* A copy from the pool src was acquired from, for the meta copy_func */
+NvDsAnalyticsObjInfo *nvdsanalytics_meta_pool_copy_obj (const NvDsAnalyticsObjInfo *src);
+NvDsAnalyticsFrameMeta *nvdsanalytics_meta_pool_copy_frame (const NvDsAnalyticsFrameMeta *src);
+
+/* Return an instance to the pool it was acquired from */
+void nvdsanalytics_meta_pool_release_obj (NvDsAnalyticsObjInfo *info);
+void nvdsanalytics_meta_pool_release_frame (NvDsAnalyticsFrameMeta *meta);
+
+#endif /* NVDSANALYTICS_META_POOL_H_ */
@@ -415,6 +415,7 @@ nvdsanalytics_parse_linecrossing_group (GstNvDsAnalytics * nvdsanalytics,
   std::unordered_map < int, StreamInfo > *stream_analytics_info =
       (nvdsanalytics->stream_analytics_info);
   lc_info.stream_id = stream_id;
+  lc_info.mode_dir = eModeDir::use_dir;
 
   keys = g_key_file_get_keys (key_file, group, nullptr, &error);
   CHECK_ERROR (error, group);
@@ -879,6 +880,14 @@ nvdsanalytics_parse_config_file (GstNvDsAnalytics * nvdsanalytics,
 for (auto & info:nvdsanalytics->stream_analytics_info[0]) {
     info.second.config_width = nvdsanalytics->configuration_width;
     info.second.config_height = nvdsanalytics->configuration_height;
+    if (info.second.linecrossing_info.size () > MAX_LINES_PER_STREAM)
+      g_print ("NVDSANALYTICS_CFG_PARSER: Stream %d has %lu lines, only the "
+          "first %d are evaluated\n", info.first,
+          (gulong) info.second.linecrossing_info.size (), MAX_LINES_PER_STREAM);
+    if (info.second.overcrowding_info.size () > MAX_OC_ZONES_PER_STREAM)
+      g_print ("NVDSANALYTICS_CFG_PARSER: Stream %d has %lu overcrowding zones, "
+          "only the first %d are evaluated\n", info.first,
+          (gulong) info.second.overcrowding_info.size (), MAX_OC_ZONES_PER_STREAM);
   }
 
 done:
@@ -1,80 +1,390 @@
 #include "process_source.h"
+#include <algorithm>
+#include <cmath>
 
-double intersectionArea(const cv::Mat& mat, const cv::Rect& rect) {
-    // draw rectangle in white to represent bounding box
-    cv::Mat rectMask = cv::Mat::zeros(mat.size(), CV_8UC1);
-    cv::rectangle(rectMask, rect, cv::Scalar(255), cv::FILLED);
+// Pixels of box per ROI, indexed by label, and per overcrowding zone, in one
+// pass over the rows the box spans
+static void zoneCoverage(const cv::Mat& zones, const ZoneBox& box, uint32_t *roi_px,
+    uint32_t *oc_px)
+{
+    for (int y = box.y0; y < box.y1; y++) {
+        const uint32_t *row = zones.ptr<uint32_t>(y);
+        for (int x = box.x0; x < box.x1; x++) {
+            uint32_t px = row[x];
+            roi_px[px & ZONE_ROI_LABEL_MASK]++;
+            for (uint32_t bits = px >> ZONE_OC_SHIFT; bits; bits &= bits - 1)
+                oc_px[__builtin_ctz(bits)]++;
+        }
+    }
+}
+
+static void fillZone(cv::Mat &mask, const std::vector<std::pair<int, int>> &roi_pts, uint32_t value,
+    bool combine)
+{
+    std::vector<cv::Point> pts;
+    for (const auto& pair : roi_pts) {
+        pts.emplace_back(pair.first, pair.second);
+    }
+    std::vector<std::vector<cv::Point>> zone = {pts};
+    // CV_32SC1 holds the bits, a Scalar above INT32_MAX would saturate
+    cv::Scalar fill((int32_t) value);
+
+    if (!combine) {
+        cv::fillPoly(mask, zone, fill);
+        return;
+    }
+    cv::Mat layer = cv::Mat::zeros(mask.size(), mask.type());
+    cv::fillPoly(layer, zone, fill);
+    cv::bitwise_or(mask, layer, mask);
+}
+
+size_t streamRois(const StreamInfo &stream_info)
+{
+    return std::min(stream_info.roi_info.size(), (size_t) MAX_ROIS_PER_STREAM);
+}
+
+size_t streamOcZones(const StreamInfo &stream_info)
+{
+    return std::min(stream_info.overcrowding_info.size(), (size_t) MAX_OC_ZONES_PER_STREAM);
+}
+
+void compileStreamZones(const StreamInfo &stream_info, StreamAnalyticsState &state)
+{
+    size_t rois = streamRois(stream_info);
+    size_t oc_zones = streamOcZones(stream_info);
+
+    // Labels first, they overwrite, then the overcrowding bits on top
+    state.zone_labels = cv::Mat::zeros(stream_info.config_height, stream_info.config_width, CV_32SC1);
+    for (size_t i = 0; i < rois; i++)
+        fillZone(state.zone_labels, stream_info.roi_info[i].roi_pts, i + 1, false);
+    for (size_t i = 0; i < oc_zones; i++)
+        fillZone(state.zone_labels, stream_info.overcrowding_info[i].roi_pts,
+            1u << (ZONE_OC_SHIFT + i), true);
+
+    std::vector<const std::vector<std::pair<int, int>> *> zones;
+    for (size_t i = 0; i < rois; i++)
+        zones.push_back(&stream_info.roi_info[i].roi_pts);
+    for (size_t i = 0; i < oc_zones; i++)
+        zones.push_back(&stream_info.overcrowding_info[i].roi_pts);
+    state.zone_grid.build(zones, stream_info.config_width, stream_info.config_height);
+    state.zones_compiled = true;
+}
+
+static void compileStreamState(const StreamInfo &stream_info, StreamAnalyticsState &state)
+{
+    size_t rois = streamRois(stream_info);
+
+    if (!state.zones_compiled)
+        compileStreamZones(stream_info, state);
+    state.roi_px.assign(rois + 1, 0);
+    state.roi_cnt.assign(rois, 0);
+    state.oc_state.resize(streamOcZones(stream_info));
+
+    size_t lines = std::min(stream_info.linecrossing_info.size(), (size_t) MAX_LINES_PER_STREAM);
+    for (size_t i = 0; i < lines; i++) {
+        // lcdir_pts holds the direction vector, then the line
+        const std::vector<std::pair<int, int>> &pts = stream_info.linecrossing_info[i].lcdir_pts;
+        state.lc_dx.push_back(pts[1].first - pts[0].first);
+        state.lc_dy.push_back(pts[1].second - pts[0].second);
+        state.lc_ax.push_back(pts[2].first);
+        state.lc_ay.push_back(pts[2].second);
+        state.lc_bx.push_back(pts[3].first);
+        state.lc_by.push_back(pts[3].second);
+        state.lc_mode.push_back((uint8_t) stream_info.linecrossing_info[i].mode);
+    }
+    state.lc_cum_cnt.assign(lines, 0);
+
+    for (const auto& dir : stream_info.direction_info) {
+        float dx = dir.x2y2.first - dir.x1y1.first;
+        float dy = dir.x2y2.second - dir.x1y1.second;
+        float len = std::sqrt(dx * dx + dy * dy);
+        state.dir_x.push_back(len > 0 ? dx / len : 0);
+        state.dir_y.push_back(len > 0 ? dy / len : 0);
+    }
+    state.compiled = true;
+}
+
+static bool operatesOnClass(const std::vector<int> &classes, int class_id)
+{
+    if (classes.empty())
+        return true;
+    for (int c : classes) {
+        if (c == -1 || c == class_id)
+            return true;
+    }
+    return false;
+}
+
+// Frames back the movement is measured over: the last step for strict, the
+// whole history for loose
+static uint32_t historyWindow(enum eMode mode, const Trajectory &trajectory)
+{
+    uint32_t window = LAST_N_FRAMES - 1;
+    if (mode == eMode::strict)
+        window = 1;
+    else if (mode == eMode::balanced)
+        window = LAST_N_FRAMES / 2;
+    return std::min(window, trajectory.count - 1);
+}
+
+// eMode values, balanced, strict and loose
+#define HISTORY_MODES 3
+
+static void appendStatus(ObjInf &obj, const std::string &status)
+{
+    if (!obj.str_obj_status.empty())
+        obj.str_obj_status += " ";
+    obj.str_obj_status += status;
+}
 
-    // Find intersection between the zone and rectangle
-    cv::Mat intersection;
-    cv::bitwise_and(mat, rectMask, intersection);
+// A line is crossed when the movement over the window goes from one side of
+// the line to the other, through the segment unless the line is extended,
+// in the line's direction, or from the side mode_dir names, by the sign of
+// (b - a) x (p - a). A counted crossing stays marked until the whole window
+// is past the line, so it is counted once.
+static void crossLines(ObjInf &obj, Trajectory &trajectory, StreamInfo &stream_info,
+    StreamAnalyticsState &state, NvDsAnalyticProcessParams &process_params)
+{
+    size_t lines = state.lc_ax.size();
+    float side0[MAX_LINES_PER_STREAM], side1[MAX_LINES_PER_STREAM];
+    const TrajectoryPoint &p1 = trajectory.back(0);
+
+    // Start of the movement per mode, so the side tests only index
+    float p0x[HISTORY_MODES], p0y[HISTORY_MODES];
+    for (int m = 0; m < HISTORY_MODES; m++) {
+        const TrajectoryPoint &p0 = trajectory.back(historyWindow((enum eMode) m, trajectory));
+        p0x[m] = p0.x;
+        p0y[m] = p0.y;
+    }
+
+    for (size_t i = 0; i < lines; i++) {
+        float ex = state.lc_bx[i] - state.lc_ax[i];
+        float ey = state.lc_by[i] - state.lc_ay[i];
+        float x0 = p0x[state.lc_mode[i]], y0 = p0y[state.lc_mode[i]];
+        side0[i] = ex * (y0 - state.lc_ay[i]) - ey * (x0 - state.lc_ax[i]);
+        side1[i] = ex * (p1.y - state.lc_ay[i]) - ey * (p1.x - state.lc_ax[i]);
+    }
 
-    // Calculate the area of intersection
-    int nonzeroPixels = cv::countNonZero(intersection);
-    // Assuming binary mask
-    double area = nonzeroPixels;
+    for (size_t i = 0; i < lines; i++) {
+        LineCrossingInfo &lc = stream_info.linecrossing_info[i];
+        uint64_t bit = 1ULL << i;
 
-    return area;
+        if ((side0[i] > 0) == (side1[i] > 0)) {
+            trajectory.lc_crossed &= ~bit;
+            continue;
+        }
+        if (!lc.enable || (trajectory.lc_crossed & bit) ||
+            !operatesOnClass(lc.operate_on_class, obj.class_id))
+            continue;
+
+        float x0 = p0x[state.lc_mode[i]], y0 = p0y[state.lc_mode[i]];
+        float mx = p1.x - x0, my = p1.y - y0;
+        if (!lc.extended) {
+            // The line's end points must lie on either side of the movement
+            float t0 = mx * (state.lc_ay[i] - y0) - my * (state.lc_ax[i] - x0);
+            float t1 = mx * (state.lc_by[i] - y0) - my * (state.lc_bx[i] - x0);
+            if ((t0 > 0) == (t1 > 0))
+                continue;
+        }
+        bool along;
+        if (lc.mode_dir == eModeDir::pos_to_neg)
+            along = side0[i] > 0;
+        else if (lc.mode_dir == eModeDir::neg_to_pos)
+            along = side1[i] > 0;
+        else
+            along = mx * state.lc_dx[i] + my * state.lc_dy[i] > 0;
+        if (!along)
+            continue;
+
+        trajectory.lc_crossed |= bit;
+        state.lc_cum_cnt[i]++;
+        process_params.objLCCurrCnt[lc.lc_label]++;
+        obj.lcStatus.push_back(lc.lc_label);
+        appendStatus(obj, "LC:" + lc.lc_label);
+    }
 }
 
-void processSource(NvDsAnalyticProcessParams &process_params, StreamInfo &stream_info)
+// The direction whose vector is closest to the movement over the window, if
+// within the angle the mode allows
+static void detectDirection(ObjInf &obj, const Trajectory &trajectory,
+    const StreamInfo &stream_info, const StreamAnalyticsState &state)
 {
-    std::vector <ROIInfo> roi_vector = stream_info.roi_info;
-    
-    int frame_height = stream_info.config_height;
-    int frame_width = stream_info.config_width;
-    int roi_counter = 1;
-    
-    // Initialize the grayscale mat in black
-    cv::Mat mat = cv::Mat::zeros(frame_height, frame_width, CV_8UC1);
-
-    // Iterate through each ROI and fill them inside the mat in white
-    for (const auto& roi_instance : roi_vector) {
-        
-        std::vector<cv::Point> pts;
-        for (const auto& pair : roi_instance.roi_pts) {
-            pts.emplace_back(pair.first, pair.second);
+    float best_cos = 0;
+    int best = -1;
+
+    for (size_t i = 0; i < stream_info.direction_info.size(); i++) {
+        const DirectionInfo &dir = stream_info.direction_info[i];
+        if (!dir.enable || !operatesOnClass(dir.operate_on_class, obj.class_id))
+            continue;
+        const TrajectoryPoint &p0 = trajectory.back(historyWindow(dir.mode, trajectory));
+        const TrajectoryPoint &p1 = trajectory.back(0);
+        float mx = p1.x - p0.x, my = p1.y - p0.y;
+        float len = std::sqrt(mx * mx + my * my);
+        if (len < MIN_DIRECTION_MOVE_PX)
+            continue;
+
+        // cos 15, 30 and 45 degrees
+        float min_cos = dir.mode == eMode::strict ? 0.966f :
+            dir.mode == eMode::balanced ? 0.866f : 0.707f;
+        float cosine = (mx * state.dir_x[i] + my * state.dir_y[i]) / len;
+        if (cosine >= min_cos && cosine > best_cos) {
+            best_cos = cosine;
+            best = i;
         }
-        std::vector<std::vector<cv::Point>> roi_zone = {pts};
+    }
+    if (best >= 0) {
+        obj.dirStatus = "DIR:" + stream_info.direction_info[best].dir_label;
+        appendStatus(obj, obj.dirStatus);
+    }
+}
+
+// Line crossing and direction over the trajectories of the tracked objects
+static void processTrajectories(NvDsAnalyticProcessParams &process_params,
+    StreamInfo &stream_info, StreamAnalyticsState &state)
+{
+    int64_t now_ms = process_params.frmPts / 1000000;
+
+    for (size_t i = 0; i < state.lc_cum_cnt.size(); i++)
+        process_params.objLCCurrCnt[stream_info.linecrossing_info[i].lc_label] = 0;
+
+    for (auto& obj : process_params.objList) {
+        // UNTRACKED_OBJECT_ID, no history without a tracker id
+        if (obj.object_id == UINT64_MAX)
+            continue;
+        TrajectoryPoint pt = { obj.left + obj.width / 2.0f, (float) (obj.top + obj.height) };
+        Trajectory &trajectory = state.trajectories.update(obj.object_id, now_ms, pt);
+        if (trajectory.count < 2)
+            continue;
+        crossLines(obj, trajectory, stream_info, state, process_params);
+        detectDirection(obj, trajectory, stream_info, state);
+    }
+    state.trajectories.evict(now_ms);
+
+    for (size_t i = 0; i < state.lc_cum_cnt.size(); i++)
+        process_params.objLCCumCnt[stream_info.linecrossing_info[i].lc_label] = state.lc_cum_cnt[i];
+}
+
+// Assert a zone once its count has been at or above object_threshold for
+// time_threshold_in_ms of pts, clear it once it has been below for as long
+static void updateOverCrowding(NvDsAnalyticProcessParams &process_params,
+    const StreamInfo &stream_info, StreamAnalyticsState &state, const uint32_t *oc_cnt)
+{
+    int64_t now_ms = process_params.frmPts / 1000000;
 
-        cv::fillPoly(mat, roi_zone, cv::Scalar(255));
+    for (size_t i = 0; i < state.oc_state.size(); i++) {
+        const OverCrowdingInfo &oc = stream_info.overcrowding_info[i];
+        OverCrowdingState &oc_state = state.oc_state[i];
+        if (!oc.enable)
+            continue;
 
-        roi_counter++;
+        // Restart the timer when the pts went back
+        if (now_ms < oc_state.last_ms)
+            oc_state.pending_since_ms = -1;
+        oc_state.last_ms = now_ms;
+
+        bool crowded = oc_cnt[i] >= (uint32_t) std::max(oc.object_threshold, 0);
+        if (crowded == oc_state.asserted) {
+            oc_state.pending_since_ms = -1;
+        } else {
+            if (oc_state.pending_since_ms < 0)
+                oc_state.pending_since_ms = now_ms;
+            if (now_ms - oc_state.pending_since_ms >= oc.time_threshold_in_ms) {
+                oc_state.asserted = crowded;
+                oc_state.pending_since_ms = -1;
+            }
+        }
+
+        OverCrowdStatus &status = process_params.ocStatus[oc.oc_label];
+        status.overCrowding = oc_state.asserted;
+        status.overCrowdingCount = oc_cnt[i];
     }
+}
+
+void processSource(NvDsAnalyticProcessParams &process_params, StreamInfo &stream_info,
+    StreamAnalyticsState &state)
+{
+    if (!state.compiled)
+        compileStreamState(stream_info, state);
+
+    uint32_t rois = state.roi_cnt.size();
+    size_t oc_zones = state.oc_state.size();
+    uint32_t oc_px[MAX_OC_ZONES_PER_STREAM];
+    uint32_t oc_cnt[MAX_OC_ZONES_PER_STREAM] = {0};
+
+    std::fill(state.roi_cnt.begin(), state.roi_cnt.end(), 0);
 
     // Iterate through each detected object
-    int obj_cnt = 0;
     for (auto& obj : process_params.objList) {
         // Assuming bbox points are (left, top) and (left + width, top + height)
-        int bbox_center_x = obj.left + obj.width / 2;
-        int bbox_center_y = obj.top + obj.height / 2;
-        cv::Rect rect(bbox_center_x - obj.width / 2, bbox_center_y - obj.height / 2, obj.width, obj.height);
+        ZoneBox box = { (int) obj.left, (int) obj.top,
+            (int) (obj.left + obj.width), (int) (obj.top + obj.height) };
 
         double rectArea = obj.width * obj.height;
         // To avoid division by very small or zero values
         rectArea += 1e-5;
 
-        double intersection = intersectionArea(mat, rect);
+        // Only the part of the box within the boxes of nearby zones can be
+        // covered, objects away from every zone skip the rasters
+        ZoneBox scan = { box.x1, box.y1, box.x0, box.y0 };
+        bool near_roi = false, near_oc = false;
+        state.zone_grid.query(box, state.zone_candidates);
+        for (uint32_t zone : state.zone_candidates) {
+            const ZoneBox &bounds = state.zone_grid.bounds(zone);
+            scan.x0 = std::min(scan.x0, std::max(bounds.x0, box.x0));
+            scan.y0 = std::min(scan.y0, std::max(bounds.y0, box.y0));
+            scan.x1 = std::max(scan.x1, std::min(bounds.x1, box.x1));
+            scan.y1 = std::max(scan.y1, std::min(bounds.y1, box.y1));
+            if (zone < rois)
+                state.roi_px[zone + 1] = 0;
+            near_roi |= zone < rois;
+            near_oc |= zone >= rois;
+        }
+
+        // One pass counts the pixels of every zone. The ROIs a pixel can
+        // carry are the candidates, their counts are complete.
+        if (near_roi || near_oc) {
+            std::fill(oc_px, oc_px + oc_zones, 0);
+            zoneCoverage(state.zone_labels, scan, state.roi_px.data(), oc_px);
+        }
 
-        double inter_rectangle_ratio  = intersection / rectArea;
-        
-        bool inside_roi = false;
-        if (inter_rectangle_ratio >= EXCLUDED_ZONE_PERCENTAGE){
-            inside_roi = true;
+        // The ROI with most of the box is the object's
+        if (near_roi) {
+            uint32_t covered = 0, best = state.zone_candidates[0];
+            for (uint32_t zone : state.zone_candidates) {
+                if (zone >= rois)
+                    break;
+                covered += state.roi_px[zone + 1];
+                if (state.roi_px[zone + 1] > state.roi_px[best + 1])
+                    best = zone;
+            }
+            if (covered >= EXCLUDED_ZONE_PERCENTAGE * rectArea) {
+                state.roi_cnt[best]++;
+                obj.roiStatus.push_back(stream_info.roi_info[best].roi_label);
+                obj.str_obj_status = "in";
+            }
         }
-        
-        if (inside_roi) {
-            // ensures uniqueness by appending a counter value to roi_label
-            // Here roi_label = "RF"
-            std::string roi_label = "RF" + std::to_string(roi_counter);
-            // Update objInROIcnt for the current ROI
-            process_params.objInROIcnt[roi_label]++;
-            // Attach metadata to the object
-            obj.roiStatus.push_back("RF");
-            process_params.objList[obj_cnt].str_obj_status = "in";
+
+        // An object is in an overcrowding zone by the same coverage rule
+        if (near_oc) {
+            for (size_t i = 0; i < oc_zones; i++) {
+                const OverCrowdingInfo &oc = stream_info.overcrowding_info[i];
+                if (!oc.enable || oc_px[i] < EXCLUDED_ZONE_PERCENTAGE * rectArea ||
+                    !operatesOnClass(oc.operate_on_class, obj.class_id))
+                    continue;
+                oc_cnt[i]++;
+                obj.ocStatus.push_back(oc.oc_label);
+            }
         }
         // Update object counts for each status
-        process_params.objCnt[obj.class_id]++;        
-        obj_cnt++;
+        process_params.objCnt[obj.class_id]++;
     }
+
+    for (uint32_t i = 0; i < rois; i++)
+        process_params.objInROIcnt[stream_info.roi_info[i].roi_label] = state.roi_cnt[i];
+
+    if (oc_zones)
+        updateOverCrowding(process_params, stream_info, state, oc_cnt);
+
+    if (!state.lc_ax.empty() || !state.dir_x.empty())
+        processTrajectories(process_params, stream_info, state);
 }
\ No newline at end of file
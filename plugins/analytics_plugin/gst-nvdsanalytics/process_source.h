@@ -4,10 +4,72 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include "nvds_analytics.h"
+#include "trajectory_store.h"
+#include "zone_grid.h"
 #include <string>
 
 #define EXCLUDED_ZONE_PERCENTAGE 0.8
+// Movement below this many pixels over the window has no direction
+#define MIN_DIRECTION_MOVE_PX 2.0f
+// Lines evaluated per stream, one bit each in Trajectory::lc_crossed
+#define MAX_LINES_PER_STREAM 64
+// ROIs per stream, labels in the low 16 bits of the zone raster
+#define MAX_ROIS_PER_STREAM UINT16_MAX
+// Overcrowding zones per stream, one bit each above the ROI label
+#define MAX_OC_ZONES_PER_STREAM 16
+#define ZONE_ROI_LABEL_MASK 0xffff
+#define ZONE_OC_SHIFT 16
 
-void processSource(NvDsAnalyticProcessParams &process_params, StreamInfo &stream_info);
+// Hysteresis of one overcrowding zone: the status only flips after the count
+// has been on the other side of object_threshold for time_threshold_in_ms
+struct OverCrowdingState {
+    bool asserted = false;
+    int64_t pending_since_ms = -1;     // first frame that disagreed with asserted
+    int64_t last_ms = -1;
+};
+
+// Analytics state of one stream that outlives a frame. It is compiled from
+// the StreamInfo on the first frame and dropped when the config is reloaded.
+struct StreamAnalyticsState {
+    bool compiled = false;
+    // zone_labels and zone_grid are built, which the config cache can do
+    // before the first frame
+    bool zones_compiled = false;
+    TrajectoryStore trajectories;
+
+    // Zones rasterised at config resolution, one uint32 per pixel: ROI i as
+    // label i + 1 in the low 16 bits, a later ROI owning the pixels it shares
+    // with an earlier one, and overcrowding zone i as bit 16 + i
+    cv::Mat zone_labels;
+    std::vector<uint32_t> roi_px;    // pixels of the current box per label
+    std::vector<uint32_t> roi_cnt;   // objects per ROI in the current frame
+    std::vector<OverCrowdingState> oc_state;
+
+    // Bounding boxes of the ROIs, then of the overcrowding zones, so only the
+    // part of the mask near an object's zones is scanned
+    ZoneGrid zone_grid;
+    std::vector<uint32_t> zone_candidates;
+
+    // Line crossing, one entry per linecrossing_info, structure of arrays so
+    // the side tests of all lines run as one loop
+    std::vector<float> lc_ax, lc_ay, lc_bx, lc_by;  // the line
+    std::vector<float> lc_dx, lc_dy;                // crossing direction
+    std::vector<uint8_t> lc_mode;                   // eMode, the history window
+    std::vector<uint64_t> lc_cum_cnt;
+
+    // Direction detection, unit vector per direction_info
+    std::vector<float> dir_x, dir_y;
+};
+
+// ROIs and overcrowding zones of the stream that are evaluated
+size_t streamRois(const StreamInfo &stream_info);
+size_t streamOcZones(const StreamInfo &stream_info);
+
+// Rasterise the zones of stream_info and build their grid, the costly part
+// of compiling a stream's state
+void compileStreamZones(const StreamInfo &stream_info, StreamAnalyticsState &state);
+
+void processSource(NvDsAnalyticProcessParams &process_params, StreamInfo &stream_info,
+    StreamAnalyticsState &state);
 
 #endif // PROCESS_SOURCE_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "trajectory_store.h"
+
+#define TRAJECTORY_STORE_MIN_SLOTS 64
+#define EMPTY 0ULL
+
+static inline size_t hash_id(uint64_t key)
+{
+    // Tracker ids are sequential, mix them before masking
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t) key;
+}
+
+TrajectoryStore::TrajectoryStore()
+    : keys(TRAJECTORY_STORE_MIN_SLOTS, EMPTY), slots(TRAJECTORY_STORE_MIN_SLOTS), used(0)
+{
+}
+
+size_t TrajectoryStore::slot_of(uint64_t key) const
+{
+    size_t mask = keys.size() - 1;
+    size_t slot = hash_id(key) & mask;
+    while (keys[slot] != EMPTY && keys[slot] != key)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+Trajectory &TrajectoryStore::update(uint64_t object_id, int64_t now_ms, TrajectoryPoint pt)
+{
+    uint64_t key = object_id + 1;
+    size_t slot = slot_of(key);
+
+    if (keys[slot] == EMPTY) {
+        // Keep the load factor at or below one half
+        if (2 * (used + 1) > keys.size()) {
+            grow();
+            slot = slot_of(key);
+        }
+        keys[slot] = key;
+        Trajectory &trajectory = slots[slot];
+        trajectory.object_id = object_id;
+        trajectory.count = 0;
+        trajectory.head = LAST_N_FRAMES - 1;
+        trajectory.lc_crossed = 0;
+        used++;
+    }
+
+    Trajectory &trajectory = slots[slot];
+    trajectory.head = (trajectory.head + 1) % LAST_N_FRAMES;
+    trajectory.pts[trajectory.head] = pt;
+    trajectory.last_ms = now_ms;
+    if (trajectory.count < LAST_N_FRAMES)
+        trajectory.count++;
+    return trajectory;
+}
+
+void TrajectoryStore::grow()
+{
+    std::vector<uint64_t> old_keys(keys.size() * 2, EMPTY);
+    std::vector<Trajectory> old_slots(slots.size() * 2);
+    old_keys.swap(keys);
+    old_slots.swap(slots);
+
+    for (size_t i = 0; i < old_keys.size(); i++) {
+        if (old_keys[i] == EMPTY)
+            continue;
+        size_t slot = slot_of(old_keys[i]);
+        keys[slot] = old_keys[i];
+        slots[slot] = old_slots[i];
+    }
+}
+
+// Backward shift deletion, moves later entries of the probe run into the hole
+// so lookups never need tombstones
+void TrajectoryStore::erase(size_t hole)
+{
+    size_t mask = keys.size() - 1;
+    size_t slot = hole;
+
+    keys[hole] = EMPTY;
+    used--;
+    for (;;) {
+        slot = (slot + 1) & mask;
+        if (keys[slot] == EMPTY)
+            return;
+        size_t home = hash_id(keys[slot]) & mask;
+        // Move it if its home is not in the cyclic range (hole, slot]
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            keys[hole] = keys[slot];
+            slots[hole] = slots[slot];
+            keys[slot] = EMPTY;
+            hole = slot;
+        }
+    }
+}
+
+void TrajectoryStore::evict(int64_t now_ms)
+{
+    for (size_t slot = 0; slot < keys.size(); slot++) {
+        // erase() may shift a later entry into this slot, look at it again.
+        // Trajectories from the future are from before a pts reset.
+        while (keys[slot] != EMPTY && (slots[slot].last_ms < now_ms - TIME_OUT_MSEC ||
+                slots[slot].last_ms > now_ms))
+            erase(slot);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef TRAJECTORY_STORE_H
+#define TRAJECTORY_STORE_H
+
+#include <cstdint>
+#include <vector>
+#include "nvds_analytics.h"
+
+// Point an object is tracked by, the bottom centre of its box
+struct TrajectoryPoint {
+    float x;
+    float y;
+};
+
+// The last LAST_N_FRAMES points of one tracked object, in a ring
+struct Trajectory {
+    uint64_t object_id;
+    int64_t last_ms;           // pts of the newest point
+    uint32_t count;            // points held, at most LAST_N_FRAMES
+    uint32_t head;             // slot of the newest point
+    uint64_t lc_crossed;       // bit per line, set while a counted crossing is in the window
+    TrajectoryPoint pts[LAST_N_FRAMES];
+
+    // The point k frames before the newest one, k < count
+    const TrajectoryPoint &back(uint32_t k) const {
+        return pts[(head + LAST_N_FRAMES - k) % LAST_N_FRAMES];
+    }
+};
+
+// Trajectories of the objects of one stream by object_id, in an open
+// addressing table with linear probing. Objects not seen for TIME_OUT_MSEC
+// are evicted, so the table stays sized to the objects in the scene.
+class TrajectoryStore {
+public:
+    TrajectoryStore();
+
+    // Append the point of object_id seen at now_ms and return its trajectory
+    Trajectory &update(uint64_t object_id, int64_t now_ms, TrajectoryPoint pt);
+
+    // Drop the trajectories last seen before now_ms - TIME_OUT_MSEC, or after
+    // now_ms when the pts went back
+    void evict(int64_t now_ms);
+
+    size_t size() const { return used; }
+
+private:
+    size_t slot_of(uint64_t object_id) const;
+    void grow();
+    void erase(size_t slot);
+
+    // Keys are object_id + 1, so 0 marks an empty slot
+    std::vector<uint64_t> keys;
+    std::vector<Trajectory> slots;
+    size_t used;
+};
+
+#endif // TRAJECTORY_STORE_H
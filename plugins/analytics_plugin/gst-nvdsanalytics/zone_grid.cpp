@@ -0,0 +1,118 @@
+#include "zone_grid.h"
+#include <algorithm>
+
+static ZoneBox polygonBox(const std::vector<std::pair<int, int>> &pts, int width, int height)
+{
+    ZoneBox box = { width, height, 0, 0 };
+    for (const auto& pt : pts) {
+        box.x0 = std::min(box.x0, pt.first);
+        box.y0 = std::min(box.y0, pt.second);
+        // fillPoly covers the boundary pixels
+        box.x1 = std::max(box.x1, pt.first + 1);
+        box.y1 = std::max(box.y1, pt.second + 1);
+    }
+    box.x0 = std::max(box.x0, 0);
+    box.y0 = std::max(box.y0, 0);
+    box.x1 = std::min(box.x1, width);
+    box.y1 = std::min(box.y1, height);
+    return box;
+}
+
+void ZoneGrid::build(const std::vector<const std::vector<std::pair<int, int>> *> &zones,
+    int width, int height)
+{
+    cols = std::max((width + ZONE_GRID_CELL_PX - 1) / ZONE_GRID_CELL_PX, 1);
+    rows = std::max((height + ZONE_GRID_CELL_PX - 1) / ZONE_GRID_CELL_PX, 1);
+    boxes.clear();
+    for (const auto *pts : zones)
+        boxes.push_back(polygonBox(*pts, width, height));
+
+    // Count the zones of every cell, then fill them in zone order
+    std::vector<uint32_t> counts(cols * rows + 1, 0);
+    for (const ZoneBox &box : boxes) {
+        if (box.empty())
+            continue;
+        for (int cy = box.y0 / ZONE_GRID_CELL_PX; cy <= (box.y1 - 1) / ZONE_GRID_CELL_PX; cy++)
+            for (int cx = box.x0 / ZONE_GRID_CELL_PX; cx <= (box.x1 - 1) / ZONE_GRID_CELL_PX; cx++)
+                counts[cy * cols + cx + 1]++;
+    }
+    cell_offsets.resize(counts.size());
+    cell_offsets[0] = 0;
+    for (size_t i = 1; i < counts.size(); i++)
+        cell_offsets[i] = cell_offsets[i - 1] + counts[i];
+
+    cell_zones.resize(cell_offsets.back());
+    std::vector<uint32_t> fill(cell_offsets.begin(), cell_offsets.end() - 1);
+    for (uint32_t zone = 0; zone < boxes.size(); zone++) {
+        const ZoneBox &box = boxes[zone];
+        if (box.empty())
+            continue;
+        for (int cy = box.y0 / ZONE_GRID_CELL_PX; cy <= (box.y1 - 1) / ZONE_GRID_CELL_PX; cy++)
+            for (int cx = box.x0 / ZONE_GRID_CELL_PX; cx <= (box.x1 - 1) / ZONE_GRID_CELL_PX; cx++)
+                cell_zones[fill[cy * cols + cx]++] = zone;
+    }
+}
+
+bool ZoneGrid::restore(Layout &layout, int width, int height)
+{
+    if (layout.cols != std::max((width + ZONE_GRID_CELL_PX - 1) / ZONE_GRID_CELL_PX, 1) ||
+        layout.rows != std::max((height + ZONE_GRID_CELL_PX - 1) / ZONE_GRID_CELL_PX, 1) ||
+        layout.cell_offsets.size() != (size_t) layout.cols * layout.rows + 1 ||
+        layout.cell_offsets[0] != 0 || layout.cell_offsets.back() != layout.cell_zones.size())
+        return false;
+    for (size_t i = 1; i < layout.cell_offsets.size(); i++) {
+        if (layout.cell_offsets[i] < layout.cell_offsets[i - 1])
+            return false;
+    }
+    // Queries only scan inside the boxes, they must lie in the frame
+    for (const ZoneBox &box : layout.boxes) {
+        if (box.x0 < 0 || box.y0 < 0 || box.x1 > width || box.y1 > height)
+            return false;
+    }
+    for (uint32_t zone : layout.cell_zones) {
+        if (zone >= layout.boxes.size())
+            return false;
+    }
+
+    cols = layout.cols;
+    rows = layout.rows;
+    boxes.swap(layout.boxes);
+    cell_offsets.swap(layout.cell_offsets);
+    cell_zones.swap(layout.cell_zones);
+    return true;
+}
+
+void ZoneGrid::query(const ZoneBox &box, std::vector<uint32_t> &zones) const
+{
+    zones.clear();
+    int x0 = std::max(box.x0, 0) / ZONE_GRID_CELL_PX;
+    int y0 = std::max(box.y0, 0) / ZONE_GRID_CELL_PX;
+    int x1 = std::min((box.x1 - 1) / ZONE_GRID_CELL_PX, cols - 1);
+    int y1 = std::min((box.y1 - 1) / ZONE_GRID_CELL_PX, rows - 1);
+    if (box.empty() || box.x1 <= 0 || box.y1 <= 0)
+        return;
+
+    // With few zones testing each box beats visiting cells and deduplicating
+    if (boxes.size() <= ZONE_GRID_SCAN_ZONES) {
+        for (uint32_t i = 0; i < boxes.size(); i++) {
+            const ZoneBox &zone = boxes[i];
+            if (!zone.empty() && zone.x0 < box.x1 && box.x0 < zone.x1 && zone.y0 < box.y1 &&
+                box.y0 < zone.y1)
+                zones.push_back(i);
+        }
+        return;
+    }
+
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (uint32_t i = cell_offsets[cy * cols + cx]; i < cell_offsets[cy * cols + cx + 1]; i++) {
+                const ZoneBox &zone = boxes[cell_zones[i]];
+                if (zone.x0 < box.x1 && box.x0 < zone.x1 && zone.y0 < box.y1 && box.y0 < zone.y1)
+                    zones.push_back(cell_zones[i]);
+            }
+        }
+    }
+    // A zone spanning several of the cells is listed once per cell
+    std::sort(zones.begin(), zones.end());
+    zones.erase(std::unique(zones.begin(), zones.end()), zones.end());
+}
@@ -0,0 +1,55 @@
+#ifndef ZONE_GRID_H
+#define ZONE_GRID_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Cell side in config pixels. Small enough that a box rarely overlaps cells
+// of far away zones, large enough that a zone covers few cells.
+#define ZONE_GRID_CELL_PX 64
+// Up to this many zones a query tests every zone's box instead, see
+// tests/zone_grid_bench
+#define ZONE_GRID_SCAN_ZONES 32
+
+// Pixels x0 <= x < x1, y0 <= y < y1
+struct ZoneBox {
+    int x0, y0, x1, y1;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+};
+
+// Uniform grid over the bounding boxes of a stream's zones, built once when
+// the stream's config is compiled. A query returns only the zones whose box
+// overlaps the query box, visiting the cells it covers instead of every zone.
+class ZoneGrid {
+public:
+    // Zone i is the polygon zones[i], clipped to the width x height frame
+    void build(const std::vector<const std::vector<std::pair<int, int>> *> &zones,
+        int width, int height);
+
+    // Zones overlapping box, each once, in ascending order
+    void query(const ZoneBox &box, std::vector<uint32_t> &zones) const;
+
+    const ZoneBox &bounds(uint32_t zone) const { return boxes[zone]; }
+
+    // The grid as built, to store it and restore it without the polygons.
+    // restore() keeps the grid as it was and returns false unless the parts
+    // form a grid over the width x height frame.
+    struct Layout {
+        int cols, rows;
+        std::vector<ZoneBox> boxes;
+        std::vector<uint32_t> cell_offsets;
+        std::vector<uint32_t> cell_zones;
+    };
+    Layout layout() const { return { cols, rows, boxes, cell_offsets, cell_zones }; }
+    bool restore(Layout &layout, int width, int height);
+
+private:
+    int cols = 0, rows = 0;
+    std::vector<ZoneBox> boxes;
+    std::vector<uint32_t> cell_offsets;    // cols * rows + 1 offsets into cell_zones
+    std::vector<uint32_t> cell_zones;
+};
+
+#endif // ZONE_GRID_H
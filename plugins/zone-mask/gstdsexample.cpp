@@ -45,7 +45,8 @@ enum
   PROP_PROCESS_FULL_FRAME,
   PROP_BLUR_OBJECTS,
   PROP_GPU_DEVICE_ID,
-  PROP_CONFIG_FILE_PATH
+  PROP_CONFIG_FILE_PATH,
+  PROP_MASK_THREADS
 };
 
 #define CHECK_NVDS_MEMORY_AND_GPUID(object, surface)  \
@@ -73,11 +74,15 @@ enum
 #define DEFAULT_BLUR_OBJECTS TRUE
 #define DEFAULT_GPU_ID 0
 #define DEFAULT_CONFIG_FILE_PATH "path"
+#define DEFAULT_MASK_THREADS 4
 
-std::vector<std::vector<cv::Point>> contours;
+/* Config groups holding the zones of all sources, and of one source */
+#define CONTOURS_GROUP "contours"
+#define CONTOURS_STREAM_GROUP_PREFIX "contours-stream-"
 
 #define RGB_BYTES_PER_PIXEL 3
 #define RGBA_BYTES_PER_PIXEL 4
+
 #define Y_BYTES_PER_PIXEL 1
 #define UV_BYTES_PER_PIXEL 2
 
@@ -137,6 +142,9 @@ static GstFlowReturn gst_dsexample_transform_ip (GstBaseTransform *
     btrans, GstBuffer * inbuf);
 
 static void load_config_from_file(const char* config_file_path, GstDsExample* dsexample);
+static void subsample_zone_masks (GstDsExample * dsexample, ZoneMaskSet * masks);
+static void gst_dsexample_finalize (GObject * object);
+static void mask_job_run (gpointer data, gpointer user_data);
 /* Install properties, set sink and src pad capabilities, override the required
  * functions of the base class, These are common to all instances of the
  * element.
@@ -158,6 +166,7 @@ gst_dsexample_class_init (GstDsExampleClass * klass)
   /* Overide base class functions */
   gobject_class->set_property = GST_DEBUG_FUNCPTR (gst_dsexample_set_property);
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_dsexample_get_property);
+  gobject_class->finalize = gst_dsexample_finalize;
 
   gstbasetransform_class->set_caps = GST_DEBUG_FUNCPTR (gst_dsexample_set_caps);
   gstbasetransform_class->start = GST_DEBUG_FUNCPTR (gst_dsexample_start);
@@ -173,6 +182,15 @@ gst_dsexample_class_init (GstDsExampleClass * klass)
             "Path to the configuration file",
             NULL, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_MASK_THREADS,
+      g_param_spec_uint ("mask-threads",
+          "Mask threads",
+          "Number of threads masking the frames of a batch in parallel, "
+          "1 masks them on the streaming thread",
+          1, G_MAXUINT, DEFAULT_MASK_THREADS, (GParamFlags)
+          (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+              GST_PARAM_MUTABLE_READY)));
+
   g_object_class_install_property (gobject_class, PROP_UNIQUE_ID,
       g_param_spec_uint ("unique-id",
           "Unique ID",
@@ -251,6 +269,11 @@ gst_dsexample_init (GstDsExample * dsexample)
   dsexample->blur_objects = DEFAULT_BLUR_OBJECTS;
   dsexample->gpu_id = DEFAULT_GPU_ID;
   dsexample->config_file_path = g_strdup(DEFAULT_CONFIG_FILE_PATH);
+  dsexample->mask_threads = DEFAULT_MASK_THREADS;
+  dsexample->zone_masks = new ZoneMaskSet ();
+  dsexample->mask_jobs = new std::vector<GstDsExampleMaskJob> ();
+  g_mutex_init (&dsexample->mask_lock);
+  g_cond_init (&dsexample->mask_done);
   /* This quark is required to identify NvDsMeta when iterating through
    * the buffer metadatas */
   if (!_dsmeta_quark)
@@ -288,6 +311,9 @@ gst_dsexample_set_property (GObject * object, guint prop_id,
       dsexample->config_file_path = g_value_dup_string(value);
       load_config_from_file(dsexample->config_file_path, dsexample);
       break;
+    case PROP_MASK_THREADS:
+      dsexample->mask_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -325,12 +351,32 @@ gst_dsexample_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_FILE_PATH:
       g_value_set_string(value, dsexample->config_file_path);
       break;
+    case PROP_MASK_THREADS:
+      g_value_set_uint (value, dsexample->mask_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Free what lives as long as the element, the compiled zones survive
+ * stop/start so the config is not reloaded. */
+static void
+gst_dsexample_finalize (GObject * object)
+{
+  GstDsExample *dsexample = GST_DSEXAMPLE (object);
+
+  delete dsexample->zone_masks;
+  dsexample->zone_masks = NULL;
+  delete dsexample->mask_jobs;
+  dsexample->mask_jobs = NULL;
+  g_mutex_clear (&dsexample->mask_lock);
+  g_cond_clear (&dsexample->mask_done);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 /**
  * Initialize all resources and start the output thread
  */
@@ -369,14 +415,21 @@ gst_dsexample_start (GstBaseTransform * btrans)
     goto error;
   }
 
-#ifndef WITH_OPENCV
-  if (dsexample->blur_objects) {
-    GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
-          ("OpenCV has been deprecated, hence object blurring will not work."
-          "Enable OpenCV compilation in gst-dsexample Makefile by setting 'WITH_OPENCV:=1"), (NULL));
-    goto error;
+  /* Zones are masked by a backend, the CPU one works on mapped surfaces */
+  dsexample->mask_backend = zone_mask_backend_new_cpu ();
+  GST_DEBUG_OBJECT (dsexample, "Masking zones with the %s backend",
+      dsexample->mask_backend->name ());
+
+  /* The streaming thread masks one frame of the batch itself */
+  if (dsexample->blur_objects && dsexample->mask_threads > 1 &&
+      dsexample->batch_size > 1) {
+    dsexample->mask_pool = g_thread_pool_new (mask_job_run, dsexample,
+        MIN (dsexample->mask_threads, dsexample->batch_size) - 1, TRUE, NULL);
+    if (!dsexample->mask_pool) {
+      GST_ERROR ("Error: Could not create the zone masking threads");
+      goto error;
+    }
   }
-#endif
 
   CHECK_CUDA_STATUS (cudaStreamCreate (&dsexample->cuda_stream),
       "Could not create cuda stream");
@@ -473,8 +526,12 @@ gst_dsexample_stop (GstBaseTransform * btrans)
     g_free(dsexample->config_file_path);
     dsexample->config_file_path = NULL;
   }
-  //clearing contours vector
-  contours.clear();
+  if (dsexample->mask_pool) {
+    g_thread_pool_free (dsexample->mask_pool, FALSE, TRUE);
+    dsexample->mask_pool = NULL;
+  }
+  delete dsexample->mask_backend;
+  dsexample->mask_backend = NULL;
   
   GST_DEBUG_OBJECT (dsexample, "deleted CV Mat \n");
 
@@ -496,12 +553,24 @@ gst_dsexample_set_caps (GstBaseTransform * btrans, GstCaps * incaps,
   gst_video_info_from_caps (&dsexample->video_info, incaps);
 
   if (dsexample->blur_objects && !dsexample->process_full_frame) {
-    /* requires RGBA format for blurring the objects in opencv */
-     if (dsexample->video_info.finfo->format != GST_VIDEO_FORMAT_RGBA) {
-      GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
-          ("input format should be RGBA when using blur-objects property"), (NULL));
-      goto error;
-      }
+    /* Zones are masked in the decoder's format, no conversion to RGBA needed */
+    switch (GST_VIDEO_INFO_FORMAT (&dsexample->video_info)) {
+      case GST_VIDEO_FORMAT_RGBA:
+      case GST_VIDEO_FORMAT_NV12:
+      case GST_VIDEO_FORMAT_I420:
+        break;
+      default:
+        GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
+            ("input format should be RGBA, NV12 or I420 when using blur-objects property"), (NULL));
+        goto error;
+    }
+    subsample_zone_masks (dsexample, dsexample->zone_masks);
+    dsexample->mask_backend->prepare (dsexample->zone_masks->fallback.full);
+    dsexample->mask_backend->prepare (dsexample->zone_masks->fallback.half);
+    for (const auto & source : dsexample->zone_masks->sources) {
+      dsexample->mask_backend->prepare (source.second.full);
+      dsexample->mask_backend->prepare (source.second.half);
+    }
   }
 
   return TRUE;
@@ -511,41 +580,165 @@ error:
 }
 
 
-#ifdef WITH_OPENCV
 /*
- * Blur the detected objects when processing in object mode (full-frame=0)
+ * Chroma masks for the negotiated frame size, unclipped before caps are known
  */
-static GstFlowReturn
-blur_objects (GstDsExample * dsexample, gint idx,
-    std::vector<std::vector<cv::Point>> contours, cv::Mat in_mat)
+static void
+subsample_zone_masks (GstDsExample * dsexample, ZoneMaskSet * masks)
 {
-  cv::fillPoly(in_mat, contours, cv::Scalar(0, 0, 0));
-  GST_DEBUG_OBJECT(dsexample, "filled");
-  return GST_FLOW_OK;
+  gint width = GST_VIDEO_INFO_WIDTH (&dsexample->video_info);
+  gint height = GST_VIDEO_INFO_HEIGHT (&dsexample->video_info);
+  if (width <= 0 || height <= 0)
+    width = height = G_MAXINT;
+
+  zone_mask_subsample (masks->fallback.full, width, height, &masks->fallback.half);
+  for (auto & source : masks->sources)
+    zone_mask_subsample (source.second.full, width, height, &source.second.half);
+}
+
+/*
+ * Map one frame of the batch for the backend and describe its plane
+ */
+static gboolean
+map_mask_job (GstDsExample * dsexample, NvBufSurface * surface,
+    GstDsExampleMaskJob * job)
+{
+  gint idx = job->batch_id;
+  NvBufSurfaceParams *params = &surface->surfaceList[idx];
+  gboolean cpu_access = dsexample->mask_backend->needs_cpu_access ();
+  gboolean rgba = GST_VIDEO_INFO_FORMAT (&dsexample->video_info) == GST_VIDEO_FORMAT_RGBA;
+
+  if (cpu_access) {
+    /* Map the buffer so that it can be accessed by CPU */
+    if (params->mappedAddr.addr[0] == NULL &&
+        NvBufSurfaceMap (surface, idx, -1, NVBUF_MAP_READ_WRITE) != 0) {
+      GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
+          ("%s:buffer map to be accessed by CPU failed", __func__), (NULL));
+      return FALSE;
+    }
+
+    /* Cache the mapped data for CPU access */
+    if (dsexample->inter_buf->memType == NVBUF_MEM_SURFACE_ARRAY)
+      NvBufSurfaceSyncForCpu (surface, idx, -1);
+  }
+
+  job->num_planes = MIN (params->planeParams.num_planes, G_N_ELEMENTS (job->planes));
+  for (guint p = 0; p < job->num_planes; p++) {
+    ZoneMaskPlane *plane = &job->planes[p];
+    plane->data = cpu_access ? (guint8 *) params->mappedAddr.addr[p] :
+        (guint8 *) params->dataPtr + params->planeParams.offset[p];
+    plane->pitch = params->planeParams.pitch[p];
+    plane->width = params->planeParams.width[p];
+    plane->height = params->planeParams.height[p];
+    plane->bytes_per_pixel = params->planeParams.bytesPerPix[p];
+    /* Black with zero alpha, as cv::fillPoly with Scalar(0, 0, 0) used to
+     * write, or black luma and neutral chroma */
+    zone_mask_plane_fill (rgba, p, plane->fill);
+  }
+  return TRUE;
+}
+
+/*
+ * Black out the zones of one frame, on the streaming thread or a pool thread
+ */
+static void
+mask_job_run (gpointer data, gpointer user_data)
+{
+  GstDsExampleMaskJob *job = (GstDsExampleMaskJob *) data;
+  GstDsExample *dsexample = GST_DSEXAMPLE (user_data);
+
+  job->ok = TRUE;
+  for (guint p = 0; p < job->num_planes; p++) {
+    job->ok &= dsexample->mask_backend->apply (job->mask->plane (p), job->planes[p]);
+  }
+
+  g_mutex_lock (&dsexample->mask_lock);
+  if (--dsexample->mask_pending == 0)
+    g_cond_signal (&dsexample->mask_done);
+  g_mutex_unlock (&dsexample->mask_lock);
+}
+
+/*
+ * Mask all frames of the batch in parallel and wait for them
+ */
+static gboolean
+run_mask_jobs (GstDsExample * dsexample)
+{
+  std::vector<GstDsExampleMaskJob> &jobs = *dsexample->mask_jobs;
+  gboolean ok = TRUE;
+
+  if (jobs.empty ())
+    return TRUE;
+
+  dsexample->mask_pending = jobs.size ();
+  for (gsize i = 1; i < jobs.size (); i++) {
+    if (dsexample->mask_pool)
+      g_thread_pool_push (dsexample->mask_pool, &jobs[i], NULL);
+    else
+      mask_job_run (&jobs[i], dsexample);
+  }
+  mask_job_run (&jobs[0], dsexample);
+
+  g_mutex_lock (&dsexample->mask_lock);
+  while (dsexample->mask_pending)
+    g_cond_wait (&dsexample->mask_done, &dsexample->mask_lock);
+  g_mutex_unlock (&dsexample->mask_lock);
+
+  for (const GstDsExampleMaskJob & job : jobs)
+    ok &= job.ok;
+  return ok;
 }
-#endif
 
 /* parses points from strings */
-static std::vector<cv::Point> parse_contours(const gchar *points_str) {
-    std::vector<cv::Point> points;
+static ZonePolygon parse_contours(const gchar *points_str) {
+    ZonePolygon points;
     std::istringstream ss(points_str);
     std::string point;
     while (std::getline(ss, point, ';')) {
-        int x, y;
-        sscanf(point.c_str(), "%d,%d", &x, &y);
-        points.emplace_back(x, y);
+        ZonePoint p;
+        if (sscanf(point.c_str(), "%d,%d", &p.x, &p.y) == 2)
+            points.push_back(p);
+        else
+            g_warning("Ignoring malformed contour point '%s'", point.c_str());
     }
     return points;
 }
 
+/* Reads the polygons of one contours group */
+static std::vector<ZonePolygon> load_contours_group(GKeyFile *key_file, const gchar *group) {
+    std::vector<ZonePolygon> contours;
+    GError *error = NULL;
+    gsize num_keys;
+    gchar **keys = g_key_file_get_keys(key_file, group, &num_keys, &error);
+    if (error != NULL) {
+        g_warning("Failed to get keys of [%s] from config file: %s", group, error->message);
+        g_error_free(error);
+        return contours;
+    }
+    // Iterate through all contours in the group & add to contours vector
+    for (gsize i = 0; i < num_keys; i++) {
+        gchar *points_str = g_key_file_get_string(key_file, group, keys[i], &error);
+        if (error == NULL) {
+            contours.push_back(parse_contours(points_str));
+            g_free(points_str);
+        } else {
+            g_warning("Failed to get contour points for %s from config file: %s", keys[i], error->message);
+            g_error_free(error);
+            error = NULL; // Reset error for next iteration
+        }
+    }
+    g_strfreev(keys);
+    return contours;
+}
+
 /**
  * Called when trying to a load configs from a file
  */
 static void load_config_from_file(const gchar *file_path, GstDsExample *dsexample) {
     GKeyFile *key_file;
-    gchar **keys;
-    gsize num_keys;
+    gchar **groups;
     GError *error = NULL;
+    ZoneMaskSet masks;
 
     key_file = g_key_file_new();
     if (!g_key_file_load_from_file(key_file, file_path, G_KEY_FILE_NONE, &error)) {
@@ -554,29 +747,39 @@ static void load_config_from_file(const gchar *file_path, GstDsExample *dsexampl
         g_key_file_free(key_file);
         return;
     }
-    /* Gets all keys in the contours group */
-    keys = g_key_file_get_keys(key_file, "contours", &num_keys, &error);
-    if (error != NULL) {
-        g_warning("Failed to get keys from config file: %s", error->message);
-        g_error_free(error);
-        g_key_file_free(key_file);
-        return;
-    }
-    // Iterate through all contours in the group & add to contours vector
-    for (gsize i = 0; i < num_keys; i++) {
-        gchar *points_str = g_key_file_get_string(key_file, "contours", keys[i], &error);
-        if (error == NULL) {
-            std::vector<cv::Point> contour = parse_contours(points_str);
-            contours.push_back(contour);
-            g_free(points_str);
+
+    /* [contours] applies to every source, [contours-stream-<source_id>]
+     * replaces it for one source. The zones are static, so the per-row spans
+     * are computed once here instead of scan converting the polygons on
+     * every frame. */
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (gchar **group = groups; *group; group++) {
+        ZoneMaskSource *mask;
+        if (g_strcmp0(*group, CONTOURS_GROUP) == 0) {
+            mask = &masks.fallback;
+        } else if (g_str_has_prefix(*group, CONTOURS_STREAM_GROUP_PREFIX)) {
+            const gchar *id = *group + strlen(CONTOURS_STREAM_GROUP_PREFIX);
+            gchar *end = NULL;
+            guint64 source_id = g_ascii_strtoull(id, &end, 10);
+            if (end == id || *end != '\0' || source_id > G_MAXUINT) {
+                g_warning("Ignoring config group [%s], expected [%s<source id>]",
+                    *group, CONTOURS_STREAM_GROUP_PREFIX);
+                continue;
+            }
+            mask = &masks.sources[(guint) source_id];
         } else {
-            g_warning("Failed to get contour points for %s from config file: %s", keys[i], error->message);
-            g_error_free(error);
-            error = NULL; // Reset error for next iteration
+            continue;
         }
+        std::vector<ZonePolygon> contours = load_contours_group(key_file, *group);
+        zone_mask_compile(contours, &mask->full);
+        GST_DEBUG_OBJECT(dsexample, "Compiled %u contours of [%s] into %u spans over %d rows",
+            (guint) contours.size(), *group, (guint) mask->full.spans.size(), mask->full.height);
     }
-    g_strfreev(keys);
+    g_strfreev(groups);
     g_key_file_free(key_file);
+
+    subsample_zone_masks(dsexample, &masks);
+    *dsexample->zone_masks = std::move(masks);
 }
 /**
  * Called when element recieves an input buffer from upstream element.
@@ -623,68 +826,45 @@ gst_dsexample_transform_ip (GstBaseTransform * btrans, GstBuffer * inbuf)
 
 
     if(!dsexample->is_integrated) {
-      if (dsexample->blur_objects) {
+      if (dsexample->blur_objects && dsexample->mask_backend->needs_cpu_access ()) {
         if (!(surface->memType == NVBUF_MEM_CUDA_UNIFIED || surface->memType == NVBUF_MEM_CUDA_PINNED)){
           GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
-              ("%s:need NVBUF_MEM_CUDA_UNIFIED or NVBUF_MEM_CUDA_PINNED memory for opencv blurring",__func__), (NULL));
+              ("%s:need NVBUF_MEM_CUDA_UNIFIED or NVBUF_MEM_CUDA_PINNED memory for CPU zone masking",__func__), (NULL));
           return GST_FLOW_ERROR;
         }
       }
     }
 
-    for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
-      l_frame = l_frame->next)
+    dsexample->mask_jobs->clear ();
+    for (l_frame = batch_meta->frame_meta_list; l_frame != NULL &&
+        dsexample->blur_objects; l_frame = l_frame->next)
     {
       frame_meta = (NvDsFrameMeta *) (l_frame->data);
 
-#ifdef WITH_OPENCV
-      cv::Mat in_mat;
-
-      if (dsexample->blur_objects) {
-        /* Map the buffer so that it can be accessed by CPU */
-        
-        if (surface->surfaceList[frame_meta->batch_id].mappedAddr.addr[0] == NULL){
-          if (NvBufSurfaceMap (surface, frame_meta->batch_id, 0, NVBUF_MAP_READ_WRITE) != 0){
-            GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
-                ("%s:buffer map to be accessed by CPU failed", __func__), (NULL));
-            return GST_FLOW_ERROR;
-          }
-        }
-
-        /* Cache the mapped data for CPU access */
-        if(dsexample->inter_buf->memType == NVBUF_MEM_SURFACE_ARRAY)
-          NvBufSurfaceSyncForCpu (surface, frame_meta->batch_id, 0);
-
-        in_mat =
-            cv::Mat (surface->surfaceList[frame_meta->batch_id].planeParams.height[0],
-            surface->surfaceList[frame_meta->batch_id].planeParams.width[0], CV_8UC4,
-            surface->surfaceList[frame_meta->batch_id].mappedAddr.addr[0],
-            surface->surfaceList[frame_meta->batch_id].planeParams.pitch[0]);
-
-        /* blurring of pixels to black */
-        if (blur_objects (dsexample, frame_meta->batch_id,
-            contours, in_mat) != GST_FLOW_OK) {
-          /* Error in blurring, skip processing on object. */
-            GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
-            ("blurring the object failed"), (NULL));
-            if (NvBufSurfaceUnMap (surface, frame_meta->batch_id, 0)){
-              GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
-                ("%s:buffer unmap to be accessed by CPU failed", __func__), (NULL));
-            }
-            return GST_FLOW_ERROR;
-          }
-      }
-#endif
-
-      }
+      GstDsExampleMaskJob job;
+      job.mask = dsexample->zone_masks->lookup (frame_meta->source_id);
+      job.batch_id = frame_meta->batch_id;
+      job.ok = FALSE;
+      if (job.mask->full.spans.empty ())
+        continue;
+      if (!map_mask_job (dsexample, surface, &job))
+        goto error;
+      dsexample->mask_jobs->push_back (job);
+    }
 
-      if (dsexample->blur_objects) {
-      /* Cache the mapped data for device access */
-        if(dsexample->inter_buf->memType == NVBUF_MEM_SURFACE_ARRAY) 
-          NvBufSurfaceSyncForDevice (surface, frame_meta->batch_id, 0);
+    /* blackout of the zone pixels */
+    if (!run_mask_jobs (dsexample)) {
+      GST_ELEMENT_ERROR (dsexample, STREAM, FAILED,
+          ("masking the zones failed"), (NULL));
+      goto error;
+    }
 
-      }
-    
+    /* Cache the mapped data for device access */
+    if (dsexample->mask_backend->needs_cpu_access () &&
+        dsexample->inter_buf->memType == NVBUF_MEM_SURFACE_ARRAY) {
+      for (const GstDsExampleMaskJob & job : *dsexample->mask_jobs)
+        NvBufSurfaceSyncForDevice (surface, job.batch_id, -1);
+    }
 
   flow_ret = GST_FLOW_OK;
 
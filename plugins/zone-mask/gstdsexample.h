@@ -43,6 +43,7 @@
 #include "nvbufsurftransform.h"
 #include "gst-nvquery.h"
 #include "gstnvdsmeta.h"
+#include "zone_mask.h"
 
 /* Package and library details required for plugin_init */
 #define PACKAGE "dsexample"
@@ -57,6 +58,7 @@ G_BEGIN_DECLS
 /* Standard boilerplate stuff */
 typedef struct _GstDsExample GstDsExample;
 typedef struct _GstDsExampleClass GstDsExampleClass;
+typedef struct _GstDsExampleMaskJob GstDsExampleMaskJob;
 
 /* Standard boilerplate stuff */
 #define GST_TYPE_DSEXAMPLE (gst_dsexample_get_type())
@@ -67,6 +69,17 @@ typedef struct _GstDsExampleClass GstDsExampleClass;
 #define GST_IS_DSEXAMPLE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_DSEXAMPLE))
 #define GST_DSEXAMPLE_CAST(obj)  ((GstDsExample *)(obj))
 
+// Masking of one frame of the batch, plane 0 with the full resolution mask,
+// the chroma planes of NV12 / I420 with the subsampled one
+struct _GstDsExampleMaskJob
+{
+  const ZoneMaskSource *mask;
+  ZoneMaskPlane planes[3];
+  guint num_planes;
+  gint batch_id;
+  gboolean ok;
+};
+
 struct _GstDsExample
 {
   GstBaseTransform base_trans;
@@ -116,6 +129,24 @@ struct _GstDsExample
   
   // String indicating file path for the config file
   gchar* config_file_path;
+
+  // Zones of each source compiled to spans when the config is loaded, and
+  // the backend masking them
+  ZoneMaskSet *zone_masks;
+  ZoneMaskBackend *mask_backend;
+
+  // Number of threads masking the frames of a batch, including the
+  // streaming thread
+  guint mask_threads;
+
+  // Workers for all but the first frame of a batch, NULL if mask_threads is 1
+  GThreadPool *mask_pool;
+
+  // Frames of the current batch, and the count still being masked
+  std::vector<GstDsExampleMaskJob> *mask_jobs;
+  GMutex mask_lock;
+  GCond mask_done;
+  guint mask_pending;
 };
 
 // Boiler plate stuff
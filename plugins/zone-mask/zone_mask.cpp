@@ -0,0 +1,163 @@
+#include "zone_mask.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+/* Bytes of the replicated fill pattern, a multiple of every supported pixel size */
+#define ZONE_MASK_PATTERN_BYTES 32
+
+/* Sort the spans of the next row and merge them, so overlapping zones write
+ * every pixel once */
+static void
+append_row (ZoneMask * mask, std::vector<ZoneSpan> & row)
+{
+  std::sort (row.begin (), row.end (),
+      [] (const ZoneSpan & a, const ZoneSpan & b) { return a.x0 < b.x0; });
+  for (const ZoneSpan & span : row) {
+    if (mask->spans.size () > mask->row_offsets.back () &&
+        span.x0 <= mask->spans.back ().x1)
+      mask->spans.back ().x1 = MAX (mask->spans.back ().x1, span.x1);
+    else
+      mask->spans.push_back (span);
+  }
+  mask->row_offsets.push_back ((guint32) mask->spans.size ());
+}
+
+void
+zone_mask_compile (const std::vector<ZonePolygon> & polygons, ZoneMask * mask)
+{
+  std::vector<gdouble> crossings;
+  std::vector<ZoneSpan> row;
+  gint height = 0;
+
+  for (const ZonePolygon & polygon : polygons) {
+    for (const ZonePoint & p : polygon)
+      height = MAX (height, p.y + 1);
+  }
+
+  mask->height = height;
+  mask->spans.clear ();
+  mask->row_offsets.assign (1, 0);
+  mask->row_offsets.reserve (height + 1);
+
+  for (gint y = 0; y < height; y++) {
+    gdouble yc = y + 0.5;
+
+    row.clear ();
+    for (const ZonePolygon & polygon : polygons) {
+      gsize n = polygon.size ();
+      if (n < 3)
+        continue;
+      crossings.clear ();
+      for (gsize i = 0; i < n; i++) {
+        const ZonePoint & a = polygon[i];
+        const ZonePoint & b = polygon[(i + 1) % n];
+        /* Half open in y so a vertex on the scanline is counted once */
+        if ((a.y <= yc) != (b.y <= yc))
+          crossings.push_back (a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y));
+      }
+      std::sort (crossings.begin (), crossings.end ());
+      /* Pixels whose centre lies in [left, right) */
+      for (gsize i = 0; i + 1 < crossings.size (); i += 2) {
+        ZoneSpan span;
+        span.x0 = (gint) MAX (ceil (crossings[i] - 0.5), 0);
+        span.x1 = (gint) MIN (ceil (crossings[i + 1] - 0.5), G_MAXINT);
+        if (span.x0 < span.x1)
+          row.push_back (span);
+      }
+    }
+    append_row (mask, row);
+  }
+}
+
+void
+zone_mask_subsample (const ZoneMask & full, gint width, gint height, ZoneMask * half)
+{
+  std::vector<ZoneSpan> row;
+  gint rows = MIN (full.height, height);
+
+  half->height = (gint) (((gint64) rows + 1) / 2);
+  half->spans.clear ();
+  half->row_offsets.assign (1, 0);
+  half->row_offsets.reserve (half->height + 1);
+
+  for (gint y = 0; y < half->height; y++) {
+    row.clear ();
+    for (gint fy = 2 * y; fy < MIN (2 * y + 2, rows); fy++) {
+      for (const ZoneSpan * span = full.row_begin (fy); span != full.row_end (fy); span++) {
+        if (span->x0 >= width)
+          break;
+        ZoneSpan sub;
+        sub.x0 = span->x0 / 2;
+        sub.x1 = (gint) (((gint64) MIN (span->x1, width) + 1) / 2);
+        row.push_back (sub);
+      }
+    }
+    append_row (half, row);
+  }
+}
+
+void
+zone_mask_plane_fill (gboolean rgba, guint index, guint8 fill[4])
+{
+  memset (fill, rgba ? 0 : (index == 0 ? ZONE_MASK_LUMA_BLACK : ZONE_MASK_CHROMA_NEUTRAL), 4);
+}
+
+/* Write bytes of the repeated pattern. The span starts on a pixel boundary and
+ * the pattern length is a multiple of the pixel size, so it stays in phase. */
+static void
+fill_pattern (guint8 * dst, gsize bytes, const guint8 * pattern)
+{
+  for (; bytes >= ZONE_MASK_PATTERN_BYTES; bytes -= ZONE_MASK_PATTERN_BYTES, dst += ZONE_MASK_PATTERN_BYTES)
+    memcpy (dst, pattern, ZONE_MASK_PATTERN_BYTES);
+  memcpy (dst, pattern, bytes);
+}
+
+class ZoneMaskCpuBackend : public ZoneMaskBackend
+{
+public:
+  const gchar *name () const override { return "cpu"; }
+  gboolean needs_cpu_access () const override { return TRUE; }
+
+  gboolean apply (const ZoneMask & mask, const ZoneMaskPlane & plane) override
+  {
+    gint bpp = plane.bytes_per_pixel;
+    if (bpp != 1 && bpp != 2 && bpp != 4)
+      return FALSE;
+
+    /* Single byte fills (black RGBA, luma, neutral chroma) go to memset */
+    gboolean uniform = TRUE;
+    guint8 pattern[ZONE_MASK_PATTERN_BYTES];
+    for (gint i = 0; i < ZONE_MASK_PATTERN_BYTES; i++) {
+      pattern[i] = plane.fill[i % bpp];
+      uniform &= pattern[i] == plane.fill[0];
+    }
+
+    gint rows = MIN (mask.height, plane.height);
+    for (gint y = 0; y < rows; y++) {
+      guint8 *line = plane.data + (gsize) y * plane.pitch;
+      for (const ZoneSpan * span = mask.row_begin (y); span != mask.row_end (y); span++) {
+        if (span->x0 >= plane.width)
+          break;
+        fill_span (line, span->x0, MIN (span->x1, plane.width), bpp, uniform, pattern);
+      }
+    }
+    return TRUE;
+  }
+
+private:
+  static void fill_span (guint8 * line, gint x0, gint x1, gint bpp,
+      gboolean uniform, const guint8 * pattern)
+  {
+    if (uniform)
+      memset (line + (gsize) x0 * bpp, pattern[0], (gsize) (x1 - x0) * bpp);
+    else
+      fill_pattern (line + (gsize) x0 * bpp, (gsize) (x1 - x0) * bpp, pattern);
+  }
+};
+
+ZoneMaskBackend *
+zone_mask_backend_new_cpu ()
+{
+  return new ZoneMaskCpuBackend ();
+}
@@ -0,0 +1,111 @@
+#ifndef __ZONE_MASK_H__
+#define __ZONE_MASK_H__
+
+#include <glib.h>
+#include <unordered_map>
+#include <vector>
+
+/* Polygon vertex in frame pixels, as written in the [contours] config group */
+struct ZonePoint
+{
+  gint x;
+  gint y;
+};
+
+typedef std::vector<ZonePoint> ZonePolygon;
+
+/* Masked pixels x0 <= x < x1 of one row */
+struct ZoneSpan
+{
+  gint x0;
+  gint x1;
+};
+
+/* The zones compiled once into sorted, disjoint spans per row. Coordinates
+ * are frame pixels, spans are clipped to the plane when applied, so the same
+ * mask works for any resolution the polygons were drawn for. */
+struct ZoneMask
+{
+  gint height = 0;                      // rows below have no spans
+  std::vector<guint32> row_offsets;     // height + 1 offsets into spans
+  std::vector<ZoneSpan> spans;
+
+  const ZoneSpan *row_begin (gint y) const { return spans.data () + row_offsets[y]; }
+  const ZoneSpan *row_end (gint y) const { return spans.data () + row_offsets[y + 1]; }
+};
+
+/* Compile the union of the polygons, sampled at pixel centres, each polygon
+ * filled with the even-odd rule. Called when the config is loaded. */
+void zone_mask_compile (const std::vector<ZonePolygon> & polygons, ZoneMask * mask);
+
+/* The zones of one source at frame resolution, and subsampled 2x2 for the
+ * chroma planes of NV12 / I420 */
+struct ZoneMaskSource
+{
+  ZoneMask full;
+  ZoneMask half;
+
+  /* Mask of plane index of an RGBA, NV12 or I420 frame */
+  const ZoneMask & plane (guint index) const { return index == 0 ? full : half; }
+};
+
+/* A chroma sample is masked if any of the 2x2 pixels it covers is, so no
+ * colour of a masked pixel survives the subsampling. Only pixels of a
+ * width x height frame count, so the half covered samples of odd frame
+ * edges are not masked for zones beyond the frame. */
+void zone_mask_subsample (const ZoneMask & full, gint width, gint height, ZoneMask * half);
+
+/* The zones of every source of a batch, keyed by NvDsFrameMeta source_id.
+ * Sources without zones of their own use the fallback. */
+struct ZoneMaskSet
+{
+  ZoneMaskSource fallback;
+  std::unordered_map<guint, ZoneMaskSource> sources;
+
+  const ZoneMaskSource *lookup (guint source_id) const
+  {
+    auto it = sources.find (source_id);
+    return it != sources.end () ? &it->second : &fallback;
+  }
+};
+
+/* One plane of a frame, masked in place. fill holds the bytes of one masked
+ * pixel, e.g. {0, 0, 0, 0} for RGBA, {16} for luma, {128, 128} for NV12 UV. */
+struct ZoneMaskPlane
+{
+  guint8 *data;
+  gint pitch;                   // bytes per row
+  gint width;                   // pixels
+  gint height;
+  gint bytes_per_pixel;         // 1, 2 or 4
+  guint8 fill[4];
+};
+
+/* Masked pixels in NV12 / I420, black as the RGBA path gives after conversion */
+#define ZONE_MASK_LUMA_BLACK 16
+#define ZONE_MASK_CHROMA_NEUTRAL 128
+
+/* Bytes of one masked pixel of plane index: black with zero alpha for RGBA,
+ * black luma and neutral chroma for NV12 / I420 */
+void zone_mask_plane_fill (gboolean rgba, guint index, guint8 fill[4]);
+
+/* Applies a mask to frames. The CPU backend is the reference; a GPU backend
+ * can work on device memory and skip mapping the surface. apply() is called
+ * concurrently for different frames of a batch. */
+class ZoneMaskBackend
+{
+public:
+  virtual ~ZoneMaskBackend () {}
+  virtual const gchar *name () const = 0;
+  /* TRUE if planes must be mapped for CPU access before apply() */
+  virtual gboolean needs_cpu_access () const = 0;
+  /* Called before the first apply() of a mask, e.g. to upload it */
+  virtual void prepare (const ZoneMask & mask) { (void) mask; }
+  virtual gboolean apply (const ZoneMask & mask, const ZoneMaskPlane & plane) = 0;
+};
+
+/* memset per span. Every fill zone_mask_plane_fill gives is a single repeated
+ * byte; other multi-byte fills are copied from a repeated pattern. */
+ZoneMaskBackend *zone_mask_backend_new_cpu ();
+
+#endif /* __ZONE_MASK_H__ */
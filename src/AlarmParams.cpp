@@ -0,0 +1,160 @@
+#include "AlarmParams.h"
+#include <glib-unix.h>
+#include <glog/logging.h>
+#include <csignal>
+
+#define CHECK_ERROR(error) \
+    if (error) { \
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - Error while parsing config file: " << error->message; \
+        goto done; \
+    }
+
+bool AlarmParams::is_vehicle_class(int class_id) const {
+    for (int vehicle_class_id : vehicle_class_ids) {
+        if (class_id == vehicle_class_id)
+            return true;
+    }
+    return false;
+}
+
+static gboolean
+validate_alarm_params (const AlarmParams *params)
+{
+    if (params->alarm_window <= 0) {
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - " << CONFIG_ALARM_WINDOW << " must be positive";
+        return FALSE;
+    }
+    if (params->person_detected_frames_limit < 0 || params->person_detected_frames_limit > params->alarm_window ||
+        params->vehicle_detected_frames_limit < 0 || params->vehicle_detected_frames_limit > params->alarm_window) {
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - Frame limits must be within the alarm window";
+        return FALSE;
+    }
+    if (params->box_motion_percentage < 0 || params->box_motion_percentage > 1) {
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - " << CONFIG_ALARM_BOX_MOTION_PERCENTAGE << " must be in [0, 1]";
+        return FALSE;
+    }
+    if (params->backoff_base_interval <= 0 || params->backoff_max_interval < params->backoff_base_interval ||
+        params->recording_frequency_threshold <= 0) {
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - Invalid recording backoff settings";
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+alarm_params_load (const char *config_path, AlarmParams *params)
+{
+    gboolean ret = FALSE;
+    GError *error = NULL;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GKeyFile *key_file = g_key_file_new ();
+
+    if (!g_key_file_load_from_file (key_file, config_path, G_KEY_FILE_NONE, &error)) {
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - Failed to load config file: " << error->message;
+        goto done;
+    }
+
+    keys = g_key_file_get_keys (key_file, CONFIG_GROUP_ALARM, NULL, &error);
+    CHECK_ERROR (error);
+
+    for (key = keys; *key; key++) {
+        if (!g_strcmp0 (*key, CONFIG_ALARM_WINDOW)) {
+            params->alarm_window = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_PERSON_FRAMES_LIMIT)) {
+            params->person_detected_frames_limit = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_VEHICLE_FRAMES_LIMIT)) {
+            params->vehicle_detected_frames_limit = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_PERSON_CLASS_ID)) {
+            params->person_class_id = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_VEHICLE_CLASS_IDS)) {
+            gsize length = 0;
+            gint *class_ids = g_key_file_get_integer_list (key_file, CONFIG_GROUP_ALARM, *key, &length, &error);
+            CHECK_ERROR (error);
+            params->vehicle_class_ids.assign (class_ids, class_ids + length);
+            g_free (class_ids);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_PERSON_DETECTION)) {
+            params->person_detection_enabled = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_VEHICLE_DETECTION)) {
+            params->vehicle_detection_enabled = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_INCIDENT_START_TIME)) {
+            params->incident_start_time = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_INCIDENT_DURATION)) {
+            params->incident_duration = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_BLOCK_MOTION_THRESHOLD)) {
+            params->block_motion_threshold = g_key_file_get_double (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_BOX_MOTION_PERCENTAGE)) {
+            params->box_motion_percentage = g_key_file_get_double (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_BACKOFF_BASE_INTERVAL)) {
+            params->backoff_base_interval = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_BACKOFF_MAX_INTERVAL)) {
+            params->backoff_max_interval = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else if (!g_strcmp0 (*key, CONFIG_ALARM_RECORDING_FREQUENCY)) {
+            params->recording_frequency_threshold = g_key_file_get_integer (key_file, CONFIG_GROUP_ALARM, *key, &error);
+        } else {
+            LOG(ERROR) << "[Deepstream] - [Alarm Config] - Unknown key " << *key << " for group " << CONFIG_GROUP_ALARM;
+        }
+        CHECK_ERROR (error);
+    }
+
+    ret = validate_alarm_params (params);
+done:
+    if (error) {
+        g_error_free (error);
+    }
+    if (keys) {
+        g_strfreev (keys);
+    }
+    g_key_file_free (key_file);
+    return ret;
+}
+
+AlarmParamsStore::AlarmParamsStore(const AlarmParams &base, const std::string &config_path)
+    : base(base), config_path(config_path), current(std::make_shared<AlarmParams>(base)), monitor(NULL) {
+}
+
+gboolean AlarmParamsStore::reload() {
+    if (!g_file_test (config_path.c_str (), G_FILE_TEST_EXISTS)) {
+        LOG(INFO) << "[Deepstream] - [Alarm Config] - " << config_path << " not found, using defaults";
+        return FALSE;
+    }
+
+    std::shared_ptr<AlarmParams> params = std::make_shared<AlarmParams>(base);
+    if (!alarm_params_load (config_path.c_str (), params.get ())) {
+        LOG(ERROR) << "[Deepstream] - [Alarm Config] - Keeping current alarm parameters";
+        return FALSE;
+    }
+
+    /* A probe still holding the old block keeps it alive until it returns */
+    std::atomic_store (&current, std::shared_ptr<const AlarmParams> (params));
+    LOG(INFO) << "[Deepstream] - [Alarm Config] - Alarm parameters reloaded from " << config_path;
+    return TRUE;
+}
+
+static gboolean
+on_alarm_params_sighup (gpointer data)
+{
+    ((AlarmParamsStore *) data)->reload ();
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+on_alarm_params_changed (GFileMonitor *monitor, GFile *file, GFile *other_file,
+    GFileMonitorEvent event_type, gpointer data)
+{
+    if (event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT || event_type == G_FILE_MONITOR_EVENT_CREATED)
+        ((AlarmParamsStore *) data)->reload ();
+}
+
+void AlarmParamsStore::watch() {
+    g_unix_signal_add (SIGHUP, on_alarm_params_sighup, this);
+
+    GFile *file = g_file_new_for_path (config_path.c_str ());
+    monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+    g_object_unref (file);
+    if (monitor) {
+        g_signal_connect (monitor, "changed", G_CALLBACK (on_alarm_params_changed), this);
+    } else {
+        LOG(WARNING) << "[Deepstream] - [Alarm Config] - Unable to watch " << config_path << ", use SIGHUP to reload";
+    }
+}
@@ -0,0 +1,153 @@
+#include "AsyncLog.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#define ASYNC_LOG_IDLE_SLEEP_MS 20
+
+static_assert((ASYNC_LOG_RING_SIZE & (ASYNC_LOG_RING_SIZE - 1)) == 0,
+    "ASYNC_LOG_RING_SIZE must be a power of two");
+
+static int64_t
+monotonic_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LogRateLimiter::LogRateLimiter(double rate_per_sec, double burst)
+    : rate(rate_per_sec), burst(burst), tokens(burst), last_refill_us(monotonic_us()), suppressed(0) {
+}
+
+bool LogRateLimiter::allow() {
+    int64_t now = monotonic_us();
+    tokens += (now - last_refill_us) * rate / 1e6;
+    if (tokens > burst)
+        tokens = burst;
+    last_refill_us = now;
+
+    if (tokens >= 1.0) {
+        tokens -= 1.0;
+        return true;
+    }
+    suppressed++;
+    return false;
+}
+
+uint64_t LogRateLimiter::take_suppressed() {
+    uint64_t count = suppressed;
+    suppressed = 0;
+    return count;
+}
+
+/* Bounded multi-producer, single-consumer ring. Every slot carries a sequence
+ * number telling producers and the writer whether it is free or filled. */
+struct LogSlot {
+    std::atomic<size_t> seq;
+    int severity;
+    const char *file;
+    int line;
+    char text[ASYNC_LOG_LINE_MAX];
+};
+
+static LogSlot ring[ASYNC_LOG_RING_SIZE];
+static std::atomic<size_t> enqueue_pos{0};
+static size_t dequeue_pos = 0;
+static std::atomic<uint64_t> dropped{0};
+static std::atomic<bool> running{false};
+static std::thread writer;
+
+static void
+emit(int severity, const char *file, int line, const char *text)
+{
+    google::LogMessage(file, line, severity).stream() << text;
+}
+
+/* Writer thread: drain the ring into glog, sleep briefly when idle */
+static bool
+drain_one()
+{
+    LogSlot &slot = ring[dequeue_pos & (ASYNC_LOG_RING_SIZE - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != dequeue_pos + 1)
+        return false;
+
+    emit(slot.severity, slot.file, slot.line, slot.text);
+    slot.seq.store(dequeue_pos + ASYNC_LOG_RING_SIZE, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+static void
+writer_loop()
+{
+    while (running.load(std::memory_order_acquire)) {
+        if (!drain_one())
+            std::this_thread::sleep_for(std::chrono::milliseconds(ASYNC_LOG_IDLE_SLEEP_MS));
+    }
+    while (drain_one()) {
+    }
+}
+
+void async_log_start() {
+    if (running.load())
+        return;
+    for (size_t i = 0; i < ASYNC_LOG_RING_SIZE; i++)
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    enqueue_pos.store(0);
+    dequeue_pos = 0;
+    running.store(true, std::memory_order_release);
+    writer = std::thread(writer_loop);
+}
+
+void async_log_stop() {
+    if (!running.exchange(false))
+        return;
+    writer.join();
+    if (dropped.load())
+        LOG(WARNING) << "[Logging] - Dropped " << dropped.load() << " log lines, ring buffer full";
+}
+
+void async_log_write(int severity, const char *file, int line, const char *fmt, ...) {
+    va_list args;
+
+    if (!running.load(std::memory_order_acquire)) {
+        char text[ASYNC_LOG_LINE_MAX];
+        va_start(args, fmt);
+        vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        emit(severity, file, line, text);
+        return;
+    }
+
+    LogSlot *slot;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &ring[pos & (ASYNC_LOG_RING_SIZE - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->severity = severity;
+    slot->file = file;
+    slot->line = line;
+    va_start(args, fmt);
+    vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    va_end(args);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+uint64_t async_log_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
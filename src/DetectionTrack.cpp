@@ -0,0 +1,77 @@
+#include "DetectionTrack.h"
+#include <glog/logging.h>
+#include <iterator>
+#include <string>
+
+DetectionTrack::DetectionTrack(guint history_sec)
+    : history_us((gint64) history_sec * G_USEC_PER_SEC) {
+}
+
+void DetectionTrack::add_frame(gint64 utc_us, std::vector<DetectionBox> &&boxes) {
+    std::lock_guard<std::mutex> guard(lock);
+    /* Frames without objects only matter as the end of the previous cue */
+    if (!boxes.empty() || (!frames.empty() && !frames.back().boxes.empty()))
+        frames.push_back(Frame{utc_us, std::move(boxes)});
+    while (!frames.empty() && frames.front().utc_us < utc_us - history_us)
+        frames.pop_front();
+}
+
+void DetectionTrack::set_history(guint history_sec) {
+    std::lock_guard<std::mutex> guard(lock);
+    history_us = MAX(history_us, (gint64) history_sec * G_USEC_PER_SEC);
+}
+
+static void
+append_cue_time(std::string *out, gint64 offset_us)
+{
+    gint64 ms = MAX(offset_us, 0) / 1000;
+    gchar stamp[32];
+    g_snprintf(stamp, sizeof(stamp), "%02d:%02d:%02d.%03d", (gint) (ms / 3600000),
+        (gint) (ms / 60000 % 60), (gint) (ms / 1000 % 60), (gint) (ms % 1000));
+    out->append(stamp);
+}
+
+gboolean DetectionTrack::write_webvtt(const gchar *clip_path, gint64 start_utc_us, gint64 end_utc_us) {
+    std::string vtt = "WEBVTT\n\n";
+    guint cues = 0;
+    gchar box[192];
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto it = frames.begin(); it != frames.end(); ++it) {
+            if (it->boxes.empty() || it->utc_us < start_utc_us)
+                continue;
+            if (it->utc_us > end_utc_us)
+                break;
+            gint64 cue_end_us = it->utc_us + DETECTION_TRACK_CUE_MAX_MS * 1000;
+            if (std::next(it) != frames.end())
+                cue_end_us = MIN(cue_end_us, std::next(it)->utc_us);
+
+            append_cue_time(&vtt, it->utc_us - start_utc_us);
+            vtt.append(" --> ");
+            append_cue_time(&vtt, cue_end_us - start_utc_us);
+            vtt.append("\n{\"boxes\":[");
+            for (gsize i = 0; i < it->boxes.size(); i++) {
+                const DetectionBox &b = it->boxes[i];
+                g_snprintf(box, sizeof(box),
+                    "%s{\"id\":%" G_GUINT64_FORMAT ",\"class\":%d,\"conf\":%.3f,\"x\":%.4f,\"y\":%.4f,\"w\":%.4f,\"h\":%.4f}",
+                    i ? "," : "", b.object_id, b.class_id, b.confidence, b.left, b.top, b.width, b.height);
+                vtt.append(box);
+            }
+            vtt.append("]}\n\n");
+            cues++;
+        }
+    }
+
+    GError *error = NULL;
+    gchar *vtt_path = g_strconcat(clip_path, DETECTION_TRACK_SUFFIX, NULL);
+    gboolean ret = g_file_set_contents(vtt_path, vtt.data(), vtt.size(), &error);
+    if (ret) {
+        LOG(INFO) << "[Deepstream] - [Detection Track] - Wrote " << cues << " cues to " << vtt_path;
+    } else {
+        LOG(ERROR) << "[Deepstream] - [Detection Track] - Failed to write " << vtt_path << ": " << error->message;
+        g_error_free(error);
+    }
+    g_free(vtt_path);
+    return ret;
+}
@@ -1,6 +1,7 @@
 #include "FixedSizeCounter.h"
 #include <glib.h>
 #include <glog/logging.h>
+#include "AsyncLog.h"
 
 
 FixedSizeCounter::FixedSizeCounter(int maxSize) : size(0), sum(0), oldestIndex(0), maxSize(maxSize) {
@@ -32,5 +33,19 @@ void FixedSizeCounter::reset_counter() {
         array[i] = 0;
     }
     sum = 0;
-    VLOG(2) << "[Deepstream] - [Alarm] - Counter Reset";
+    AVLOG_RATE(2, 1, 5, "[Deepstream] - [Alarm] - Counter Reset");
+}
+
+int FixedSizeCounter::get_max_size() const {
+    return maxSize;
+}
+
+/* Drops the current window, used when the alarm window is retuned at runtime */
+void FixedSizeCounter::resize(int newMaxSize) {
+    delete[] array;
+    array = new int[newMaxSize];
+    maxSize = newMaxSize;
+    size = 0;
+    sum = 0;
+    oldestIndex = 0;
 }
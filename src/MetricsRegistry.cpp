@@ -0,0 +1,134 @@
+#include "MetricsRegistry.h"
+#include <glog/logging.h>
+#include <sstream>
+
+#define METRICS_REQUEST_MAX_LEN 1024
+#define METRICS_SOCKET_TIMEOUT_SEC 1
+
+MetricsCounter *MetricsRegistry::add_counter(const std::string &name, const std::string &help) {
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.counter.reset(new MetricsCounter());
+    MetricsCounter *counter = entry.counter.get();
+    entries.push_back(std::move(entry));
+    return counter;
+}
+
+void MetricsRegistry::add_sampled_counter(const std::string &name, const std::string &help,
+    std::function<uint64_t()> sample) {
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.sampled_counter = std::move(sample);
+    entries.push_back(std::move(entry));
+}
+
+void MetricsRegistry::add_gauge(const std::string &name, const std::string &help, std::function<double()> sample) {
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.gauge = std::move(sample);
+    entries.push_back(std::move(entry));
+}
+
+void MetricsRegistry::set_const_labels(const std::string &labels) {
+    const_labels = labels;
+}
+
+std::string MetricsRegistry::render() const {
+    std::ostringstream oss;
+    std::string labels = const_labels.empty() ? "" : "{" + const_labels + "}";
+
+    for (const auto &entry : entries) {
+        oss << "# HELP " << entry.name << " " << entry.help << "\n";
+        if (entry.counter) {
+            oss << "# TYPE " << entry.name << " counter\n";
+            oss << entry.name << labels << " " << entry.counter->get() << "\n";
+        } else if (entry.sampled_counter) {
+            oss << "# TYPE " << entry.name << " counter\n";
+            oss << entry.name << labels << " " << entry.sampled_counter() << "\n";
+        } else {
+            oss << "# TYPE " << entry.name << " gauge\n";
+            oss << entry.name << labels << " " << entry.gauge() << "\n";
+        }
+    }
+    return oss.str();
+}
+
+MetricsRegistry &metrics_registry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+/* Answer a single scrape and close the connection. Runs on the main loop. */
+static gboolean
+on_metrics_connection (GSocketService *service, GSocketConnection *connection,
+    GObject *source_object, gpointer user_data)
+{
+    MetricsRegistry *registry = (MetricsRegistry *) user_data;
+    GInputStream *in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+    GOutputStream *out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+    gchar request[METRICS_REQUEST_MAX_LEN];
+    std::string status = "200 OK";
+    std::string body;
+
+    /* Do not let a silent client stall the main loop */
+    g_socket_set_timeout (g_socket_connection_get_socket (connection), METRICS_SOCKET_TIMEOUT_SEC);
+
+    gssize len = g_input_stream_read (in, request, sizeof (request) - 1, NULL, NULL);
+    if (len <= 0) {
+        g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+        return TRUE;
+    }
+    request[len] = '\0';
+
+    if (g_str_has_prefix (request, "GET /metrics") || g_str_has_prefix (request, "GET / ")) {
+        body = registry->render ();
+    } else {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.0 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size () << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    std::string payload = response.str ();
+
+    GError *error = NULL;
+    if (!g_output_stream_write_all (out, payload.data (), payload.size (), NULL, NULL, &error)) {
+        LOG(WARNING) << "[Metrics] - Failed to write response: " << error->message;
+        g_error_free (error);
+    }
+    g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+    return TRUE;
+}
+
+GSocketService *
+metrics_http_server_start (MetricsRegistry *registry, guint port)
+{
+    GError *error = NULL;
+    GSocketService *service = g_socket_service_new ();
+    GInetAddress *loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+    GSocketAddress *address = g_inet_socket_address_new (loopback, port);
+
+    gboolean bound = g_socket_listener_add_address (G_SOCKET_LISTENER (service), address,
+        G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, NULL, &error);
+    g_object_unref (address);
+    g_object_unref (loopback);
+
+    if (!bound) {
+        LOG(ERROR) << "[Metrics] - Unable to bind metrics port " << port << ": " << error->message;
+        g_error_free (error);
+        g_object_unref (service);
+        return NULL;
+    }
+
+    g_signal_connect (service, "incoming", G_CALLBACK (on_metrics_connection), registry);
+    g_socket_service_start (service);
+    LOG(INFO) << "[Metrics] - Serving metrics on http://127.0.0.1:" << port << "/metrics";
+    return service;
+}
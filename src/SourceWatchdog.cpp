@@ -0,0 +1,44 @@
+#include "SourceWatchdog.h"
+
+SourceWatchdog::SourceWatchdog(guint stall_timeout_sec, guint base_ms, guint max_ms, gdouble jitter)
+    : stall_timeout_us((gint64) stall_timeout_sec * G_USEC_PER_SEC), base_ms(base_ms),
+      max_ms(max_ms), jitter(jitter) {
+}
+
+void SourceWatchdog::branch_created(gint64 now_us) {
+    created_us = now_us;
+    streaming_since_us = 0;
+}
+
+SourceWatchdog::Verdict SourceWatchdog::tick(gint64 now_us) {
+    gint64 last_buffer = last_buffer_us.load(std::memory_order_relaxed);
+    gint64 reference = MAX(last_buffer, created_us);
+
+    if (now_us - reference > stall_timeout_us)
+        return SOURCE_STALLED;
+    if (last_buffer < created_us)
+        return SOURCE_WAITING;
+
+    Verdict verdict = SOURCE_WAITING;
+    if (!streaming_since_us) {
+        streaming_since_us = last_buffer;
+        verdict = SOURCE_STARTED;
+    }
+    /* Only a connection that stayed up resets the backoff */
+    if (reconnect_attempts && now_us - streaming_since_us > stall_timeout_us)
+        reconnect_attempts = 0;
+    return verdict;
+}
+
+guint SourceWatchdog::next_reconnect_delay_ms(gdouble random) {
+    guint64 delay = base_ms;
+    for (guint i = 0; i < reconnect_attempts && delay < max_ms; i++)
+        delay *= 2;
+    delay = MIN(delay, (guint64) max_ms);
+    /* Spread reconnects of cameras behind the same NVR/switch */
+    delay = (guint64) (delay * (1.0 - jitter + 2.0 * jitter * random));
+
+    reconnect_attempts++;
+    streaming_since_us = 0;
+    return (guint) delay;
+}
@@ -27,7 +27,7 @@
 GST_DEBUG_CATEGORY (NVDS_APP);
 int frame_num = 0;
 
-// alarm delaying constants
+// alarm delaying defaults, tunable through the alarm config file
 const std::chrono::seconds BASE_INTERVAL = std::chrono::seconds(60);
 const std::chrono::seconds MAX_INTERVAL = std::chrono::seconds(420); // 7 minutes
 const int RECORDING_FREQUENCY_THRESHOLD = 2; // Only this amount of videos will be recorded in a given interval
@@ -45,7 +45,7 @@ gchar file_name_prefix[] = "incident";
 gchar stream_name_prefix[] = "stream";
 
 /* Running Configurations */
-static gboolean bbox_enabled = 0;
+static gint bbox_enabled = BBOX_DISABLED;
 static gboolean is_recording = 0;
 static gint enc_type = 1; // Default: Software encoder
 static gint sink_type = 3; // Default: Eglsink
@@ -61,14 +61,23 @@ static guint debug_level = 0;
 static guint chunk_size = STREAM_REC_DEFAULT_DURATION; // Default: 10800 Secs
 static gboolean person_detection_enabled = IS_PERSON_DETECTION_ENABLED;
 static gboolean vehicle_detection_enabled = IS_VEHICLE_DETECTION_ENABLED;
+static guint metrics_port = 0; // Default: metrics endpoint disabled
+static guint stall_timeout = SOURCE_STALL_TIMEOUT_SEC; // 0: watchdog disabled
+static guint stream_container = STREAM_REC_CONTAINER_MP4;
+static guint fragment_duration = STREAM_REC_FRAGMENT_DURATION_MS;
+static guint retention_budget_mb = 0; // 0: keep recordings forever
 
 const int vehicle_class_ids[] = PGIE_CLASS_ID_VEHICLE;
 const int PGIE_CLASS_IDS_SIZE = sizeof(vehicle_class_ids) / sizeof(vehicle_class_ids[0]);
 
+/* Live alarm parameters, swapped on config reload */
+static AlarmParamsStore *alarm_params = NULL;
+
 GOptionEntry entries[] = {
   {"bbox-enable", 'e', 0, G_OPTION_ARG_INT, &bbox_enabled,
       "0: Disable bboxes, \
        1: Enable bboxes, \
+       2: Bboxes as a WebVTT track next to passthrough incident clips, \
        Default: bboxes disabled", NULL}
   ,
   {"enc-type", 'c', 1, G_OPTION_ARG_INT, &enc_type,
@@ -126,6 +135,22 @@ GOptionEntry entries[] = {
        In seconds, \
        Default: 10800 sec", NULL}
   ,
+  {"stream-container", 0, 0, G_OPTION_ARG_INT, &stream_container,
+      "Stream record container, \
+       0: MP4, 1: Fragmented MP4, 2: Matroska, \
+       Default: MP4", NULL}
+  ,
+  {"fragment-duration", 0, 0, G_OPTION_ARG_INT, &fragment_duration,
+      "Fragment duration of fragmented MP4 stream records, \
+       In milliseconds, \
+       Default: 2000 ms", NULL}
+  ,
+  {"retention-budget-mb", 0, 0, G_OPTION_ARG_INT, &retention_budget_mb,
+      "Disk budget for the incident and stream recordings of this camera, \
+       oldest recordings are deleted above it, \
+       In MB, 0: unlimited, \
+       Default: unlimited", NULL}
+  ,
   {"person-detection", 'n', 0, G_OPTION_ARG_INT, &person_detection_enabled,
     "0: Disable person detection, \
       1: Enable person detection, \
@@ -136,17 +161,67 @@ GOptionEntry entries[] = {
       1: Enable vehicle detection, \
       Default: vehicle detection enabled", NULL}
   ,
+  {"metrics-port", 0, 0, G_OPTION_ARG_INT, &metrics_port,
+    "Localhost port for the Prometheus metrics endpoint, \
+      0: Disabled, \
+      Default: disabled", NULL}
+  ,
+  {"stall-timeout", 0, 0, G_OPTION_ARG_INT, &stall_timeout,
+    "Seconds without buffers from the camera before the source is reconnected, \
+      0: Disabled, \
+      Default: 10 sec", NULL}
+  ,
   {NULL}
   ,
 };
 
 static GstElement *pipeline = NULL, *tee_pre_decode = NULL;
+/* Source branch (rtspsrc -> depay), rebuilt in place on source errors */
+static GstElement *rtsp_source = NULL, *source_depay = NULL;
+static GstElement *audio_parser_pre_recordbin = NULL;
+static gchar *source_uri = NULL;
+static guint source_rebuild_id = 0;
+static gboolean video_branches_linked = FALSE;
+/* Source supervision. The probe stamps buffer arrival from the streaming
+ * thread, everything else is only touched on the main loop. */
+static SourceWatchdog *source_watchdog = NULL;
 static NvDsSRContext *nvdssrCtxInc = NULL;
 static NvDsSRContext *nvdssrCtxStr = NULL;
 static GMainLoop *loop = NULL;
 FixedSizeCounter person_counter = FixedSizeCounter(ALARM_WINDOW);
 FixedSizeCounter vehicle_counter = FixedSizeCounter(ALARM_WINDOW);
 
+/* Budgeted queue between tee_pre_decode and a record branch */
+typedef struct _RecordQueue {
+  GstElement *queue;
+  gboolean dropping;              // streaming thread only, waiting for a keyframe
+  MetricsCounter *dropped;
+} RecordQueue;
+
+static RecordQueue incident_record_queue = {};
+static RecordQueue stream_record_queue = {};
+
+/* Detections for the incident clip sidecar and when the clip was asked to end */
+static DetectionTrack *detection_track = NULL;
+static std::atomic<gint64> incident_end_us(0);
+
+/* Recording folders, cataloged for the retention manager */
+static RetentionManager *retention = NULL;
+static gchar *incident_folder = NULL;
+static gchar *stream_folder = NULL;
+
+/* Metrics, registered in register_pipeline_metrics() before the pipeline plays */
+static MetricsCounter *frames_processed = NULL;
+static MetricsCounter *alarms_fired = NULL;
+static MetricsCounter *alarms_suppressed = NULL;
+static MetricsCounter *incident_recordings_started = NULL;
+static MetricsCounter *incident_recordings_failed = NULL;
+static MetricsCounter *stream_recordings_started = NULL;
+static MetricsCounter *stream_recordings_failed = NULL;
+static MetricsCounter *amqp_publish_failures = NULL;
+static MetricsCounter *source_rebuilds = NULL;
+static MetricsCounter *source_stalls = NULL;
+
 int 
 createFolder(const char* folderPath) {
     if (mkdir(folderPath, 0755) == 0) {
@@ -174,6 +249,19 @@ bus_call (GstBus * bus, GstMessage * msg, gpointer data)
         LOG(ERROR) << "[Deepstream] Error details:  " << debug;
       g_free (debug);
       g_error_free (error);
+
+      /* Queued errors of a source branch that was already rebuilt */
+      if (pipeline && msg->src != GST_OBJECT (pipeline) &&
+          !gst_object_has_as_ancestor (msg->src, GST_OBJECT (pipeline)))
+        break;
+
+      /* Source errors only restart the source branch, inference stays up */
+      if ((rtsp_source && (msg->src == GST_OBJECT (rtsp_source) ||
+              gst_object_has_as_ancestor (msg->src, GST_OBJECT (rtsp_source)))) ||
+          (source_depay && msg->src == GST_OBJECT (source_depay))) {
+        schedule_source_rebuild ("source error");
+        break;
+      }
       g_main_loop_quit (loop);
       break;
     }
@@ -216,63 +304,28 @@ get_absolute_file_path (const gchar *cfg_file_path, gchar *file_path)
 }
 
 
-/* Function to adjust time and rename file */
-void rename_stream_file(const std::string& input_file, const std::string& file_dirpath) {
-
-    const int YEAR_OFFSET = 1900;
-    const int MONTH_OFFSET = 1;
+/* NvDsSR names stream records after their UTC start time, rename them to the
+ * local time name the recorder gives its chunks. Returns the path the file
+ * ends up at. */
+std::string rename_stream_file(const std::string& input_file, const std::string& file_dirpath) {
+    std::string original_path = file_dirpath + "/" + input_file;
+    ChunkName parsed;
+    gchar name[CHUNK_NAME_MAX];
 
-    // Find the position of the '-' character preceding the time
-    size_t dash_pos = input_file.find('-');
-    if (dash_pos == std::string::npos) {
-        LOG(ERROR) << "[Deepstream] - [Stream Record] - Time not found in the input string \n";
-        return;
-    }
-    std::string input_time = input_file.substr(dash_pos + 1, 6);
-    
-    // Find the position of the last underscore to get the date part
-    size_t last_underscore_pos = input_file.rfind('_');
-    if (last_underscore_pos == std::string::npos || last_underscore_pos <= dash_pos) {
+    if (!chunk_name_parse(input_file.c_str(), &parsed) ||
+        !chunk_name_format(name, sizeof(name), parsed.stem, chunk_name_time(&parsed) * G_USEC_PER_SEC, parsed.ext)) {
         LOG(ERROR) << "[Deepstream] - [Stream Record] - Format of the file name is not as expected \n";
-        return;
+        return original_path;
     }
-    std::string date_str = input_file.substr(dash_pos - 8, 8);
-    int year = std::stoi(date_str.substr(0, 4));
-    int month = std::stoi(date_str.substr(4, 2));
-    int day = std::stoi(date_str.substr(6, 2));
-    
-    struct tm file_tm = {};
-    file_tm.tm_year = year - YEAR_OFFSET; // tm_year is years since 1900
-    file_tm.tm_mon = month - MONTH_OFFSET;    // tm_mon is months since January (0-11)
-    file_tm.tm_mday = day;
-    file_tm.tm_hour = std::stoi(input_time.substr(0, 2));
-    file_tm.tm_min = std::stoi(input_time.substr(2, 2));
-    file_tm.tm_sec = std::stoi(input_time.substr(4, 2));
-    file_tm.tm_isdst = -1;         // Automatically determine if DST is in effect
-		
-		// Convert the tm structure to time_t (UTC)
-    time_t file_time_utc = timegm(&file_tm);
-
-    struct tm *adjusted_tm = std::localtime(&file_time_utc);
-
-    std::ostringstream oss;
-
-    oss << std::put_time(adjusted_tm, "%Y%m%d-%H%M%S");
-        
-    oss << "_" << tzname[adjusted_tm->tm_isdst > 0 ? 1 : 0];
-
-    std::string converted_time = oss.str();
-
-     // Constructing full paths
-    std::string original_path = file_dirpath + "/" + input_file;
-    std::string new_file = file_dirpath + "/" + input_file.substr(0, dash_pos - 8) + converted_time + input_file.substr(input_file.rfind('.'));
+    std::string new_file = file_dirpath + "/" + name;
 
     // Renaming the file
     if (rename(original_path.c_str(), new_file.c_str()) != 0) {
         LOG(ERROR) << "[Deepstream] - [Stream Record] - Error renaming the file \n";
-    } else {
-        LOG(INFO) << "[Deepstream] - [Stream Record] - File renamed successfully \n";
+        return original_path;
     }
+    LOG(INFO) << "[Deepstream] - [Stream Record] - File renamed successfully \n";
+    return new_file;
 }
 
 
@@ -347,6 +400,20 @@ done:
 }
 
 
+/* Append a finished recording to the catalog of its folder and account it
+ * for retention. Runs on the smart record thread. */
+static void
+catalog_recording (const gchar *folder, const gchar *file_path, guint64 duration_ms)
+{
+  gint64 now_us = g_get_real_time ();
+  ChunkCatalogRecord record;
+
+  if (!folder || !chunk_catalog_record_for_file (file_path, now_us - (gint64) duration_ms * 1000, now_us, &record))
+    return;
+  if (chunk_catalog_append (folder, &record) && retention)
+    retention->add_chunk (folder, record);
+}
+
 static gpointer 
 smart_record_callback(NvDsSRRecordingInfo *info, gpointer userData) {
     char *full_path = (char *)malloc(strlen(info->dirpath) + strlen(info->filename) + 2);
@@ -372,9 +439,23 @@ smart_record_callback(NvDsSRRecordingInfo *info, gpointer userData) {
     data["camera_id"] = mac;
     data["retries"] = "0";
     data["length"] = std::to_string(incident_length);
+    if (detection_track) {
+      /* The recordbin starts the clip at the keyframe before the requested
+       * start, so its length, not the requested start, places the clip. The
+       * end is only off by the frame the recordbin stopped on. */
+      gint64 end_us = incident_end_us.load();
+      if (detection_track->write_webvtt(full_path, end_us - (gint64) incident_length * 1000, end_us))
+        data["bbox_track"] = std::string(full_path) + DETECTION_TRACK_SUFFIX;
+    }
+    catalog_recording(incident_folder, full_path, incident_length);
     nlohmann::json json_data = data;
     std::string message_body = json_data.dump();
-    channel->BasicPublish(RABBITMQ_EXCHANGE_NAME, RABBITMQ_ROUTING_KEY, AmqpClient::BasicMessage::Create(message_body));
+    try {
+        channel->BasicPublish(RABBITMQ_EXCHANGE_NAME, RABBITMQ_ROUTING_KEY, AmqpClient::BasicMessage::Create(message_body));
+    } catch (const std::exception &e) {
+        amqp_publish_failures->inc();
+        LOG(ERROR) << "[Deepstream] - [SmartRecord] - Failed to publish incident for camera " << camera_id << ": " << e.what();
+    }
     return NULL;
 }
 
@@ -382,7 +463,8 @@ static gpointer
 smart_record_callback_stream(NvDsSRRecordingInfo *info, gpointer userData) {
 	std::string input_file = info->filename;
   std::string file_dirpath = info->dirpath;
-	rename_stream_file(input_file, file_dirpath);
+	std::string file_path = rename_stream_file(input_file, file_dirpath);
+  catalog_recording(stream_folder, file_path.c_str(), info->duration);
 	return NULL;
 }
 
@@ -391,48 +473,73 @@ smart_record_event_generator (gpointer data)
 {
   NvDsSRSessionId sessId = 0;
   NvDsSRContext *ctx = (NvDsSRContext *) data;
-  guint startTime = SMART_REC_START_TIME;
-  guint duration = SMART_REC_DURATION;
+  std::shared_ptr<const AlarmParams> params = alarm_params->get();
+  guint startTime = params->incident_start_time;
+  guint duration = params->incident_duration;
   
   if (ctx->recordOn) {
-    LOG(INFO) <<  "[Deepstream] - [SmartRecord] - Recording done for camera " << camera_id;
+    ALOG(INFO, "[Deepstream] - [SmartRecord] - Recording done camera=%u", camera_id);
     if (NvDsSRStop (ctx, 0) != NVDSSR_STATUS_OK)
-      LOG(ERROR) << "[Deepstream] - [SmartRecord] - Unable to stop recording for camera " << camera_id;
+      ALOG(ERROR, "[Deepstream] - [SmartRecord] - Unable to stop recording camera=%u", camera_id);
+    else
+      incident_end_us = g_get_real_time ();
   } else {
-    LOG(INFO) << "[Deepstream] - [SmartRecord] - Recording started for camera " << camera_id;
+    ALOG(INFO, "[Deepstream] - [SmartRecord] - Recording started camera=%u", camera_id);
     if (NvDsSRStart (ctx, &sessId, startTime, duration,
-            NULL) != NVDSSR_STATUS_OK)
-      LOG(INFO) << "[Deepstream] - [SmartRecord] - Unable to start recording for camera " << camera_id;
-  }
-}
-
-bool is_pgie_class_id_vehicle(int class_id){
-  bool is_vehicle_class = false;
-  for (int i = 0; i < PGIE_CLASS_IDS_SIZE; ++i) {
-        if (class_id == vehicle_class_ids[i]) {
-            is_vehicle_class = true;
-            return true;
-        }
+            NULL) != NVDSSR_STATUS_OK) {
+      incident_recordings_failed->inc();
+      ALOG(ERROR, "[Deepstream] - [SmartRecord] - Unable to start recording camera=%u", camera_id);
+    } else {
+      incident_recordings_started->inc();
+      /* Unless stopped early the clip ends duration seconds from now */
+      incident_end_us = g_get_real_time () +
+          (gint64) (duration ? duration : SMART_REC_DEFAULT_DURATION) * G_USEC_PER_SEC;
+      if (detection_track)
+        detection_track->set_history (SMART_REC_CACHE_SIZE_SEC + duration + DETECTION_TRACK_MARGIN_SEC);
     }
-
-    return false;
-
+  }
 }
 
-
-void update_recording_interval() {
-    if (recording_counter >= RECORDING_FREQUENCY_THRESHOLD) {
+void update_recording_interval(const AlarmParams *params) {
+    std::chrono::seconds base_interval = std::chrono::seconds(params->backoff_base_interval);
+    std::chrono::seconds max_interval = std::chrono::seconds(params->backoff_max_interval);
+    if (recording_counter >= params->recording_frequency_threshold) {
         // wait time increased if there has been many incidents 
-        current_interval = std::min(current_interval + std::chrono::seconds(75), MAX_INTERVAL);
+        current_interval = std::min(current_interval + std::chrono::seconds(75), max_interval);
         recording_counter = 0; // reset when reaching maximum threshold in a certain interval 
     } else if (recording_counter > 0) {
-        current_interval = std::max(current_interval - std::chrono::seconds(15), BASE_INTERVAL);
+        current_interval = std::max(current_interval - std::chrono::seconds(15), base_interval);
     }
     auto seconds = std::chrono::duration_cast<std::chrono::seconds>(current_interval).count();
-    LOG(INFO) << seconds << "  " << recording_counter;
+    ALOG_RATE(INFO, 1, 5, "[Deepstream] - [Alarm] - Backoff updated camera=%u interval_s=%ld recording_counter=%d",
+        camera_id, (long) seconds, recording_counter);
 }
 
 
+/* Hand the objects of a frame to the incident clip detection track */
+static void
+record_frame_detections (NvDsFrameMeta *frame_meta)
+{
+  std::vector<DetectionBox> boxes;
+
+  for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL; l_obj = l_obj->next) {
+    NvDsObjectMeta *obj_meta = (NvDsObjectMeta *) l_obj->data;
+    const NvOSD_RectParams &rect = obj_meta->rect_params;
+    DetectionBox box;
+    box.object_id = obj_meta->object_id;
+    box.class_id = obj_meta->class_id;
+    box.confidence = obj_meta->confidence;
+    box.left = rect.left / MUXER_OUTPUT_WIDTH;
+    box.top = rect.top / MUXER_OUTPUT_HEIGHT;
+    box.width = rect.width / MUXER_OUTPUT_WIDTH;
+    box.height = rect.height / MUXER_OUTPUT_HEIGHT;
+    boxes.push_back(box);
+  }
+  /* streammux stamps the system time the frame arrived, before inference latency */
+  gint64 utc_us = frame_meta->ntp_timestamp ? (gint64) (frame_meta->ntp_timestamp / 1000) : g_get_real_time ();
+  detection_track->add_frame (utc_us, std::move (boxes));
+}
+
 static GstPadProbeReturn
 osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
     gpointer u_data)
@@ -447,11 +554,20 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
     int m_cols = 0, m_rows = 0;
 
     NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta (buf);
+    /* One parameter block per buffer, a reload takes effect on the next one */
+    std::shared_ptr<const AlarmParams> params = alarm_params->get();
 
+    if (person_counter.get_max_size() != params->alarm_window) {
+        person_counter.resize(params->alarm_window);
+        vehicle_counter.resize(params->alarm_window);
+    }
 
     for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
       l_frame = l_frame->next) {
         NvDsFrameMeta *frame_meta = (NvDsFrameMeta *) (l_frame->data);
+        frames_processed->inc();
+        if (detection_track)
+            record_frame_detections (frame_meta);
         /* Frame level decisions */
         for (NvDsMetaList * l_user = frame_meta->frame_user_meta_list;
                 l_user != NULL; l_user = l_user->next) {
@@ -469,8 +585,9 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
         for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
                 l_obj = l_obj->next) {
             obj_meta = (NvDsObjectMeta *) (l_obj->data);
-            if (obj_meta->class_id == PGIE_CLASS_ID_PERSON && person_detection_enabled) {
-                VLOG(2) << "[Deepstream] - [Alarm] - Person on Frame\n";
+            if (obj_meta->class_id == params->person_class_id && params->person_detection_enabled) {
+                AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Person on frame camera=%u object_id=%lu",
+                    camera_id, (unsigned long) obj_meta->object_id);
                 guint keep_person = 1;
                 // Check for ROI
                 for (NvDsMetaList *l_user_meta = obj_meta->obj_user_meta_list; l_user_meta != NULL;
@@ -482,10 +599,12 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
                         if (user_meta_data->roiStatus.size()){
                           // Person inside ROI, remove person
                           keep_person = 0;
-                          VLOG(2) << "VLOG [Deepstream] - [Alarm] - Person was inside ROI, Removing\n";
+                          AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Person inside ROI, removing object_id=%lu",
+                              (unsigned long) obj_meta->object_id);
                         }else{
                           // At least one person outside ROI, keep person & break
-                          VLOG(2) << "VLOG [Deepstream] - [Alarm] - Person was outside ROI, adding\n";
+                          AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Person outside ROI, adding object_id=%lu",
+                              (unsigned long) obj_meta->object_id);
                           keep_person = 1;
                           break;
                         }
@@ -494,8 +613,9 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
                 person_detected += keep_person;
                 
             }
-            else if (is_pgie_class_id_vehicle(obj_meta->class_id) && vehicle_detection_enabled) {
-                VLOG(2) << "[Deepstream] - [Alarm] - Vehicle on Frame\n";
+            else if (params->is_vehicle_class(obj_meta->class_id) && params->vehicle_detection_enabled) {
+                AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Vehicle on frame camera=%u object_id=%lu",
+                    camera_id, (unsigned long) obj_meta->object_id);
                 guint keep_vehicle = 1;
                 // Check for ROI
                 for (NvDsMetaList *l_user_meta = obj_meta->obj_user_meta_list; l_user_meta != NULL;
@@ -507,10 +627,12 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
                         if (user_meta_data->roiStatus.size()){
                           // Vehicle inside ROI, remove vehicle
                           keep_vehicle = 0;
-                          VLOG(2) << "VLOG [Deepstream] - [Alarm] - Vehicle was inside ROI, Removing\n";
+                          AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Vehicle inside ROI, removing object_id=%lu",
+                              (unsigned long) obj_meta->object_id);
                         }else{
                           // At least one vehicle outside ROI, keep vehicle & break
-                          VLOG(2) << "VLOG [Deepstream] - [Alarm] - Vehicle was outside ROI, adding\n";
+                          AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Vehicle outside ROI, adding object_id=%lu",
+                              (unsigned long) obj_meta->object_id);
                           keep_vehicle = 1;
                           
                         }
@@ -519,7 +641,8 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
                 }
                 // check for vehicle motion if it is outside excluded zone
                 if (keep_vehicle) {
-                    VLOG(2) << "[Deepstream] - [Alarm] - Calculating vehicle movement\n";
+                    AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Calculating vehicle movement object_id=%lu",
+                        (unsigned long) obj_meta->object_id);
                     NvOSD_RectParams &bbox = obj_meta->rect_params;
                     float x1 = bbox.left;
                     float y1 = bbox.top;
@@ -543,10 +666,10 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
                             auto dx = flow_vector->flowx / 32.0f;
                             auto dy = flow_vector->flowy / 32.0f;
                             float magnitude = abs(dx) + abs(dy);
-                            if (magnitude > BLOCK_MOTION_THRESHOLD) {
+                            if (magnitude > params->block_motion_threshold) {
                                 blocks_with_movement++;
                                 // Check for defined threshold early to save iterations
-                                if (blocks_with_movement >= total_blocks * BOX_MOTION_PERCENTAGE) {
+                                if (blocks_with_movement >= total_blocks * params->box_motion_percentage) {
                                     vehicle_moving = true;
                                     break; 
                                 }
@@ -554,7 +677,8 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
                         }
                         if (vehicle_moving) {
                             
-                            VLOG(2) << "[Deepstream] - [Alarm] - Vehicle considered moving\n";
+                            AVLOG_RATE(2, 5, 20, "[Deepstream] - [Alarm] - Vehicle considered moving object_id=%lu",
+                                (unsigned long) obj_meta->object_id);
                             break;  
                         }
                     }
@@ -585,7 +709,12 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
     // If the elapsed time is less than interval and we couldnt record more in the interval we can skip
     auto current_time = std::chrono::system_clock::now();
     auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds> (current_time - last_alarm_generated);
-    if (nvdssrCtxInc->recordOn || (elapsed_time < current_interval && recording_counter == RECORDING_FREQUENCY_THRESHOLD - 1)){
+    bool in_backoff = (elapsed_time < current_interval && recording_counter == params->recording_frequency_threshold - 1);
+    if (nvdssrCtxInc->recordOn || in_backoff){
+      if (!nvdssrCtxInc->recordOn && (person_counter.get_sum() > params->person_detected_frames_limit ||
+            vehicle_counter.get_sum() > params->vehicle_detected_frames_limit)) {
+        alarms_suppressed->inc();
+      }
       person_counter.reset_counter();
       vehicle_counter.reset_counter();
       return GST_PAD_PROBE_OK;
@@ -596,22 +725,23 @@ osd_sink_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
       recording_counter = 0;
     }
 
-    bool person = (person_counter.get_sum() > PERSON_DETECTED_FRAMES_LIMIT);
-    bool vehicle = (vehicle_counter.get_sum() > VEHICLE_DETECTED_FRAMES_LIMIT);
-    VLOG(4) << "[Deepstream] - [SmartRecord] - Person: " << person << "on camera " << camera_id;
-    VLOG(4) << "[Deepstream] - [SmartRecord] - Vehicle: " << vehicle << "on camera " << camera_id;
+    bool person = (person_counter.get_sum() > params->person_detected_frames_limit);
+    bool vehicle = (vehicle_counter.get_sum() > params->vehicle_detected_frames_limit);
+    AVLOG_RATE(4, 1, 1, "[Deepstream] - [SmartRecord] - Frame decision camera=%u person=%d vehicle=%d",
+        camera_id, person, vehicle);
     bool is_alarm = false;
     if (!nvdssrCtxInc->recordOn && (person || vehicle)){     
       is_alarm = true;
     }
     
     if (is_alarm) {
+      alarms_fired->inc();
       smart_record_event_generator(nvdssrCtxInc);
       vehicle_counter.reset_counter();
       person_counter.reset_counter();
       recording_counter++;
       last_alarm_generated = std::chrono::system_clock::now();
-      update_recording_interval();
+      update_recording_interval(params.get());
     }
 
     return GST_PAD_PROBE_OK;
@@ -631,11 +761,14 @@ recordQue_sink_pad_buffer_probe (GstPad * pad,
 
   /* Check whether a recording session is still going on and recordbin's encorder is on reset to proceed */
   if (!nvdssrCtxStr->recordOn && nvdssrCtxStr->resetDone && !is_record_stopped){  
-    LOG(INFO) << "[Deepstream] - [Stream Record] - Recording started for camera " << camera_id;
+    ALOG(INFO, "[Deepstream] - [Stream Record] - Recording started camera=%u", camera_id);
     if (NvDsSRStart (ctx, &sessId, startTime, duration,
             NULL) != NVDSSR_STATUS_OK){
-      LOG(INFO) << "[Deepstream] - [Stream Record] - Unable to start recording for camera " << camera_id;
-            }
+      stream_recordings_failed->inc();
+      ALOG_RATE(ERROR, 1, 1, "[Deepstream] - [Stream Record] - Unable to start recording camera=%u", camera_id);
+    } else {
+      stream_recordings_started->inc();
+    }
   }  
   return GST_PAD_PROBE_OK;
 }
@@ -688,8 +821,9 @@ signal_handler(int signum) {
       }
     }
    
-    /* Wait until the encodebin of recordbin is in reset */
-    if (nvdssrCtxStr->encodebin != NULL) {
+    /* Wait until the encodebin of recordbin is in reset. Fragmented MP4 and
+     * Matroska files are readable as written, only plain MP4 needs the moov. */
+    if (nvdssrCtxStr->encodebin != NULL && stream_container == STREAM_REC_CONTAINER_MP4) {
       while (nvdssrCtxStr->resetDone == 0){
         LOG(INFO) << "[Deepstream] waiting till reset is done";
         }
@@ -700,6 +834,22 @@ signal_handler(int signum) {
 }
 
 
+/* The recordbin creates its muxer lazily, switch it to fragmented output
+ * as soon as it is added */
+static void
+cb_recordbin_element_added (GstBin * bin, GstBin * sub_bin, GstElement * element, gpointer data)
+{
+  GstElementFactory *factory = gst_element_get_factory (element);
+  if (!factory)
+    return;
+
+  const gchar *factory_name = GST_OBJECT_NAME (factory);
+  if (!g_strcmp0 (factory_name, "qtmux") || !g_strcmp0 (factory_name, "mp4mux")) {
+    g_object_set (G_OBJECT (element), "fragment-duration", fragment_duration, NULL);
+    LOG(INFO) << "[Deepstream] - [Stream Record] - Fragmented MP4, fragment duration " << fragment_duration << " ms";
+  }
+}
+
 static void
 cb_newpad_audio_parsebin (GstElement * element, GstPad * element_src_pad, gpointer data)
 {
@@ -710,6 +860,54 @@ cb_newpad_audio_parsebin (GstElement * element, GstPad * element_src_pad, gpoint
   }
 }
 
+/* Never let a slow disk block the tee: a buffer that would take the record
+ * queue over its budget is dropped, and so is everything up to the next
+ * keyframe so the recording resumes on a decodable frame */
+static GstPadProbeReturn
+record_queue_budget_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  RecordQueue *record_queue = (RecordQueue *) u_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  guint bytes = 0;
+  guint64 time = 0;
+
+  g_object_get (G_OBJECT (record_queue->queue), "current-level-bytes", &bytes,
+      "current-level-time", &time, NULL);
+  gboolean over_budget = bytes >= RECORD_QUEUE_MAX_BYTES ||
+      time >= (guint64) RECORD_QUEUE_MAX_TIME_MS * GST_MSECOND;
+
+  if (over_budget || (record_queue->dropping && GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT))) {
+    if (!record_queue->dropping)
+      ALOG_RATE(WARNING, 1, 10, "[Deepstream] - [Record Queue] - %s over budget, dropping until the next keyframe",
+          GST_ELEMENT_NAME (record_queue->queue));
+    record_queue->dropping = TRUE;
+    record_queue->dropped->inc();
+    return GST_PAD_PROBE_DROP;
+  }
+  record_queue->dropping = FALSE;
+  return GST_PAD_PROBE_OK;
+}
+
+/* Create the leaky queue in front of a record branch. The probe enforces the
+ * budget; the queue's own downstream leak at twice the budget is only a
+ * backstop so it can never block. */
+static GstElement *
+make_record_queue (RecordQueue *record_queue, const gchar *name)
+{
+  record_queue->queue = gst_element_factory_make ("queue", name);
+  g_object_set (G_OBJECT (record_queue->queue),
+      "max-size-buffers", 0,
+      "max-size-bytes", 2 * RECORD_QUEUE_MAX_BYTES,
+      "max-size-time", (guint64) 2 * RECORD_QUEUE_MAX_TIME_MS * GST_MSECOND,
+      "leaky", 2, NULL);   // 2: downstream, drop the oldest buffers
+
+  GstPad *sinkpad = gst_element_get_static_pad (record_queue->queue, "sink");
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, record_queue_budget_probe, record_queue, NULL);
+  gst_object_unref (sinkpad);
+  gst_bin_add (GST_BIN (pipeline), record_queue->queue);
+  return record_queue->queue;
+}
+
 static void
 cb_newpad (GstElement * element, GstPad * element_src_pad, gpointer data)
 {
@@ -730,6 +928,13 @@ cb_newpad (GstElement * element, GstPad * element_src_pad, gpointer data)
       LOG(ERROR) << "[Deepstream] - [Pipeline] - Failed to link depay loader to rtsp src";
     }
     gst_object_unref (sinkpad);
+
+    /* Recording branches hang off the tee and survive source rebuilds */
+    if (video_branches_linked) {
+      gst_caps_unref (caps);
+      return;
+    }
+    video_branches_linked = TRUE;
     
     /* If the is_recording flag is 1, add a separate branch to record streams */
     if ((is_recording) && (sr_mode == 0 || sr_mode == 1)) {
@@ -745,12 +950,15 @@ cb_newpad (GstElement * element, GstPad * element_src_pad, gpointer data)
         }
         
         gst_bin_add_many (GST_BIN (pipeline), parser_pre_str_recordbin, NULL);
+        GstElement *queue_pre_str_recordbin =
+            make_record_queue (&stream_record_queue, "queue_pre_str_recordbin");
 
-        if (!gst_element_link_many (tee_pre_decode, parser_pre_str_recordbin,
+        if (!gst_element_link_many (tee_pre_decode, queue_pre_str_recordbin, parser_pre_str_recordbin,
               nvdssrCtxStr->recordbin, NULL)) {
           LOG(FATAL) << "[Deepstream] - [Pipeline] - Elements not linked. Exiting.";
           g_main_loop_quit(loop);
         }
+        gst_element_sync_state_with_parent(queue_pre_str_recordbin);
         gst_element_sync_state_with_parent(parser_pre_str_recordbin);
 
         /* Get the sinkpad of the recordbin's queue element  */
@@ -770,7 +978,7 @@ cb_newpad (GstElement * element, GstPad * element_src_pad, gpointer data)
     }
     
 
-    if (!bbox_enabled && (sr_mode == 0 || sr_mode == 1)) {
+    if (bbox_enabled != BBOX_BURN_IN && (sr_mode == 0 || sr_mode == 1)) {
       GstElement *parser_pre_inc_recordbin;
       if (stream_enc == 0){
         parser_pre_inc_recordbin =
@@ -780,38 +988,205 @@ cb_newpad (GstElement * element, GstPad * element_src_pad, gpointer data)
             gst_element_factory_make ("h265parse", "parser_pre_inc_recordbin");
         }
       gst_bin_add_many (GST_BIN (pipeline), parser_pre_inc_recordbin, NULL);
+      GstElement *queue_pre_inc_recordbin =
+          make_record_queue (&incident_record_queue, "queue_pre_inc_recordbin");
       
-      if (!gst_element_link_many (tee_pre_decode, parser_pre_inc_recordbin,
+      if (!gst_element_link_many (tee_pre_decode, queue_pre_inc_recordbin, parser_pre_inc_recordbin,
               nvdssrCtxInc->recordbin, NULL)) {
         LOG(FATAL) << "[Deepstream] - [Pipeline] - Elements not linked. Exiting.";
         g_main_loop_quit(loop);
       }
+      gst_element_sync_state_with_parent(queue_pre_inc_recordbin);
       gst_element_sync_state_with_parent(parser_pre_inc_recordbin);
     }
   }
 
   if (g_strrstr (name, "x-rtp") && is_audio) {
-    if (!bbox_enabled && (sr_mode == 0 || sr_mode == 2)) {
-      GstElement *parser_pre_inc_recordbin =
-          gst_element_factory_make ("parsebin", "audio-parser-pre-recordbin");
-
-      gst_bin_add_many (GST_BIN (pipeline), parser_pre_inc_recordbin, NULL);
+    if (bbox_enabled != BBOX_BURN_IN && (sr_mode == 0 || sr_mode == 2)) {
+      /* After a source rebuild relink the existing parsebin */
+      gboolean reuse = (audio_parser_pre_recordbin != NULL);
+      if (!reuse) {
+        audio_parser_pre_recordbin =
+            gst_element_factory_make ("parsebin", "audio-parser-pre-recordbin");
+        gst_bin_add_many (GST_BIN (pipeline), audio_parser_pre_recordbin, NULL);
+      }
 
-      GstPad *sinkpad = gst_element_get_static_pad(parser_pre_inc_recordbin, "sink");
+      GstPad *sinkpad = gst_element_get_static_pad(audio_parser_pre_recordbin, "sink");
       if (gst_pad_link(element_src_pad, sinkpad) != GST_PAD_LINK_OK) {
         LOG(FATAL) << "[Deepstream] - [Pipeline] - Elements not linked. Exiting.";
         g_main_loop_quit(loop);
       }
+      gst_object_unref (sinkpad);
 
-      g_signal_connect(G_OBJECT(parser_pre_inc_recordbin), "pad-added", G_CALLBACK(cb_newpad_audio_parsebin), NULL);
-
-      gst_element_sync_state_with_parent(parser_pre_inc_recordbin);
+      if (!reuse) {
+        g_signal_connect(G_OBJECT(audio_parser_pre_recordbin), "pad-added", G_CALLBACK(cb_newpad_audio_parsebin), NULL);
+        gst_element_sync_state_with_parent(audio_parser_pre_recordbin);
+      }
     }
   }
 
   gst_caps_unref (caps);
 }
 
+/* Create rtspsrc and depay, add them to the pipeline and link depay to the
+ * pre-decode tee. Everything downstream of the tee is left untouched. */
+static gboolean
+create_source_branch (const gchar *uri)
+{
+  rtsp_source = gst_element_factory_make ("rtspsrc", "rtsp-source");
+  if (stream_enc == 0){
+    source_depay = gst_element_factory_make ("rtph264depay", "h264-depay");
+  } else {
+    source_depay = gst_element_factory_make ("rtph265depay", "h264-depay");
+  }
+
+  if (!rtsp_source || !source_depay) {
+    LOG(ERROR) << "[Deepstream] - [Source] - One element in source end could not be created.";
+    return FALSE;
+  }
+
+  g_object_set (G_OBJECT (rtsp_source), "location", uri, NULL);
+  // g_object_set (G_OBJECT (rtsp_source), "protocols", PROTOCOL , NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), rtsp_source, source_depay, NULL);
+  if (!gst_element_link (source_depay, tee_pre_decode)) {
+    LOG(ERROR) << "[Deepstream] - [Source] - Failed to link depay to tee.";
+    return FALSE;
+  }
+
+  g_signal_connect (G_OBJECT (rtsp_source), "pad-added",
+      G_CALLBACK (cb_newpad), source_depay);
+
+  GstPad *depay_src_pad = gst_element_get_static_pad (source_depay, "src");
+  gst_pad_add_probe (depay_src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+      source_depay_src_pad_buffer_probe, NULL, NULL);
+  gst_object_unref (depay_src_pad);
+
+  /* The stall timer of a new branch starts at creation */
+  source_watchdog->branch_created (g_get_monotonic_time ());
+  return TRUE;
+}
+
+static GstPadProbeReturn
+source_depay_src_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  source_watchdog->buffer_seen (g_get_monotonic_time ());
+  return GST_PAD_PROBE_OK;
+}
+
+/* Queue a rebuild of the source branch with jittered exponential backoff.
+ * Errors and stalls share the same attempt counter. */
+static void
+schedule_source_rebuild (const gchar *reason)
+{
+  if (source_rebuild_id)
+    return;
+
+  guint delay = source_watchdog->next_reconnect_delay_ms (g_random_double ());
+  LOG(WARNING) << "[Deepstream] - [Source] - Camera " << camera_id << ": " << reason
+      << ", reconnecting in " << delay << " ms (attempt " << source_watchdog->attempts () << ")";
+  source_rebuild_id = g_timeout_add (delay, rebuild_source_branch, NULL);
+}
+
+/* Runs every SOURCE_WATCHDOG_INTERVAL_SEC on the main loop */
+static gboolean
+source_watchdog_tick (gpointer data)
+{
+  if (source_rebuild_id)
+    return G_SOURCE_CONTINUE;
+
+  switch (source_watchdog->tick (g_get_monotonic_time ())) {
+    case SourceWatchdog::SOURCE_STALLED:
+      source_stalls->inc();
+      schedule_source_rebuild ("no buffers received");
+      break;
+    case SourceWatchdog::SOURCE_STARTED:
+      LOG(INFO) << "[Deepstream] - [Source] - Camera " << camera_id << " is streaming";
+      break;
+    default:
+      break;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+/* Tear down the source branch and build a fresh one while the decoder,
+ * inference, tracker and recordbins keep running. Runs on the main loop. */
+static gboolean
+rebuild_source_branch (gpointer data)
+{
+  source_rebuild_id = 0;
+  source_rebuilds->inc();
+
+  if (rtsp_source) {
+    gst_element_set_state (rtsp_source, GST_STATE_NULL);
+    gst_element_set_state (source_depay, GST_STATE_NULL);
+    gst_element_unlink (source_depay, tee_pre_decode);
+    gst_bin_remove_many (GST_BIN (pipeline), rtsp_source, source_depay, NULL);
+    rtsp_source = NULL;
+    source_depay = NULL;
+  }
+
+  if (!create_source_branch (source_uri)) {
+    LOG(ERROR) << "[Deepstream] - [Source] - Unable to rebuild source branch. Exiting.";
+    g_main_loop_quit (loop);
+    return G_SOURCE_REMOVE;
+  }
+
+  gst_element_sync_state_with_parent (source_depay);
+  gst_element_sync_state_with_parent (rtsp_source);
+  LOG(INFO) << "[Deepstream] - [Source] - Source branch rebuilt for camera " << camera_id;
+  return G_SOURCE_REMOVE;
+}
+
+/* Gauge sampling the current fill level of a queue element */
+static void
+add_queue_depth_gauge (const std::string &name, const std::string &help, GstElement *queue)
+{
+  metrics_registry().add_gauge(name, help, [queue]() {
+    guint level = 0;
+    g_object_get (G_OBJECT (queue), "current-level-buffers", &level, NULL);
+    return (double) level;
+  });
+}
+
+static void
+register_pipeline_metrics ()
+{
+  MetricsRegistry &registry = metrics_registry();
+  registry.set_const_labels("camera_id=\"" + std::to_string(camera_id) + "\"");
+  frames_processed = registry.add_counter("deepstream_frames_processed_total",
+      "Frames that reached the alarm probe");
+  alarms_fired = registry.add_counter("deepstream_alarms_fired_total",
+      "Alarms that triggered an incident recording");
+  alarms_suppressed = registry.add_counter("deepstream_alarms_suppressed_total",
+      "Frames with an alarm condition suppressed by the recording backoff");
+  incident_recordings_started = registry.add_counter("deepstream_incident_recordings_started_total",
+      "Incident recordings started");
+  incident_recordings_failed = registry.add_counter("deepstream_incident_recordings_failed_total",
+      "Incident recordings that failed to start");
+  stream_recordings_started = registry.add_counter("deepstream_stream_recordings_started_total",
+      "Stream recordings started");
+  stream_recordings_failed = registry.add_counter("deepstream_stream_recordings_failed_total",
+      "Stream recordings that failed to start");
+  amqp_publish_failures = registry.add_counter("deepstream_amqp_publish_failures_total",
+      "Incident messages that could not be published to RabbitMQ");
+  source_rebuilds = registry.add_counter("deepstream_source_rebuilds_total",
+      "In-process rebuilds (reconnects) of the RTSP source branch");
+  source_stalls = registry.add_counter("deepstream_source_stalls_total",
+      "Reconnects triggered by the source watchdog because no buffers arrived");
+  registry.add_gauge("deepstream_source_uptime_seconds", "Seconds since the camera stream last started flowing",
+      []() {
+        gint64 up_since = source_watchdog->up_since_us ();
+        return up_since ? (g_get_monotonic_time () - up_since) / (double) G_USEC_PER_SEC : 0.0;
+      });
+  incident_record_queue.dropped = registry.add_counter("deepstream_incident_record_dropped_buffers_total",
+      "Buffers dropped in front of the incident recordbin because it fell behind");
+  stream_record_queue.dropped = registry.add_counter("deepstream_stream_record_dropped_buffers_total",
+      "Buffers dropped in front of the stream recordbin because it fell behind");
+  registry.add_sampled_counter("deepstream_log_lines_dropped_total",
+      "Log lines dropped because the async log ring was full", []() { return async_log_dropped(); });
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -820,6 +1195,9 @@ main (int argc, char *argv[])
 
     google::SetLogDestination(google::ERROR, "/var/log/realtime/pipeline_error_logs_");
 
+    /* Streaming threads log through a ring buffer drained by a writer thread */
+    async_log_start();
+
     LOG(INFO) << "[Deepstream] - Deepstream Logging Initialized";
     // Initialize RabbitMQ broker
     AmqpClient::Channel::OpenOpts opts;
@@ -829,11 +1207,11 @@ main (int argc, char *argv[])
     channel->DeclareExchange(RABBITMQ_EXCHANGE_NAME, AmqpClient::Channel::EXCHANGE_TYPE_DIRECT);
 
 
-  GstElement *streammux = NULL, *sink = NULL, *pgie = NULL, *source = NULL,
+  GstElement *streammux = NULL, *sink = NULL, *pgie = NULL,
       *nvvidconv = NULL, *nvvidconv2 = NULL, *encoder_post_osd = NULL,
       *queue_pre_sink = NULL, *queue_post_osd = NULL, *parser_post_osd = NULL,
       *nvosd = NULL, *tee_post_osd = NULL, *queue_pre_decode = NULL,
-      *depay_pre_decode = NULL, *decoder = NULL,  *nvvidconv3 = NULL,
+      *decoder = NULL,  *nvvidconv3 = NULL,
       *swenc_caps = NULL, *nvtracker = NULL, *nvdsanalytics = NULL,
       *nvof = NULL, *stream_payloader = NULL, *stream_encoder = NULL,
       *stream_vidconv = NULL, *stream_queue=NULL;
@@ -889,6 +1267,10 @@ main (int argc, char *argv[])
   /* Standard GStreamer initialization */
   gst_init (&argc, &argv);
   loop = g_main_loop_new (NULL, FALSE);
+  source_watchdog = new SourceWatchdog (stall_timeout, SOURCE_RECONNECT_BASE_MS,
+      SOURCE_RECONNECT_MAX_MS, SOURCE_RECONNECT_JITTER);
+
+  register_pipeline_metrics();
   
   /* Config file paths */
   std::string tmp_folder = "tmp/";
@@ -897,31 +1279,55 @@ main (int argc, char *argv[])
   tracker_config_file = tracker_config_file_string.c_str();
   std::string pgie_config_file = tmp_folder + cameraIDString + PGIE_CONFIG_FILE;
   std::string nvanalytics_config_file = tmp_folder + cameraIDString + NVDSANALYTICS_CONFIG_FILE;
+  std::string alarm_config_file = tmp_folder + cameraIDString + ALARM_CONFIG_FILE;
+
+  /* Alarm parameters: compiled defaults and command line, overlaid by the
+   * per-camera config file which is reloaded on change or SIGHUP */
+  AlarmParams alarm_defaults;
+  alarm_defaults.alarm_window = ALARM_WINDOW;
+  alarm_defaults.person_detected_frames_limit = PERSON_DETECTED_FRAMES_LIMIT;
+  alarm_defaults.vehicle_detected_frames_limit = VEHICLE_DETECTED_FRAMES_LIMIT;
+  alarm_defaults.person_class_id = PGIE_CLASS_ID_PERSON;
+  alarm_defaults.vehicle_class_ids.assign(vehicle_class_ids, vehicle_class_ids + PGIE_CLASS_IDS_SIZE);
+  alarm_defaults.person_detection_enabled = person_detection_enabled;
+  alarm_defaults.vehicle_detection_enabled = vehicle_detection_enabled;
+  alarm_defaults.incident_start_time = SMART_REC_START_TIME;
+  alarm_defaults.incident_duration = SMART_REC_DURATION;
+  alarm_defaults.block_motion_threshold = BLOCK_MOTION_THRESHOLD;
+  alarm_defaults.box_motion_percentage = BOX_MOTION_PERCENTAGE;
+  alarm_defaults.backoff_base_interval = BASE_INTERVAL.count();
+  alarm_defaults.backoff_max_interval = MAX_INTERVAL.count();
+  alarm_defaults.recording_frequency_threshold = RECORDING_FREQUENCY_THRESHOLD;
+
+  alarm_params = new AlarmParamsStore(alarm_defaults, alarm_config_file);
+  alarm_params->reload();
+  alarm_params->watch();
+
+  if (bbox_enabled == BBOX_SIDECAR) {
+    detection_track = new DetectionTrack (SMART_REC_CACHE_SIZE_SEC +
+        alarm_params->get()->incident_duration + DETECTION_TRACK_MARGIN_SEC);
+  }
 
   /* Create gstreamer elements */
   /* Create Pipeline element that will form a connection of other elements */
   pipeline = gst_pipeline_new ("rtsp-restreamer-pipeline");
 
-  source = gst_element_factory_make ("rtspsrc", "rtsp-source");
-  g_object_set (G_OBJECT (source), "location", argv[1], NULL);
-  // g_object_set (G_OBJECT (source), "protocols", PROTOCOL , NULL);
-
-  if (stream_enc == 0){
-    depay_pre_decode = gst_element_factory_make ("rtph264depay", "h264-depay");
-  } else {
-    depay_pre_decode = gst_element_factory_make ("rtph265depay", "h264-depay");
-  }
-  
+  /* rtspsrc and depay are created by create_source_branch() once the tee is
+   * in the pipeline, so they can be rebuilt on their own after an error */
+  source_uri = argv[1];
 
   queue_pre_decode = gst_element_factory_make ("queue", "queue-pre-decode");
 
-  if (!source || !depay_pre_decode || !queue_pre_decode) {
+  if (!queue_pre_decode) {
     LOG(FATAL) << "[Deepstream] - [Pipeline] - One element in source end could not be created.\n";
     return -1;
   }
+  /* Explicit budget instead of the queue defaults; inference keeps every frame */
+  g_object_set (G_OBJECT (queue_pre_decode),
+      "max-size-buffers", DECODE_QUEUE_MAX_BUFFERS,
+      "max-size-bytes", 0,
+      "max-size-time", (guint64) DECODE_QUEUE_MAX_TIME_MS * GST_MSECOND, NULL);
 
-  g_signal_connect (G_OBJECT (source), "pad-added",
-      G_CALLBACK (cb_newpad), depay_pre_decode);
   /* Create tee which connects decoded source data and Smart record bin without bbox */
   tee_pre_decode = gst_element_factory_make ("tee", "tee-pre-decode");
 
@@ -1036,6 +1442,9 @@ main (int argc, char *argv[])
   g_object_set (G_OBJECT (streammux), "live-source", 1, NULL);
   g_object_set (G_OBJECT (streammux), "buffer-pool-size", 5, NULL);
   g_object_set (G_OBJECT (nvdsanalytics), "config-file", nvanalytics_config_file.c_str(), NULL);
+  /* Only the fakesink follows analytics in running mode 1, nothing draws its OSD */
+  if (running_mode == 1)
+    g_object_set (G_OBJECT (nvdsanalytics), "display-meta", FALSE, NULL);
 
   g_object_set (G_OBJECT (streammux), "batch-size", num_sources, NULL);
 
@@ -1078,17 +1487,17 @@ main (int argc, char *argv[])
    *                                                                                                                                     |-> queue -> encoder -> parser -> recordbin
    */
   if (running_mode == 1 && motion == 1){
-      gst_bin_add_many (GST_BIN (pipeline), source, depay_pre_decode,
+      gst_bin_add_many (GST_BIN (pipeline),
           tee_pre_decode, queue_pre_decode, decoder, streammux, nvof, 
           pgie, nvtracker, nvdsanalytics, sink, NULL);
   }
   else if (running_mode == 1 && motion == 0){
-      gst_bin_add_many (GST_BIN (pipeline), source, depay_pre_decode,
+      gst_bin_add_many (GST_BIN (pipeline),
           tee_pre_decode, queue_pre_decode, decoder, streammux, 
           pgie, nvtracker, nvdsanalytics, sink, NULL);
   }
   else if (running_mode == 2 && motion == 1){
-      gst_bin_add_many (GST_BIN (pipeline), source, depay_pre_decode,
+      gst_bin_add_many (GST_BIN (pipeline),
           tee_pre_decode, queue_pre_decode, decoder, streammux, nvof,
           pgie, nvtracker, nvdsanalytics, nvvidconv,
           nvosd, nvvidconv2, cap_filter, tee_post_osd, queue_pre_sink,
@@ -1096,7 +1505,7 @@ main (int argc, char *argv[])
           stream_payloader, stream_caps_filter, sink, NULL);
   }
   else if (running_mode == 2 && motion == 0){
-      gst_bin_add_many (GST_BIN (pipeline), source, depay_pre_decode,
+      gst_bin_add_many (GST_BIN (pipeline),
           tee_pre_decode, queue_pre_decode, decoder, streammux,
           pgie, nvtracker, nvdsanalytics, nvvidconv,
           nvosd, nvvidconv2, cap_filter, tee_post_osd, queue_pre_sink,
@@ -1105,7 +1514,12 @@ main (int argc, char *argv[])
   }
 
   /* Link the elements together till decoder */
-  if (!gst_element_link_many (depay_pre_decode, tee_pre_decode,
+  if (!create_source_branch (source_uri)) {
+    LOG(FATAL) << "[Deepstream] - [Pipeline] - Source branch could not be created. Exiting.\n";
+    return -1;
+  }
+
+  if (!gst_element_link_many (tee_pre_decode,
           queue_pre_decode, decoder, NULL)) {
     LOG(FATAL) <<  "[Deepstream] - [Pipeline] - Elements could not be linked: 1. Exiting.\n";
     return -1;
@@ -1179,6 +1593,10 @@ main (int argc, char *argv[])
   char record_folder [20];
   sprintf(record_folder, "tmp/%d/videos/", camera_id);
   createFolder(record_folder);
+  incident_folder = g_strdup (record_folder);
+  retention = new RetentionManager ((guint64) retention_budget_mb << 20, 0);
+  retention->add_folder (incident_folder);
+  retention->add_sidecar_suffix (DETECTION_TRACK_SUFFIX);
   paramsInc.containerType = SMART_REC_CONTAINER;
   paramsInc.cacheSize = SMART_REC_CACHE_SIZE_SEC;
   paramsInc.defaultDuration = SMART_REC_DEFAULT_DURATION;
@@ -1193,16 +1611,21 @@ main (int argc, char *argv[])
 
   gst_bin_add_many (GST_BIN (pipeline), nvdssrCtxInc->recordbin, NULL);
 
+  add_queue_depth_gauge("deepstream_decode_queue_depth_buffers",
+      "Buffers waiting in the pre-decode queue", queue_pre_decode);
+  add_queue_depth_gauge("deepstream_incident_record_queue_depth_buffers",
+      "Buffers waiting in the incident recordbin queue", nvdssrCtxInc->recordQue);
+
   if (is_recording){
     /* Set parameters for the smart record stream record element*/
-    std::time_t currentTime = std::time(nullptr);
-    std::tm* localTime = std::localtime(&currentTime);
-
     char camera_record_folder [90];
     sprintf(camera_record_folder, "%s/%s", "recorded_streams", mac);
     createFolder(camera_record_folder);
+    stream_folder = g_strdup (camera_record_folder);
+    retention->add_folder (stream_folder);
 
-    paramsStr.containerType = STREAM_REC_CONTAINER;
+    paramsStr.containerType = (stream_container == STREAM_REC_CONTAINER_MKV) ?
+        NVDSSR_CONTAINER_MKV : NVDSSR_CONTAINER_MP4;
     paramsStr.cacheSize = STREAM_REC_CACHE_SIZE_SEC;
     paramsStr.defaultDuration = chunk_size;
     paramsStr.fileNamePrefix = stream_name_prefix;
@@ -1217,10 +1640,16 @@ main (int argc, char *argv[])
     }
 
     gst_bin_add_many (GST_BIN (pipeline), nvdssrCtxStr->recordbin, NULL);
+    if (stream_container == STREAM_REC_CONTAINER_FRAGMENTED_MP4) {
+      g_signal_connect (G_OBJECT (nvdssrCtxStr->recordbin), "deep-element-added",
+          G_CALLBACK (cb_recordbin_element_added), NULL);
+    }
+    add_queue_depth_gauge("deepstream_stream_record_queue_depth_buffers",
+        "Buffers waiting in the stream recordbin queue", nvdssrCtxStr->recordQue);
   }
   
 
-  if (bbox_enabled == 1 && running_mode == 2) {
+  if (bbox_enabled == BBOX_BURN_IN && running_mode == 2) {
     /* Encode the data from tee before recording with bbox */
     if (enc_type == 0) {
         /* Hardware encoder used*/
@@ -1293,6 +1722,17 @@ main (int argc, char *argv[])
   LOG(INFO) << (" %s", argv[i + 1]);
 
   gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  retention->start ();
+
+  /* Reconnect the source when the camera silently stops sending */
+  if (stall_timeout) {
+    g_timeout_add_seconds (SOURCE_WATCHDOG_INTERVAL_SEC, source_watchdog_tick, NULL);
+  }
+
+  GSocketService *metrics_service = NULL;
+  if (metrics_port) {
+    metrics_service = metrics_http_server_start(&metrics_registry(), metrics_port);
+  }
 
   /* Wait till pipeline encounters an error or EOS */
   LOG(INFO) << "[Deepstream] - [Pipeline] - Running...\n";
@@ -1313,7 +1753,14 @@ main (int argc, char *argv[])
   gst_element_set_state (pipeline, GST_STATE_NULL);
   LOG(INFO) << ("[Deepstream] - [Pipeline] - Deleting pipeline\n");
   gst_object_unref (GST_OBJECT (pipeline));
+  delete source_watchdog;
   g_source_remove (bus_watch_id);
+  if (metrics_service) {
+    g_socket_service_stop (metrics_service);
+    g_object_unref (metrics_service);
+  }
   g_main_loop_unref (loop);
+  retention->stop();
+  async_log_stop();
   return 0;
 }
@@ -0,0 +1,45 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Round of the FOR_ROUNDS loop running, -1 outside one */
+static int check_round __attribute__((unused)) = -1;
+
+/* Abort the test with the failing expression and where it is */
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            if (check_round >= 0) \
+                fprintf(stderr, "in round %d\n", check_round); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* Tests that need something the host lacks, e.g. a GStreamer plugin */
+#define SKIP(reason) \
+    do { \
+        printf("SKIP: %s\n", reason); \
+        exit(0); \
+    } while (0)
+
+/* Randomized tests draw from a fixed seed LCG, so every run and host sees
+ * the same inputs and a failing round reproduces */
+static uint32_t check_seed = 4242;
+
+static inline int
+random_int (int below)
+{
+    check_seed = check_seed * 1103515245 + 12345;
+    return (int) ((check_seed >> 8) % (uint32_t) below);
+}
+
+/* Loop over rounds of random inputs, CHECK reports the round that failed.
+ * check_round goes back to -1 when the loop ends. */
+#define FOR_ROUNDS(round, rounds) \
+    for (int round = (check_round = 0); round < (rounds) || (check_round = -1) >= 0; check_round = ++round)
+
+#endif // TESTS_CHECK_H
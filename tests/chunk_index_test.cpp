@@ -0,0 +1,177 @@
+/* ChunkIndexWriter and chunk_index_lookup on a temporary camera folder.
+ * Chunks of 25 fps video with a keyframe every second are indexed against a
+ * camera PTS anchor far from the wall clock, so every index time must follow
+ * the anchor. Random windows are looked up against the keyframes kept here.
+ * A chunk with a corrupt sidecar is skipped and a folder without a catalog
+ * fails the lookup. */
+#include <glib/gstdio.h>
+#include <string>
+#include <vector>
+#include "chunk_index.h"
+#include "check.h"
+
+#define ROUNDS 2000
+#define CHUNKS 12
+#define FRAMES_PER_CHUNK 250
+#define GOP 25
+#define FRAME_NS 40000000LL
+#define FRAME_BYTES 1000
+/* 2021-06-01 00:00:00 UTC, the camera's first frame an hour of PTS in */
+#define ANCHOR_UTC_US 1622505600000000LL
+#define ANCHOR_PTS 3600000000000LL
+/* Muxed PTS of the first chunk start after the anchor */
+#define FIRST_PTS (ANCHOR_PTS + 7 * FRAME_NS)
+
+struct Keyframe {
+    gint64 utc_us;
+    guint64 offset;
+};
+
+struct Chunk {
+    std::string path;
+    guint64 size;
+    gint64 first_utc_us;
+    gint64 last_utc_us;
+    std::vector<Keyframe> keyframes;
+};
+
+static void
+remove_dir(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+    while (dir && (name = g_dir_read_name(dir))) {
+        gchar *file = g_build_filename(path, name, NULL);
+        g_remove(file);
+        g_free(file);
+    }
+    if (dir)
+        g_dir_close(dir);
+    g_rmdir(path);
+}
+
+static std::vector<Chunk>
+write_chunks(const gchar *folder)
+{
+    std::vector<Chunk> chunks;
+    ChunkIndexWriter writer;
+    writer.set_anchor(ANCHOR_UTC_US, ANCHOR_PTS);
+
+    for (gint c = 0; c < CHUNKS; c++) {
+        Chunk chunk;
+        gchar *name = g_strdup_printf("stream_%05d.mp4", c);
+        gchar *path = g_build_filename(folder, name, NULL);
+        chunk.path = path;
+        CHECK(g_file_set_contents(path, "", 0, NULL));
+
+        writer.begin();
+        for (gint f = 0; f < FRAMES_PER_CHUNK; f++) {
+            gint64 pts = FIRST_PTS + ((gint64) c * FRAMES_PER_CHUNK + f) * FRAME_NS;
+            gint64 utc_us = ANCHOR_UTC_US + (pts - ANCHOR_PTS) / 1000;
+            guint64 offset = (guint64) f * FRAME_BYTES;
+            if (f % GOP == 0)
+                chunk.keyframes.push_back({ utc_us, offset });
+            if (f == 0)
+                chunk.first_utc_us = utc_us;
+            chunk.last_utc_us = utc_us;
+            writer.add_buffer(pts, offset, f % GOP == 0);
+        }
+        chunk.size = (guint64) FRAMES_PER_CHUNK * FRAME_BYTES;
+
+        ChunkCatalogRecord record;
+        CHECK(writer.finish(path, chunk.size, &record));
+        CHECK(record.first_utc_us == chunk.first_utc_us && record.last_utc_us == chunk.last_utc_us);
+        CHECK(record.file_size == chunk.size && g_strcmp0(record.name, name) == 0);
+        chunks.push_back(chunk);
+        g_free(path);
+        g_free(name);
+    }
+    return chunks;
+}
+
+/* What chunk_index_lookup must return, from the keyframes alone */
+static std::vector<ChunkByteRange>
+reference_lookup(const std::vector<Chunk> &chunks, gint64 from_utc_us, gint64 to_utc_us,
+    const std::string &skipped)
+{
+    std::vector<ChunkByteRange> ranges;
+    for (const Chunk &chunk : chunks) {
+        if (chunk.last_utc_us < from_utc_us || chunk.path == skipped)
+            continue;
+        if (chunk.first_utc_us > to_utc_us)
+            break;
+        const Keyframe *start = &chunk.keyframes.front();
+        const Keyframe *end = NULL;
+        for (const Keyframe &keyframe : chunk.keyframes) {
+            if (keyframe.utc_us <= from_utc_us)
+                start = &keyframe;
+            if (keyframe.utc_us > to_utc_us && !end)
+                end = &keyframe;
+        }
+        ChunkByteRange range;
+        range.path = chunk.path;
+        range.start = start->offset;
+        range.end = end ? end->offset : chunk.size;
+        range.start_utc_us = start->utc_us;
+        ranges.push_back(range);
+    }
+    return ranges;
+}
+
+static void
+check_lookup(const gchar *folder, const std::vector<Chunk> &chunks, gint64 from_utc_us, gint64 to_utc_us,
+    const std::string &skipped)
+{
+    std::vector<ChunkByteRange> ranges;
+    std::vector<ChunkByteRange> expected = reference_lookup(chunks, from_utc_us, to_utc_us, skipped);
+    CHECK(chunk_index_lookup(folder, from_utc_us, to_utc_us, &ranges));
+    CHECK(ranges.size() == expected.size());
+    for (gsize i = 0; i < ranges.size(); i++) {
+        CHECK(ranges[i].path == expected[i].path);
+        CHECK(ranges[i].start == expected[i].start && ranges[i].end == expected[i].end);
+        CHECK(ranges[i].start_utc_us == expected[i].start_utc_us);
+    }
+}
+
+int
+main()
+{
+    gchar *folder = g_dir_make_tmp("chunk_index_test_XXXXXX", NULL);
+    CHECK(folder);
+    std::vector<Chunk> chunks = write_chunks(folder);
+
+    /* Sidecars hold the anchor derived times, not the time they were written */
+    ChunkIndexHeader header;
+    std::vector<ChunkIndexEntry> entries;
+    gchar *index_path = g_strconcat(chunks[3].path.c_str(), CHUNK_INDEX_SUFFIX, NULL);
+    CHECK(chunk_index_load(index_path, &header, &entries));
+    CHECK(entries.size() == chunks[3].keyframes.size());
+    for (gsize i = 0; i < entries.size(); i++)
+        CHECK(entries[i].utc_us == chunks[3].keyframes[i].utc_us && entries[i].offset == chunks[3].keyframes[i].offset);
+    CHECK(header.first_utc_us == chunks[3].first_utc_us && header.last_utc_us == chunks[3].last_utc_us);
+
+    std::vector<ChunkCatalogRecord> records;
+    CHECK(chunk_catalog_load(folder, &records) && records.size() == CHUNKS);
+
+    /* Windows reaching before the first and after the last chunk */
+    gint64 start_us = chunks.front().first_utc_us - 20 * G_USEC_PER_SEC;
+    gint span_us = (gint) (chunks.back().last_utc_us + 20 * G_USEC_PER_SEC - start_us);
+    FOR_ROUNDS(round, ROUNDS) {
+        gint64 from_utc_us = start_us + random_int(span_us);
+        gint64 to_utc_us = from_utc_us + (round % 4 == 0 ? 0 : random_int(30 * G_USEC_PER_SEC));
+        check_lookup(folder, chunks, from_utc_us, to_utc_us, "");
+    }
+    check_lookup(folder, chunks, chunks.front().first_utc_us, chunks.back().last_utc_us, "");
+
+    /* A chunk whose sidecar is corrupt drops out, its neighbours stay */
+    CHECK(g_file_set_contents(index_path, "garbage", -1, NULL));
+    check_lookup(folder, chunks, chunks[2].first_utc_us, chunks[4].last_utc_us, chunks[3].path);
+    g_free(index_path);
+
+    remove_dir(folder);
+    std::vector<ChunkByteRange> ranges;
+    CHECK(!chunk_index_lookup(folder, start_us, start_us + span_us, &ranges) && ranges.empty());
+    g_free(folder);
+    printf("chunk_index_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,233 @@
+/* Property test of chunk naming around DST transitions.
+ *
+ * Every zone runs in its own process since the span cache keeps the zone it
+ * first saw. libc's localtime_r is the reference: names formatted through
+ * the cached spans must carry the offset and abbreviation libc reports, and
+ * parse back to the second they were formatted from, including the repeated
+ * hour when DST ends. Mutated names must be rejected or round trip. */
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "chunk_name.h"
+#include "check.h"
+
+#define SEED 20240331
+#define RANDOM_TIMES 20000
+#define MUTATIONS 20000
+/* 2000-01-01 .. 2037-12-31, within 32 bit time_t on every libc */
+#define RANGE_START 946684800LL
+#define RANGE_END 2145830400LL
+
+static const gchar *zones[] = {
+    "UTC",
+    "Europe/Berlin",            // CET/CEST
+    "Europe/Dublin",            // negative DST in the tz database
+    "America/New_York",
+    "America/Sao_Paulo",        // DST abolished in 2019
+    "Australia/Lord_Howe",      // 30 minute DST
+    "Pacific/Chatham",          // +12:45/+13:45, numeric abbreviations
+    "Asia/Kolkata",             // no DST
+};
+
+static void
+reference(gint64 utc_sec, glong *offset, gchar *zone)
+{
+    time_t t = (time_t) utc_sec;
+    struct tm local;
+    localtime_r(&t, &local);
+    *offset = local.tm_gmtoff;
+    g_strlcpy(zone, local.tm_zone, CHUNK_ZONE_MAX);
+}
+
+/* Transitions found with libc alone: hourly scan, then bisection */
+static std::vector<gint64>
+reference_transitions()
+{
+    std::vector<gint64> transitions;
+    glong offset, previous_offset;
+    gchar zone[CHUNK_ZONE_MAX], previous_zone[CHUNK_ZONE_MAX];
+    reference(RANGE_START, &previous_offset, previous_zone);
+
+    for (gint64 t = RANGE_START + 3600; t < RANGE_END; t += 3600) {
+        reference(t, &offset, zone);
+        if (offset == previous_offset && strcmp(zone, previous_zone) == 0)
+            continue;
+        gint64 before = t - 3600, after = t;
+        while (after - before > 1) {
+            gint64 middle = before + (after - before) / 2;
+            reference(middle, &offset, zone);
+            if (offset == previous_offset && strcmp(zone, previous_zone) == 0)
+                before = middle;
+            else
+                after = middle;
+        }
+        transitions.push_back(after);
+        reference(t, &previous_offset, previous_zone);
+    }
+    return transitions;
+}
+
+static void
+check_round_trip(gint64 utc_us)
+{
+    gint64 utc_sec = utc_us / G_USEC_PER_SEC;
+    glong expected_offset, offset;
+    gchar expected_zone[CHUNK_ZONE_MAX], zone[CHUNK_ZONE_MAX];
+    reference(utc_sec, &expected_offset, expected_zone);
+    chunk_tz_lookup(utc_sec, &offset, zone, sizeof(zone));
+    CHECK(offset == expected_offset);
+    CHECK(strcmp(zone, expected_zone) == 0);
+
+    gchar name[CHUNK_NAME_MAX];
+    CHECK(chunk_name_format(name, sizeof(name), "stream_00042", utc_us, "mp4"));
+
+    ChunkName parsed;
+    CHECK(chunk_name_parse(name, &parsed));
+    CHECK(strcmp(parsed.stem, "stream_00042") == 0);
+    CHECK(strcmp(parsed.zone, expected_zone) == 0);
+    CHECK(strcmp(parsed.ext, "mp4") == 0);
+    CHECK(chunk_name_time(&parsed) == utc_sec + expected_offset);
+
+    gint64 back_us;
+    CHECK(chunk_name_to_utc(&parsed, &back_us));
+    if (back_us != utc_sec * G_USEC_PER_SEC) {
+        fprintf(stderr, "%s: %" G_GINT64_FORMAT " != %" G_GINT64_FORMAT "\n", name, back_us / G_USEC_PER_SEC, utc_sec);
+        CHECK(back_us == utc_sec * G_USEC_PER_SEC);
+    }
+}
+
+/* Local times skipped when the clock jumps forward never resolve */
+static void
+check_gap(gint64 transition)
+{
+    glong before, after;
+    gchar zone_before[CHUNK_ZONE_MAX], zone_after[CHUNK_ZONE_MAX];
+    reference(transition - 1, &before, zone_before);
+    reference(transition, &after, zone_after);
+    if (after <= before)
+        return;
+
+    /* The first skipped second, labelled with either side's abbreviation */
+    time_t local_sec = (time_t) (transition + before);
+    struct tm local;
+    gmtime_r(&local_sec, &local);
+    const gchar *labels[] = { zone_before, zone_after };
+    for (const gchar *label : labels) {
+        gchar name[CHUNK_NAME_MAX];
+        g_snprintf(name, sizeof(name), "stream_00001_%04d%02d%02d-%02d%02d%02d_%s.mp4",
+            local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+            local.tm_hour, local.tm_min, local.tm_sec, label);
+        ChunkName parsed;
+        gint64 utc_us;
+        CHECK(chunk_name_parse(name, &parsed));
+        CHECK(!chunk_name_to_utc(&parsed, &utc_us));
+    }
+}
+
+static void
+check_mutations(GRand *rand)
+{
+    const gchar alphabet[] = "0123456789_-.+abzABZ \x01\xff";
+    for (gint i = 0; i < MUTATIONS; i++) {
+        gchar name[CHUNK_NAME_MAX * 2];
+        gint64 utc_us = (gint64) g_rand_int_range(rand, 0, G_MAXINT32) * G_USEC_PER_SEC;
+        CHECK(chunk_name_format(name, CHUNK_NAME_MAX, "stream_00007", utc_us, "mkv"));
+
+        gint edits = g_rand_int_range(rand, 1, 4);
+        for (gint e = 0; e < edits; e++) {
+            gsize length = strlen(name);
+            gint at = g_rand_int_range(rand, 0, length + 1);
+            gchar c = alphabet[g_rand_int_range(rand, 0, sizeof(alphabet) - 1)];
+            switch (g_rand_int_range(rand, 0, 3)) {
+            case 0:
+                if ((gsize) at < length)
+                    name[at] = c;
+                break;
+            case 1:
+                name[at] = '\0';
+                break;
+            default:
+                if (length + 1 < sizeof(name)) {
+                    memmove(name + at + 1, name + at, length - at + 1);
+                    name[at] = c;
+                }
+                break;
+            }
+        }
+
+        ChunkName parsed;
+        if (!chunk_name_parse(name, &parsed))
+            continue;
+        gchar again[CHUNK_NAME_MAX * 2];
+        g_snprintf(again, sizeof(again), "%s_%04d%02d%02d-%02d%02d%02d_%s.%s", parsed.stem,
+            parsed.year, parsed.month, parsed.day, parsed.hour, parsed.minute, parsed.second,
+            parsed.zone, parsed.ext);
+        CHECK(strcmp(again, name) == 0);
+        gint64 back_us;
+        chunk_name_to_utc(&parsed, &back_us);
+    }
+}
+
+static void
+run_zone(const gchar *zone)
+{
+    setenv("TZ", zone, 1);
+    tzset();
+    GRand *rand = g_rand_new_with_seed(SEED);
+
+    std::vector<gint64> transitions = reference_transitions();
+    if (strcmp(zone, "UTC") != 0 && strcmp(zone, "Asia/Kolkata") != 0)
+        CHECK(!transitions.empty());
+
+    /* Both sides of every transition, visited out of order so the span
+     * cache keeps evicting and refilling */
+    std::vector<gint64> times;
+    for (gint64 t : transitions) {
+        for (gint64 d : { -3601LL, -1LL, 0LL, 1LL, 1799LL, 3600LL })
+            times.push_back(t + d);
+    }
+    for (gint i = 0; i < RANDOM_TIMES; i++)
+        times.push_back(RANGE_START + (gint64) (g_rand_double(rand) * (RANGE_END - RANGE_START)));
+    for (gsize i = times.size(); i > 1; i--)
+        std::swap(times[i - 1], times[g_rand_int_range(rand, 0, i)]);
+
+    for (gint64 t : times)
+        check_round_trip(t * G_USEC_PER_SEC + g_rand_int_range(rand, 0, G_USEC_PER_SEC));
+    for (gint64 t : transitions)
+        check_gap(t);
+    check_mutations(rand);
+
+    g_rand_free(rand);
+    printf("  %s: %zu transitions\n", zone, transitions.size());
+}
+
+int
+main()
+{
+    for (const gchar *zone : zones) {
+        gchar *path = g_strdup_printf("/usr/share/zoneinfo/%s", zone);
+        gboolean present = g_file_test(path, G_FILE_TEST_EXISTS);
+        g_free(path);
+        if (!present) {
+            printf("  %s: no zoneinfo, skipped\n", zone);
+            continue;
+        }
+
+        fflush(stdout);
+        pid_t pid = fork();
+        CHECK(pid >= 0);
+        if (pid == 0) {
+            run_zone(zone);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status;
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    printf("chunk_name_test: ok\n");
+    return 0;
+}
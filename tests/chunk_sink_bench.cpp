@@ -0,0 +1,162 @@
+/* Sustained throughput and latency of chunksink with many cameras.
+ *
+ * Every stream is a thread pushing camera-sized buffers into its own
+ * chunksink, rotating to a new chunk file like splitmuxsink does, so the
+ * numbers include fallocate, the coalescing buffer and the shared sync
+ * thread. Chunks are deleted once closed to keep the disk usage flat.
+ *
+ * Push latency is the whole render call, mostly the copy into the coalescing
+ * buffer. The pwrite numbers are the sink's own per chunk statistics, the
+ * slowest pwrite of every chunk. fdatasync runs on the sync thread and only
+ * shows up in the sustained rate. */
+#include <gst/gst.h>
+#include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "chunk_sink.h"
+
+#define FRAMES_PER_SEC 25
+
+static gint streams = 16;
+static gint seconds = 10;
+static gint kbps = 4096;
+static gint chunk_sec = 5;
+static gboolean direct = FALSE;
+static gchar *dir = NULL;
+
+static GOptionEntry entries[] = {
+  {"streams", 'n', 0, G_OPTION_ARG_INT, &streams, "Concurrent streams, Default: 16", NULL},
+  {"seconds", 's', 0, G_OPTION_ARG_INT, &seconds, "Run time, Default: 10 sec", NULL},
+  {"kbps", 'b', 0, G_OPTION_ARG_INT, &kbps,
+      "Bitrate per stream at 25 fps, 0 = as fast as the disk takes it, Default: 4096", NULL},
+  {"chunk", 'c', 0, G_OPTION_ARG_INT, &chunk_sec, "Chunk duration, Default: 5 sec", NULL},
+  {"direct", 0, 0, G_OPTION_ARG_NONE, &direct, "Write with O_DIRECT", NULL},
+  {"dir", 'd', 0, G_OPTION_ARG_FILENAME, &dir, "Directory for the chunks, Default: tmp dir", NULL},
+  {NULL}
+};
+
+struct StreamStats {
+  guint64 bytes = 0;
+  guint64 chunks = 0;
+  guint64 write_calls = 0;
+  std::vector<gint64> push_us;
+  std::vector<gint64> max_write_us;
+};
+
+static void
+run_stream (gint id, gint64 end_us, StreamStats * stats)
+{
+  /* Flat out mode pushes frames of a 4 Mbps camera */
+  gsize frame_bytes = (gsize) (kbps ? kbps : 4096) * 1000 / 8 / FRAMES_PER_SEC;
+  guint64 chunk_bytes = (guint64) frame_bytes * FRAMES_PER_SEC * chunk_sec;
+  GstBuffer *frame = gst_buffer_new_allocate (NULL, frame_bytes, NULL);
+  gst_buffer_memset (frame, 0, 0x5a, frame_bytes);
+
+  gint64 frame_interval_us = kbps ? G_USEC_PER_SEC / FRAMES_PER_SEC : 0;
+  gint64 next_us = g_get_monotonic_time ();
+
+  while (g_get_monotonic_time () < end_us) {
+    gchar *location = g_strdup_printf ("%s/stream_%03d_%05" G_GUINT64_FORMAT ".mp4", dir, id, stats->chunks);
+    GstElement *sink = gst_element_factory_make ("chunksink", NULL);
+    gst_object_ref_sink (sink);
+    g_object_set (sink, "location", location, "preallocate", chunk_bytes, "direct", direct,
+        "sync", FALSE, NULL);
+    GstHarness *h = gst_harness_new_with_element (sink, "sink", NULL);
+    gst_harness_set_src_caps_str (h, "video/quicktime");
+
+    for (guint64 written = 0; written < chunk_bytes && g_get_monotonic_time () < end_us;
+        written += frame_bytes) {
+      if (frame_interval_us) {
+        next_us += frame_interval_us;
+        gint64 wait_us = next_us - g_get_monotonic_time ();
+        if (wait_us > 0)
+          g_usleep (wait_us);
+      }
+      gint64 start_us = g_get_monotonic_time ();
+      if (gst_harness_push (h, gst_buffer_ref (frame)) != GST_FLOW_OK)
+        g_error ("push failed for %s", location);
+      stats->push_us.push_back (g_get_monotonic_time () - start_us);
+      stats->bytes += frame_bytes;
+    }
+
+    gst_harness_push_event (h, gst_event_new_eos ());
+    gst_harness_teardown (h);
+    /* Stopping wrote out the tail, the statistics cover the whole chunk */
+    stats->write_calls += GST_CHUNK_SINK (sink)->write_calls;
+    stats->max_write_us.push_back (GST_CHUNK_SINK (sink)->max_write_us);
+    gst_object_unref (sink);
+    g_unlink (location);
+    g_free (location);
+    stats->chunks++;
+  }
+  gst_buffer_unref (frame);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = g_option_context_new ("- chunksink benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  GError *error = NULL;
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  gst_init (&argc, &argv);
+  chunk_sink_register ();
+
+  gboolean own_dir = !dir;
+  if (own_dir)
+    dir = g_dir_make_tmp ("chunk_sink_bench_XXXXXX", NULL);
+  if (!dir || g_mkdir_with_parents (dir, 0755) != 0) {
+    g_printerr ("No directory to write to\n");
+    return 1;
+  }
+
+  std::vector<StreamStats> stats (streams);
+  std::vector<std::thread> threads;
+  gint64 start_us = g_get_monotonic_time ();
+  gint64 end_us = start_us + (gint64) seconds * G_USEC_PER_SEC;
+  for (gint i = 0; i < streams; i++)
+    threads.emplace_back (run_stream, i, end_us, &stats[i]);
+  for (std::thread & thread : threads)
+    thread.join ();
+  /* Pending syncs belong to the cost of the run */
+  chunk_sink_shutdown ();
+  gdouble elapsed = (g_get_monotonic_time () - start_us) / (gdouble) G_USEC_PER_SEC;
+
+  guint64 bytes = 0, chunks = 0, write_calls = 0;
+  std::vector<gint64> push_us, max_write_us;
+  for (StreamStats & s : stats) {
+    bytes += s.bytes;
+    chunks += s.chunks;
+    write_calls += s.write_calls;
+    push_us.insert (push_us.end (), s.push_us.begin (), s.push_us.end ());
+    max_write_us.insert (max_write_us.end (), s.max_write_us.begin (), s.max_write_us.end ());
+  }
+  for (std::vector<gint64> *samples : { &push_us, &max_write_us }) {
+    std::sort (samples->begin (), samples->end ());
+    if (samples->empty ())
+      samples->push_back (0);
+  }
+
+  g_print ("chunk_sink_bench: streams=%d kbps=%d chunk=%ds direct=%d dir=%s\n",
+      streams, kbps, chunk_sec, direct, dir);
+  g_print ("  %.1f MB/s sustained, %" G_GUINT64_FORMAT " MB in %.1f s, %" G_GUINT64_FORMAT " chunks\n",
+      bytes / elapsed / (1 << 20), bytes >> 20, elapsed, chunks);
+  g_print ("  push latency us: p50=%" G_GINT64_FORMAT " p99=%" G_GINT64_FORMAT " max=%" G_GINT64_FORMAT "\n",
+      push_us[push_us.size () / 2], push_us[push_us.size () * 99 / 100], push_us.back ());
+  g_print ("  %" G_GUINT64_FORMAT " pwrites, slowest per chunk us: p50=%" G_GINT64_FORMAT " p99=%" G_GINT64_FORMAT
+      " max=%" G_GINT64_FORMAT "\n", write_calls, max_write_us[max_write_us.size () / 2],
+      max_write_us[max_write_us.size () * 99 / 100], max_write_us.back ());
+
+  if (own_dir)
+    g_rmdir (dir);
+  g_free (dir);
+  return 0;
+}
@@ -0,0 +1,216 @@
+/* Startup cost of the nvdsanalytics config parsers as sources x groups grow.
+ *
+ * Writes the same synthetic config as key file and as YAML, every source
+ * with ROI filtering, overcrowding, line crossing and direction groups, and
+ * times a full parse of each, as the element does on start and reload. Then
+ * times rasterising every source's zones, which the first frames pay after a
+ * parse, and loading both from the compiled config cache instead. */
+#include <chrono>
+#include <string>
+#include <glib/gstdio.h>
+#include "gstnvdsanalytics.h"
+#include "nvdsanalytics_config_cache.h"
+#include "nvdsanalytics_property_parser.h"
+#include "nvdsanalytics_property_yaml_parser.h"
+
+#define ROI_PER_SOURCE 8
+#define OC_PER_SOURCE 2
+#define LC_PER_SOURCE 4
+#define DIR_PER_SOURCE 2
+#define RUNS 5
+
+/* Zone number i as an octagon of the 1920x1080 config frame */
+static std::string
+zone_points (gint i)
+{
+    static const gint octagon[][2] = {
+        {40, 0}, {80, 0}, {120, 40}, {120, 80}, {80, 120}, {40, 120}, {0, 80}, {0, 40} };
+    gint x0 = (i * 130) % 1800, y0 = (i * 70) % 960;
+    std::string points;
+    for (const gint *p : octagon) {
+        if (!points.empty())
+            points += ";";
+        points += std::to_string(x0 + p[0]) + ";" + std::to_string(y0 + p[1]);
+    }
+    return points;
+}
+
+static std::string
+line_points (gint i)
+{
+    gint x = 100 + (i * 211) % 1700, y = 100 + (i * 97) % 880;
+    return std::to_string(x) + ";" + std::to_string(y) + ";" + std::to_string(x + 20) + ";" +
+        std::to_string(y + 60) + ";" + std::to_string(x - 100) + ";" + std::to_string(y + 30) + ";" +
+        std::to_string(x + 100) + ";" + std::to_string(y + 30);
+}
+
+/* The same config in both syntaxes: "[group]\nkey=value" or "group:\n  key: value" */
+static std::string
+make_config (gint sources, gboolean yaml)
+{
+    std::string text;
+    auto group = [&] (const std::string &name) { text += yaml ? name + ":\n" : "[" + name + "]\n"; };
+    auto key = [&] (const std::string &name, const std::string &value) {
+        text += yaml ? "  " + name + ": " + value + "\n" : name + "=" + value + "\n";
+    };
+
+    group("property");
+    key("enable", "1");
+    key("config-width", "1920");
+    key("config-height", "1080");
+    key("osd-mode", "2");
+    key("display-font-size", "12");
+    for (gint s = 0; s < sources; s++) {
+        std::string id = std::to_string(s);
+        group("roi-filtering-stream-" + id);
+        key("enable", "1");
+        for (gint i = 0; i < ROI_PER_SOURCE; i++)
+            key("roi-RF" + std::to_string(i), zone_points(s + i));
+        key("inverse-roi", "0");
+        key("class-id", "-1");
+
+        group("overcrowding-stream-" + id);
+        key("enable", "1");
+        for (gint i = 0; i < OC_PER_SOURCE; i++)
+            key("roi-OC" + std::to_string(i), zone_points(s + 3 * i));
+        key("object-threshold", "3");
+        key("time-threshold", "2000");
+        key("class-id", "0");
+
+        group("line-crossing-stream-" + id);
+        key("enable", "1");
+        for (gint i = 0; i < LC_PER_SOURCE; i++)
+            key("line-crossing-Entry" + std::to_string(i), line_points(s + i));
+        key("class-id", "0");
+        key("mode", "balanced");
+
+        group("direction-detection-stream-" + id);
+        key("enable", "1");
+        for (gint i = 0; i < DIR_PER_SOURCE; i++)
+            key("direction-D" + std::to_string(i), line_points(s + 5 * i));
+        key("class-id", "0");
+        key("mode", "balanced");
+    }
+    return text;
+}
+
+typedef gboolean (*ParseFunc) (GstNvDsAnalytics *, gchar *);
+
+/* Best of RUNS full parses, in ms */
+static gdouble
+time_parse (ParseFunc parse, gchar *path, gint sources)
+{
+    GstNvDsAnalytics *nvdsanalytics = (GstNvDsAnalytics *) g_malloc0(sizeof(GstNvDsAnalytics));
+    nvdsanalytics->stream_analytics_info = new std::unordered_map<gint, StreamInfo>();
+    gdouble best = G_MAXDOUBLE;
+
+    for (gint run = 0; run < RUNS; run++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!parse(nvdsanalytics, path) || (gint) nvdsanalytics->stream_analytics_info->size() != sources) {
+            g_printerr("%s did not parse\n", path);
+            exit(1);
+        }
+        std::chrono::duration<gdouble, std::milli> spent = std::chrono::steady_clock::now() - start;
+        best = MIN(best, spent.count());
+    }
+    delete nvdsanalytics->stream_analytics_info;
+    g_free(nvdsanalytics);
+    return best;
+}
+
+/* Best of RUNS compiles of every source's zones from the parsed key file, and
+ * of RUNS loads of the cache written from them, in ms */
+static void
+time_cache (gchar *path, gint sources, gdouble *compile_ms, gdouble *load_ms)
+{
+    GstNvDsAnalytics *nvdsanalytics = (GstNvDsAnalytics *) g_malloc0(sizeof(GstNvDsAnalytics));
+    nvdsanalytics->stream_analytics_info = new std::unordered_map<gint, StreamInfo>();
+    nvdsanalytics->stream_analytics_state = new std::unordered_map<gint, StreamAnalyticsState>();
+    if (!nvdsanalytics_parse_config_file(nvdsanalytics, path))
+        exit(1);
+
+    *compile_ms = *load_ms = G_MAXDOUBLE;
+    for (gint run = 0; run < RUNS; run++) {
+        nvdsanalytics->stream_analytics_state->clear();
+        auto start = std::chrono::steady_clock::now();
+        for (auto &stream : *nvdsanalytics->stream_analytics_info)
+            compileStreamZones(stream.second, (*nvdsanalytics->stream_analytics_state)[stream.first]);
+        std::chrono::duration<gdouble, std::milli> spent = std::chrono::steady_clock::now() - start;
+        *compile_ms = MIN(*compile_ms, spent.count());
+    }
+    if (!nvdsanalytics_save_config_cache(nvdsanalytics, path)) {
+        g_printerr("%s was not cached\n", path);
+        exit(1);
+    }
+
+    for (gint run = 0; run < RUNS; run++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!nvdsanalytics_load_config_cache(nvdsanalytics, path) ||
+            (gint) nvdsanalytics->stream_analytics_state->size() != sources) {
+            g_printerr("%s cache did not load\n", path);
+            exit(1);
+        }
+        std::chrono::duration<gdouble, std::milli> spent = std::chrono::steady_clock::now() - start;
+        *load_ms = MIN(*load_ms, spent.count());
+    }
+    delete nvdsanalytics->stream_analytics_state;
+    delete nvdsanalytics->stream_analytics_info;
+    g_free(nvdsanalytics);
+}
+
+/* Empty dir and remove it */
+static void
+remove_dir (const gchar *dir)
+{
+    GDir *entries = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+    while (entries && (name = g_dir_read_name(entries))) {
+        gchar *path = g_build_filename(dir, name, NULL);
+        g_unlink(path);
+        g_free(path);
+    }
+    if (entries)
+        g_dir_close(entries);
+    g_rmdir(dir);
+}
+
+int
+main (int argc, char *argv[])
+{
+    gst_init(&argc, &argv);
+    gchar *dir = g_dir_make_tmp("nvdsanalytics_config_bench_XXXXXX", NULL);
+    gchar *txt = g_build_filename(dir, "config.txt", NULL);
+    gchar *yml = g_build_filename(dir, "config.yml", NULL);
+    gchar *cache_dir = g_build_filename(dir, NVDSANALYTICS_CONFIG_CACHE_DIR, NULL);
+    const gint sources[] = { 1, 16, 64, 256 };
+
+    /* Keep the caches out of the user's */
+    g_setenv("XDG_CACHE_HOME", dir, TRUE);
+
+    printf("%8s %10s %12s %12s %14s %14s %12s %10s\n", "sources", "groups", "keyfile ms", "yaml ms",
+        "keyfile us/grp", "yaml us/grp", "compile ms", "cache ms");
+    for (gint n : sources) {
+        std::string keyfile = make_config(n, FALSE), yaml = make_config(n, TRUE);
+        if (!g_file_set_contents(txt, keyfile.c_str(), keyfile.size(), NULL) ||
+            !g_file_set_contents(yml, yaml.c_str(), yaml.size(), NULL))
+            return 1;
+
+        gint groups = 1 + 4 * n;
+        gdouble keyfile_ms = time_parse(nvdsanalytics_parse_config_file, txt, n);
+        gdouble yaml_ms = time_parse(nvdsanalytics_parse_yaml_config_file, yml, n);
+        gdouble compile_ms, cache_ms;
+        time_cache(txt, n, &compile_ms, &cache_ms);
+        printf("%8d %10d %12.2f %12.2f %14.1f %14.1f %12.2f %10.2f\n", n, groups, keyfile_ms,
+            yaml_ms, keyfile_ms * 1000 / groups, yaml_ms * 1000 / groups, compile_ms, cache_ms);
+    }
+
+    remove_dir(cache_dir);
+    g_unlink(txt);
+    g_unlink(yml);
+    g_rmdir(dir);
+    g_free(txt);
+    g_free(yml);
+    g_free(cache_dir);
+    g_free(dir);
+    return 0;
+}
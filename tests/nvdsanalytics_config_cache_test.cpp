@@ -0,0 +1,214 @@
+/* The nvdsanalytics compiled config cache against the YAML config it was
+ * written from. Checks a cache loads back the parsed groups and the same
+ * zone raster and grid as compiling them, touching the config keeps it but
+ * an edit of the same size in the same second does not, and a cache cut
+ * short or with a bit flipped in its header or payload is refused without
+ * touching the element. */
+#include <string.h>
+#include <utime.h>
+#include <string>
+#include <glib/gstdio.h>
+#include "gstnvdsanalytics.h"
+#include "nvdsanalytics_config_cache.h"
+#include "nvdsanalytics_property_yaml_parser.h"
+#include "check.h"
+
+#define SOURCES 3
+#define ZONES_PER_SOURCE 6
+/* 2021-06-01 00:00:00 UTC, for the config and its edit alike */
+#define SOURCE_MTIME 1622505600
+
+static std::string
+zone_points (gint i)
+{
+    gint x = (i * 130) % 1700, y = (i * 70) % 900;
+    return std::to_string(x) + ";" + std::to_string(y) + ";" + std::to_string(x + 200) + ";" +
+        std::to_string(y + 20) + ";" + std::to_string(x + 160) + ";" + std::to_string(y + 150) + ";" +
+        std::to_string(x + 10) + ";" + std::to_string(y + 120);
+}
+
+static std::string
+make_config ()
+{
+    std::string text = "property:\n  enable: 1\n  config-width: 1920\n  config-height: 1080\n"
+        "  osd-mode: 2\n  display-font-size: 12\n";
+    for (gint s = 0; s < SOURCES; s++) {
+        std::string id = std::to_string(s);
+        text += "roi-filtering-stream-" + id + ":\n  enable: 1\n";
+        for (gint i = 0; i < ZONES_PER_SOURCE; i++)
+            text += "  roi-RF" + std::to_string(i) + ": " + zone_points(s + i) + "\n";
+        text += "  inverse-roi: 0\n  class-id: -1\n";
+        text += "overcrowding-stream-" + id + ":\n  enable: 1\n  roi-OC: " + zone_points(s + 7) +
+            "\n  object-threshold: 3\n  time-threshold: 2000\n  class-id: 0\n";
+        text += "line-crossing-stream-" + id + ":\n  enable: 1\n"
+            "  line-crossing-Entry: 789;672;1084;900;851;773;1203;732\n  class-id: 0\n  mode: balanced\n";
+    }
+    return text;
+}
+
+static GstNvDsAnalytics *
+element_new ()
+{
+    GstNvDsAnalytics *nvdsanalytics = (GstNvDsAnalytics *) g_malloc0(sizeof(GstNvDsAnalytics));
+    nvdsanalytics->stream_analytics_info = new std::unordered_map<gint, StreamInfo>();
+    nvdsanalytics->stream_analytics_state = new std::unordered_map<gint, StreamAnalyticsState>();
+    return nvdsanalytics;
+}
+
+static void
+element_free (GstNvDsAnalytics *nvdsanalytics)
+{
+    delete nvdsanalytics->stream_analytics_state;
+    delete nvdsanalytics->stream_analytics_info;
+    g_free(nvdsanalytics);
+}
+
+static void
+write_source (const gchar *path, const std::string &text)
+{
+    struct utimbuf times = { SOURCE_MTIME, SOURCE_MTIME };
+    CHECK(g_file_set_contents(path, text.data(), text.size(), NULL));
+    CHECK(g_utime(path, &times) == 0);
+}
+
+static gboolean
+same_boxes (const ZoneBox &a, const ZoneBox &b)
+{
+    return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+
+/* The loaded element matches the parsed one, and its zones match compiling
+ * the parsed streams */
+static void
+check_loaded (GstNvDsAnalytics *loaded, GstNvDsAnalytics *parsed)
+{
+    CHECK(loaded->enable == parsed->enable && loaded->osd_mode == parsed->osd_mode);
+    CHECK(loaded->configuration_width == parsed->configuration_width);
+    CHECK(loaded->configuration_height == parsed->configuration_height);
+    CHECK(loaded->font_size == parsed->font_size);
+    CHECK(loaded->stream_analytics_info->size() == SOURCES);
+    CHECK(loaded->stream_analytics_state->size() == SOURCES);
+
+    for (const auto &stream : *parsed->stream_analytics_info) {
+        const StreamInfo &info = loaded->stream_analytics_info->at(stream.first);
+        CHECK(info.roi_info.size() == stream.second.roi_info.size());
+        for (gsize i = 0; i < info.roi_info.size(); i++) {
+            CHECK(info.roi_info[i].roi_label == stream.second.roi_info[i].roi_label);
+            CHECK(info.roi_info[i].roi_pts == stream.second.roi_info[i].roi_pts);
+            CHECK(info.roi_info[i].operate_on_class == stream.second.roi_info[i].operate_on_class);
+        }
+        CHECK(info.overcrowding_info.size() == 1 && info.linecrossing_info.size() == 1);
+        CHECK(info.overcrowding_info[0].object_threshold == stream.second.overcrowding_info[0].object_threshold);
+        CHECK(info.linecrossing_info[0].lcdir_pts == stream.second.linecrossing_info[0].lcdir_pts);
+
+        StreamAnalyticsState compiled;
+        compileStreamZones(stream.second, compiled);
+        const StreamAnalyticsState &state = loaded->stream_analytics_state->at(stream.first);
+        CHECK(state.zones_compiled);
+        CHECK(state.zone_labels.rows == compiled.zone_labels.rows &&
+            state.zone_labels.cols == compiled.zone_labels.cols);
+        for (gint y = 0; y < compiled.zone_labels.rows; y++)
+            CHECK(memcmp(state.zone_labels.ptr<uint32_t>(y), compiled.zone_labels.ptr<uint32_t>(y),
+                compiled.zone_labels.cols * sizeof(uint32_t)) == 0);
+
+        ZoneGrid::Layout grid = state.zone_grid.layout(), expected = compiled.zone_grid.layout();
+        CHECK(grid.cols == expected.cols && grid.rows == expected.rows);
+        CHECK(grid.cell_offsets == expected.cell_offsets && grid.cell_zones == expected.cell_zones);
+        CHECK(grid.boxes.size() == expected.boxes.size());
+        for (gsize i = 0; i < grid.boxes.size(); i++)
+            CHECK(same_boxes(grid.boxes[i], expected.boxes[i]));
+    }
+}
+
+/* A refused cache leaves the element as it was */
+static void
+check_refused (const gchar *cache_path, const std::string &data, const gchar *source)
+{
+    CHECK(g_file_set_contents(cache_path, data.data(), data.size(), NULL));
+    GstNvDsAnalytics *nvdsanalytics = element_new();
+    CHECK(!nvdsanalytics_load_config_cache(nvdsanalytics, source));
+    CHECK(nvdsanalytics->configuration_width == 0);
+    CHECK(nvdsanalytics->stream_analytics_info->empty() && nvdsanalytics->stream_analytics_state->empty());
+    element_free(nvdsanalytics);
+}
+
+int
+main (int argc, char *argv[])
+{
+    gst_init(&argc, &argv);
+    gchar *dir = g_dir_make_tmp("nvdsanalytics_config_cache_test_XXXXXX", NULL);
+    CHECK(dir);
+    gchar *source = g_build_filename(dir, "config.yml", NULL);
+    gchar *cache_dir = g_build_filename(dir, NVDSANALYTICS_CONFIG_CACHE_DIR, NULL);
+
+    /* Keep the caches out of the user's */
+    g_setenv("XDG_CACHE_HOME", dir, TRUE);
+
+    std::string text = make_config();
+    write_source(source, text);
+    GstNvDsAnalytics *parsed = element_new();
+    CHECK(!nvdsanalytics_load_config_cache(parsed, source));
+    CHECK(nvdsanalytics_parse_yaml_config_file(parsed, source));
+    CHECK(parsed->stream_analytics_info->size() == SOURCES);
+    CHECK(nvdsanalytics_save_config_cache(parsed, source));
+
+    /* Round trip */
+    GstNvDsAnalytics *loaded = element_new();
+    CHECK(nvdsanalytics_load_config_cache(loaded, source));
+    check_loaded(loaded, parsed);
+    element_free(loaded);
+
+    /* The cache is the only file in its directory */
+    GDir *entries = g_dir_open(cache_dir, 0, NULL);
+    CHECK(entries);
+    gchar *cache_path = g_build_filename(cache_dir, g_dir_read_name(entries), NULL);
+    CHECK(g_dir_read_name(entries) == NULL);
+    g_dir_close(entries);
+    gchar *contents;
+    gsize length;
+    CHECK(g_file_get_contents(cache_path, &contents, &length, NULL));
+    std::string data(contents, length);
+    g_free(contents);
+
+    /* Touching the config keeps the cache, editing it in place does not */
+    CHECK(g_utime(source, NULL) == 0);
+    loaded = element_new();
+    CHECK(nvdsanalytics_load_config_cache(loaded, source));
+    element_free(loaded);
+
+    std::string edited = text;
+    gsize threshold = edited.find("object-threshold: 3");
+    CHECK(threshold != std::string::npos);
+    edited[threshold + strlen("object-threshold: ")] = '4';
+    write_source(source, edited);
+    check_refused(cache_path, data, source);
+    write_source(source, text);
+
+    /* Truncated or flipped anywhere, header or payload */
+    for (gsize size = 0; size < data.size(); size += (size < 256 ? 1 : 61))
+        check_refused(cache_path, data.substr(0, size), source);
+    for (gsize i = 0; i < data.size(); i += (i < 256 ? 1 : 61)) {
+        std::string corrupt = data;
+        corrupt[i] ^= 1 << (i % 8);
+        check_refused(cache_path, corrupt, source);
+    }
+
+    /* and the intact cache still loads */
+    CHECK(g_file_set_contents(cache_path, data.data(), data.size(), NULL));
+    loaded = element_new();
+    CHECK(nvdsanalytics_load_config_cache(loaded, source));
+    check_loaded(loaded, parsed);
+    element_free(loaded);
+    element_free(parsed);
+
+    g_unlink(cache_path);
+    g_rmdir(cache_dir);
+    g_unlink(source);
+    g_rmdir(dir);
+    g_free(cache_path);
+    g_free(cache_dir);
+    g_free(source);
+    g_free(dir);
+    printf("nvdsanalytics_config_cache_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+/* nvdsanalytics_meta_pool under the element's threading: a streaming thread
+ * acquires a frame meta and its object infos per frame and fills them, while
+ * a second thread copies and releases them, as downstream elements and the
+ * meta release_func do. Checks every acquired instance comes back empty,
+ * copies match their source, resident memory stays flat over millions of
+ * frames once the pool has warmed up, and the pool outlives its owner's
+ * reference until the last instance is released. */
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "nvdsanalytics_meta_pool.h"
+#include "check.h"
+
+#define FRAMES 2000000
+#define WARMUP_FRAMES 100000
+#define MAX_OBJECTS 16
+/* Frames in flight between the threads */
+#define QUEUE_DEPTH 32
+/* Slack for allocator noise, a leak of one object per frame exceeds it */
+#define MAX_RSS_GROWTH_KB 2048
+
+struct Batch {
+    NvDsAnalyticsFrameMeta *frame;
+    std::vector<NvDsAnalyticsObjInfo *> objects;
+};
+
+static glong
+rss_kb ()
+{
+    glong size = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2)
+        resident = 0;
+    fclose(statm);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void
+check_empty (const NvDsAnalyticsObjInfo *info)
+{
+    CHECK(info->roiStatus.empty() && info->ocStatus.empty() && info->lcStatus.empty());
+    CHECK(info->dirStatus.empty() && info->objStatus.empty() && info->unique_id == 0);
+}
+
+static void
+check_empty (const NvDsAnalyticsFrameMeta *meta)
+{
+    CHECK(meta->ocStatus.empty() && meta->objInROIcnt.empty() && meta->objLCCurrCnt.empty());
+    CHECK(meta->objLCCumCnt.empty() && meta->objCnt.empty() && meta->unique_id == 0);
+}
+
+/* Copies and releases the batches the streaming thread fills, then hands
+ * them back. A batch without a frame ends it. */
+static gpointer
+release_thread (gpointer data)
+{
+    GAsyncQueue **queues = (GAsyncQueue **) data;
+    GAsyncQueue *filled = queues[0], *empty = queues[1];
+
+    for (;;) {
+        Batch *batch = (Batch *) g_async_queue_pop(filled);
+        if (!batch->frame)
+            break;
+
+        NvDsAnalyticsFrameMeta *frame = nvdsanalytics_meta_pool_copy_frame(batch->frame);
+        CHECK(frame->objInROIcnt == batch->frame->objInROIcnt && frame->objCnt == batch->frame->objCnt);
+        nvdsanalytics_meta_pool_release_frame(frame);
+        nvdsanalytics_meta_pool_release_frame(batch->frame);
+
+        for (NvDsAnalyticsObjInfo *info : batch->objects) {
+            NvDsAnalyticsObjInfo *copy = nvdsanalytics_meta_pool_copy_obj(info);
+            CHECK(copy->roiStatus == info->roiStatus && copy->lcStatus == info->lcStatus);
+            CHECK(copy->objStatus == info->objStatus && copy->unique_id == info->unique_id);
+            nvdsanalytics_meta_pool_release_obj(copy);
+            nvdsanalytics_meta_pool_release_obj(info);
+        }
+        batch->objects.clear();
+        g_async_queue_push(empty, batch);
+    }
+    return NULL;
+}
+
+int
+main ()
+{
+    NvDsAnalyticsMetaPool *pool = nvdsanalytics_meta_pool_new();
+    GAsyncQueue *queues[2] = { g_async_queue_new(), g_async_queue_new() };
+    static Batch batches[QUEUE_DEPTH + 1];
+    std::vector<std::string> labels;
+    glong warm_kb = 0, max_kb = 0;
+
+    for (gint i = 0; i < 64; i++)
+        labels.push_back("zone-" + std::to_string(i));
+    for (gint i = 0; i < QUEUE_DEPTH; i++)
+        g_async_queue_push(queues[1], &batches[i]);
+    GThread *thread = g_thread_new("release", release_thread, queues);
+
+    for (gint f = 0; f < FRAMES; f++) {
+        Batch *batch = (Batch *) g_async_queue_pop(queues[1]);
+
+        /* Streams differ in labels and object counts */
+        batch->frame = nvdsanalytics_meta_pool_acquire_frame(pool);
+        check_empty(batch->frame);
+        batch->frame->unique_id = f % 8;
+        batch->frame->objInROIcnt[labels[random_int(labels.size())]] = f;
+        batch->frame->objCnt[random_int(4)] = random_int(MAX_OBJECTS);
+        if (f % 3 == 0)
+            batch->frame->objLCCumCnt[labels[random_int(labels.size())]] = f;
+
+        gint objects = random_int(MAX_OBJECTS + 1);
+        for (gint i = 0; i < objects; i++) {
+            NvDsAnalyticsObjInfo *info = nvdsanalytics_meta_pool_acquire_obj(pool);
+            check_empty(info);
+            info->unique_id = 1 + f % 8;
+            for (gint n = random_int(4); n > 0; n--)
+                info->roiStatus.push_back(labels[random_int(labels.size())]);
+            if (random_int(4) == 0)
+                info->lcStatus.push_back(labels[random_int(labels.size())]);
+            info->objStatus = "in";
+            batch->objects.push_back(info);
+        }
+        g_async_queue_push(queues[0], batch);
+
+        if (f == WARMUP_FRAMES)
+            warm_kb = rss_kb();
+        if (f > WARMUP_FRAMES && f % 10000 == 0) {
+            max_kb = MAX(max_kb, rss_kb());
+            CHECK(max_kb - warm_kb <= MAX_RSS_GROWTH_KB);
+        }
+    }
+    batches[QUEUE_DEPTH].frame = NULL;
+    g_async_queue_push(queues[0], &batches[QUEUE_DEPTH]);
+    g_thread_join(thread);
+
+    printf("rss after %d frames %ld KB, at most %ld KB until %d\n", WARMUP_FRAMES, warm_kb, max_kb,
+        FRAMES);
+
+    /* An instance still attached to a buffer keeps the pool alive */
+    NvDsAnalyticsObjInfo *late = nvdsanalytics_meta_pool_acquire_obj(pool);
+    nvdsanalytics_meta_pool_unref(pool);
+    late->roiStatus.push_back("late");
+    nvdsanalytics_meta_pool_release_obj(late);
+
+    g_async_queue_unref(queues[0]);
+    g_async_queue_unref(queues[1]);
+    return 0;
+}
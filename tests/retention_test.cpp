@@ -0,0 +1,221 @@
+/* RetentionManager and the chunk catalog on temporary camera folders.
+ * Checks a folder over its own budget loses its oldest chunks and their
+ * sidecars, the global budget takes the oldest chunks of any folder, and
+ * after chunks closed out of order or the manager restarted the catalog
+ * still lists exactly the chunks left on disk. */
+#include <glib/gstdio.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include "retention.h"
+#include "check.h"
+
+#define CHUNK_BYTES 1000
+#define CHUNK_SEC 10
+#define WAIT_US (5 * G_USEC_PER_SEC)
+/* 2021-06-01 00:00:00 UTC */
+#define START_UTC_US 1622505600000000LL
+
+static void
+remove_dir(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+    while (dir && (name = g_dir_read_name(dir))) {
+        gchar *file = g_build_filename(path, name, NULL);
+        g_remove(file);
+        g_free(file);
+    }
+    if (dir)
+        g_dir_close(dir);
+    g_rmdir(path);
+}
+
+/* Write chunk <name> of CHUNK_BYTES and its sidecar, starting at second
+ * slot of the recording */
+static ChunkCatalogRecord
+write_chunk(const std::string &folder, const std::string &name, gint slot)
+{
+    std::string path = folder + "/" + name;
+    std::string data(CHUNK_BYTES, 'x');
+    CHECK(g_file_set_contents(path.c_str(), data.data(), data.size(), NULL));
+    CHECK(g_file_set_contents((path + CHUNK_INDEX_SUFFIX).c_str(), "idx", -1, NULL));
+
+    ChunkCatalogRecord record;
+    gint64 first_utc_us = START_UTC_US + (gint64) slot * CHUNK_SEC * G_USEC_PER_SEC;
+    CHECK(chunk_catalog_record_for_file(path.c_str(), first_utc_us,
+        first_utc_us + CHUNK_SEC * G_USEC_PER_SEC, &record));
+    CHECK(record.file_size == CHUNK_BYTES);
+    return record;
+}
+
+static ChunkCatalogRecord
+append_chunk(const std::string &folder, const std::string &name, gint slot)
+{
+    ChunkCatalogRecord record = write_chunk(folder, name, slot);
+    CHECK(chunk_catalog_append(folder.c_str(), &record));
+    return record;
+}
+
+static std::vector<std::string>
+catalog_names(const std::string &folder)
+{
+    std::vector<ChunkCatalogRecord> records;
+    std::vector<std::string> names;
+    CHECK(chunk_catalog_load(folder.c_str(), &records));
+    for (const ChunkCatalogRecord &record : records)
+        names.push_back(record.name);
+    return names;
+}
+
+/* Chunks left in folder, sidecars checked to go with them */
+static std::set<std::string>
+chunks_on_disk(const std::string &folder)
+{
+    std::set<std::string> chunks;
+    std::set<std::string> sidecars;
+    GDir *dir = g_dir_open(folder.c_str(), 0, NULL);
+    CHECK(dir);
+    const gchar *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (g_str_has_suffix(name, CHUNK_INDEX_SUFFIX))
+            sidecars.insert(std::string(name, strlen(name) - strlen(CHUNK_INDEX_SUFFIX)));
+        else if (g_strcmp0(name, CHUNK_CATALOG_NAME) != 0)
+            chunks.insert(name);
+    }
+    g_dir_close(dir);
+    CHECK(chunks == sidecars);
+    return chunks;
+}
+
+/* The retention thread has dropped the folder's catalog to count records */
+static void
+wait_for_catalog(const std::string &folder, gsize count)
+{
+    gint64 end_us = g_get_monotonic_time() + WAIT_US;
+    while (catalog_names(folder).size() > count && g_get_monotonic_time() < end_us)
+        g_usleep(10000);
+    CHECK(catalog_names(folder).size() == count);
+}
+
+static void
+check_folder(const std::string &folder, const std::vector<std::string> &expected)
+{
+    std::vector<std::string> names = catalog_names(folder);
+    std::sort(names.begin(), names.end());
+    CHECK(names == expected);
+    std::set<std::string> chunks = chunks_on_disk(folder);
+    CHECK(std::vector<std::string>(chunks.begin(), chunks.end()) == expected);
+}
+
+static std::string
+make_folder()
+{
+    gchar *path = g_dir_make_tmp("retention_test_XXXXXX", NULL);
+    CHECK(path);
+    std::string folder = path;
+    g_free(path);
+    return folder;
+}
+
+/* A folder over its budget keeps its newest chunks */
+static void
+test_folder_budget()
+{
+    std::string folder = make_folder();
+    for (gint i = 0; i < 10; i++)
+        append_chunk(folder, "chunk_" + std::to_string(i), i);
+
+    RetentionManager retention(0, 4 * CHUNK_BYTES + CHUNK_BYTES / 2);
+    retention.add_folder(folder);
+    retention.start();
+    wait_for_catalog(folder, 4);
+    retention.stop();
+    check_folder(folder, { "chunk_6", "chunk_7", "chunk_8", "chunk_9" });
+    remove_dir(folder.c_str());
+}
+
+/* Over the global budget the oldest chunk of any folder goes first */
+static void
+test_global_budget()
+{
+    std::string a = make_folder(), b = make_folder();
+    for (gint i = 0; i < 4; i++) {
+        append_chunk(a, "a_" + std::to_string(i), 2 * i);
+        append_chunk(b, "b_" + std::to_string(i), 2 * i + 1);
+    }
+
+    RetentionManager retention(3 * CHUNK_BYTES, 0);
+    retention.add_folder(a);
+    retention.add_folder(b);
+    retention.start();
+    wait_for_catalog(a, 1);
+    wait_for_catalog(b, 2);
+    retention.stop();
+    check_folder(a, { "a_3" });
+    check_folder(b, { "b_2", "b_3" });
+    remove_dir(a.c_str());
+    remove_dir(b.c_str());
+}
+
+/* Chunks appended to the catalog and handed to the manager in different
+ * orders, as when two chunks finalize concurrently, then a restart */
+static void
+test_catalog_consistency()
+{
+    std::string folder = make_folder();
+    append_chunk(folder, "chunk_0", 0);
+
+    RetentionManager retention(0, 2 * CHUNK_BYTES);
+    retention.add_folder(folder);
+    ChunkCatalogRecord chunk_3 = append_chunk(folder, "chunk_3", 3);
+    ChunkCatalogRecord chunk_1 = append_chunk(folder, "chunk_1", 1);
+    ChunkCatalogRecord chunk_2 = append_chunk(folder, "chunk_2", 2);
+    retention.add_chunk(folder, chunk_2);
+    retention.add_chunk(folder, chunk_3);
+    retention.add_chunk(folder, chunk_1);
+    retention.start();
+    wait_for_catalog(folder, 2);
+    retention.stop();
+    check_folder(folder, { "chunk_2", "chunk_3" });
+
+    /* A new manager starts from the catalog alone */
+    RetentionManager restarted(0, CHUNK_BYTES);
+    restarted.add_folder(folder);
+    restarted.start();
+    wait_for_catalog(folder, 1);
+    restarted.stop();
+    check_folder(folder, { "chunk_3" });
+    remove_dir(folder.c_str());
+}
+
+/* Dropping by name leaves the other records in catalog order */
+static void
+test_catalog_drop()
+{
+    std::string folder = make_folder();
+    std::vector<std::string> names;
+    for (gint i = 0; i < 6; i++) {
+        names.push_back("chunk_" + std::to_string((i * 5) % 6));
+        append_chunk(folder, names.back(), i);
+    }
+    CHECK(chunk_catalog_drop(folder.c_str(), { names[4], names[1], "missing" }));
+    std::vector<std::string> expected = { names[0], names[2], names[3], names[5] };
+    CHECK(catalog_names(folder) == expected);
+    CHECK(chunk_catalog_drop(folder.c_str(), {}));
+    CHECK(catalog_names(folder) == expected);
+    remove_dir(folder.c_str());
+}
+
+int
+main()
+{
+    test_folder_budget();
+    test_global_budget();
+    test_catalog_consistency();
+    test_catalog_drop();
+    printf("retention_test: ok\n");
+    return 0;
+}
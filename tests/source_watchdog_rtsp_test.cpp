@@ -0,0 +1,233 @@
+/* Stall detection and jittered reconnect against a local RTSP server.
+ *
+ * The server streams raw video through a valve per client; closing the
+ * valve stalls the client without tearing the session down, the way a
+ * camera that stops sending does. The client is torn down and rebuilt
+ * on the watchdog's schedule like the source branch in pipeline.cpp. */
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include "SourceWatchdog.h"
+#include "check.h"
+
+#define TIMEOUT_SEC 1
+#define BASE_MS 200
+#define MAX_MS 800
+#define JITTER 0.2
+#define TICK_MS 50
+#define DEADLINE_SEC 60
+
+enum Phase {
+    PHASE_CONNECTING,   /* first connection */
+    PHASE_STALLING,     /* valve closed, waiting for the stall */
+    PHASE_RECONNECTING, /* rebuilt once, waiting for frames */
+    PHASE_STALLING_AGAIN,
+    PHASE_RECOVERING,   /* rebuilt twice, must stay up past the timeout */
+};
+
+struct Fixture {
+    GMainLoop *loop;
+    gint port;
+    GstElement *server_valve;
+    GstElement *client;
+    SourceWatchdog *watchdog;
+    Phase phase;
+    gint64 stall_at_us;
+    gint64 started_at_us;
+    guint rebuild_id;
+};
+
+static void
+media_configure (GstRTSPMediaFactory *, GstRTSPMedia *media, Fixture *f)
+{
+    GstElement *element = gst_rtsp_media_get_element (media);
+    if (f->server_valve)
+        gst_object_unref (f->server_valve);
+    f->server_valve = gst_bin_get_by_name (GST_BIN (element), "valve");
+    gst_object_unref (element);
+}
+
+static GstPadProbeReturn
+buffer_probe (GstPad *, GstPadProbeInfo *, gpointer data)
+{
+    static_cast<Fixture *> (data)->watchdog->buffer_seen (g_get_monotonic_time ());
+    return GST_PAD_PROBE_OK;
+}
+
+static void
+client_start (Fixture *f)
+{
+    gchar *desc = g_strdup_printf (
+        "rtspsrc location=rtsp://127.0.0.1:%d/test protocols=tcp latency=0 "
+        "! rtpvrawdepay name=depay ! fakesink sync=false", f->port);
+    GError *error = NULL;
+    f->client = gst_parse_launch (desc, &error);
+    g_free (desc);
+    CHECK (f->client && !error);
+
+    GstElement *depay = gst_bin_get_by_name (GST_BIN (f->client), "depay");
+    GstPad *pad = gst_element_get_static_pad (depay, "src");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, buffer_probe, f, NULL);
+    gst_object_unref (pad);
+    gst_object_unref (depay);
+
+    f->watchdog->branch_created (g_get_monotonic_time ());
+    CHECK (gst_element_set_state (f->client, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+}
+
+static void
+client_stop (Fixture *f)
+{
+    gst_element_set_state (f->client, GST_STATE_NULL);
+    gst_object_unref (f->client);
+    f->client = NULL;
+}
+
+static gboolean
+client_rebuild (gpointer data)
+{
+    Fixture *f = static_cast<Fixture *> (data);
+    f->rebuild_id = 0;
+    client_start (f);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+stall_server (Fixture *f)
+{
+    CHECK (f->server_valve);
+    g_object_set (f->server_valve, "drop", TRUE, NULL);
+    f->stall_at_us = g_get_monotonic_time ();
+}
+
+/* The delay of the attempt'th reconnect, as scheduled by the watchdog */
+static void
+check_delay (guint delay, guint attempt)
+{
+    guint expected = MIN (BASE_MS << attempt, MAX_MS);
+    CHECK (delay >= expected * (1.0 - JITTER) && delay <= expected * (1.0 + JITTER));
+}
+
+static void
+handle_stall (Fixture *f, guint attempt)
+{
+    /* Counted from the last frame, which may have left just before the
+     * valve closed: no earlier than a frame interval before the timeout */
+    gint64 latency = g_get_monotonic_time () - f->stall_at_us;
+    CHECK (latency >= TIMEOUT_SEC * G_USEC_PER_SEC - 200 * 1000);
+    CHECK (latency <= TIMEOUT_SEC * G_USEC_PER_SEC + 500 * 1000);
+
+    client_stop (f);
+    guint delay = f->watchdog->next_reconnect_delay_ms (g_random_double ());
+    check_delay (delay, attempt);
+    CHECK (f->watchdog->attempts () == attempt + 1);
+    f->rebuild_id = g_timeout_add (delay, client_rebuild, f);
+}
+
+static gboolean
+tick (gpointer data)
+{
+    Fixture *f = static_cast<Fixture *> (data);
+    if (!f->client)
+        return G_SOURCE_CONTINUE;
+
+    gint64 now = g_get_monotonic_time ();
+    SourceWatchdog::Verdict verdict = f->watchdog->tick (now);
+
+    switch (f->phase) {
+    case PHASE_CONNECTING:
+        CHECK (verdict != SourceWatchdog::SOURCE_STALLED);
+        if (verdict == SourceWatchdog::SOURCE_STARTED) {
+            stall_server (f);
+            f->phase = PHASE_STALLING;
+        }
+        break;
+    case PHASE_STALLING:
+        if (verdict == SourceWatchdog::SOURCE_STALLED) {
+            handle_stall (f, 0);
+            f->phase = PHASE_RECONNECTING;
+        }
+        break;
+    case PHASE_RECONNECTING:
+        CHECK (verdict != SourceWatchdog::SOURCE_STALLED);
+        if (verdict == SourceWatchdog::SOURCE_STARTED) {
+            /* Stalls again before proving stable: backs off further */
+            stall_server (f);
+            f->phase = PHASE_STALLING_AGAIN;
+        }
+        break;
+    case PHASE_STALLING_AGAIN:
+        if (verdict == SourceWatchdog::SOURCE_STALLED) {
+            handle_stall (f, 1);
+            f->phase = PHASE_RECOVERING;
+        }
+        break;
+    case PHASE_RECOVERING:
+        CHECK (verdict != SourceWatchdog::SOURCE_STALLED);
+        if (verdict == SourceWatchdog::SOURCE_STARTED)
+            f->started_at_us = now;
+        if (f->started_at_us &&
+            now - f->started_at_us > 2 * TIMEOUT_SEC * G_USEC_PER_SEC) {
+            /* Stable long enough: the next failure starts from the base */
+            CHECK (f->watchdog->attempts () == 0);
+            g_main_loop_quit (f->loop);
+        }
+        break;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+deadline (gpointer)
+{
+    CHECK (!"deadline passed before the client recovered");
+    return G_SOURCE_REMOVE;
+}
+
+int
+main (int argc, char *argv[])
+{
+    gst_init (&argc, &argv);
+
+    const gchar *needed[] = { "videotestsrc", "valve", "rtpvrawpay", "rtpvrawdepay", "rtspsrc" };
+    for (guint i = 0; i < G_N_ELEMENTS (needed); i++) {
+        GstElementFactory *factory = gst_element_factory_find (needed[i]);
+        if (!factory)
+            SKIP (needed[i]);
+        gst_object_unref (factory);
+    }
+
+    Fixture f = Fixture ();
+    f.loop = g_main_loop_new (NULL, FALSE);
+    f.watchdog = new SourceWatchdog (TIMEOUT_SEC, BASE_MS, MAX_MS, JITTER);
+
+    /* Not shared: every client gets its own media and valve */
+    GstRTSPServer *server = gst_rtsp_server_new ();
+    gst_rtsp_server_set_service (server, "0");
+    GstRTSPMediaFactory *factory = gst_rtsp_media_factory_new ();
+    gst_rtsp_media_factory_set_launch (factory,
+        "( videotestsrc is-live=true ! video/x-raw,format=I420,width=64,height=48,framerate=10/1 "
+        "! valve name=valve ! rtpvrawpay name=pay0 pt=96 )");
+    gst_rtsp_media_factory_set_shared (factory, FALSE);
+    g_signal_connect (factory, "media-configure", G_CALLBACK (media_configure), &f);
+    GstRTSPMountPoints *mounts = gst_rtsp_server_get_mount_points (server);
+    gst_rtsp_mount_points_add_factory (mounts, "/test", factory);
+    g_object_unref (mounts);
+    CHECK (gst_rtsp_server_attach (server, NULL) != 0);
+    f.port = gst_rtsp_server_get_bound_port (server);
+    CHECK (f.port > 0);
+
+    client_start (&f);
+    g_timeout_add (TICK_MS, tick, &f);
+    g_timeout_add_seconds (DEADLINE_SEC, deadline, NULL);
+    g_main_loop_run (f.loop);
+
+    client_stop (&f);
+    if (f.server_valve)
+        gst_object_unref (f.server_valve);
+    g_object_unref (server);
+    delete f.watchdog;
+    g_main_loop_unref (f.loop);
+    printf ("source_watchdog_rtsp_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* Stall detection and reconnect backoff of SourceWatchdog on a fake clock */
+#include "SourceWatchdog.h"
+#include "check.h"
+
+#define TIMEOUT_SEC 10
+#define BASE_MS 250
+#define MAX_MS 30000
+#define JITTER 0.2
+
+static const gint64 SEC = G_USEC_PER_SEC;
+
+static void
+test_stall_detection()
+{
+    SourceWatchdog watchdog(TIMEOUT_SEC, BASE_MS, MAX_MS, JITTER);
+    gint64 t = 1000 * SEC;
+
+    /* A branch that never delivers stalls once the timeout passed */
+    watchdog.branch_created(t);
+    CHECK(watchdog.tick(t + TIMEOUT_SEC * SEC) == SourceWatchdog::SOURCE_WAITING);
+    CHECK(watchdog.tick(t + TIMEOUT_SEC * SEC + 1) == SourceWatchdog::SOURCE_STALLED);
+
+    /* The first buffer starts it, once */
+    watchdog.branch_created(t += 20 * SEC);
+    watchdog.buffer_seen(t + SEC);
+    CHECK(watchdog.tick(t + SEC) == SourceWatchdog::SOURCE_STARTED);
+    CHECK(watchdog.up_since_us() == t + SEC);
+    CHECK(watchdog.tick(t + 2 * SEC) == SourceWatchdog::SOURCE_WAITING);
+
+    /* Buffers keep it alive for as long as they come */
+    for (gint i = 2; i < 100; i++) {
+        watchdog.buffer_seen(t + i * SEC);
+        CHECK(watchdog.tick(t + i * SEC + SEC / 2) == SourceWatchdog::SOURCE_WAITING);
+    }
+    gint64 last = t + 99 * SEC;
+    CHECK(watchdog.tick(last + TIMEOUT_SEC * SEC) == SourceWatchdog::SOURCE_WAITING);
+    CHECK(watchdog.tick(last + TIMEOUT_SEC * SEC + 1) == SourceWatchdog::SOURCE_STALLED);
+
+    /* A buffer of the previous branch does not start the next one */
+    watchdog.branch_created(last + 20 * SEC);
+    CHECK(watchdog.tick(last + 21 * SEC) == SourceWatchdog::SOURCE_WAITING);
+    CHECK(watchdog.up_since_us() == 0);
+}
+
+static void
+test_backoff()
+{
+    SourceWatchdog low(TIMEOUT_SEC, BASE_MS, MAX_MS, JITTER);
+    SourceWatchdog high(TIMEOUT_SEC, BASE_MS, MAX_MS, JITTER);
+    guint64 expected = BASE_MS;
+
+    /* Doubles per attempt up to the cap, spread by +-JITTER */
+    for (guint attempt = 0; attempt < 12; attempt++) {
+        guint lo = low.next_reconnect_delay_ms(0.0);
+        guint hi = high.next_reconnect_delay_ms(0.999999);
+        CHECK(lo == (guint) (expected * (1.0 - JITTER)));
+        CHECK(hi <= expected * (1.0 + JITTER) && hi + 1 >= expected * (1.0 + JITTER));
+        CHECK(low.attempts() == attempt + 1);
+        expected = MIN(expected * 2, (guint64) MAX_MS);
+    }
+    CHECK(expected == MAX_MS);
+
+    /* Random draws stay within the band and spread over it */
+    SourceWatchdog spread(TIMEOUT_SEC, BASE_MS, MAX_MS, JITTER);
+    guint min_delay = G_MAXUINT, max_delay = 0;
+    for (gint i = 0; i < 10000; i++) {
+        for (gint k = 0; k < 20; k++)
+            spread.next_reconnect_delay_ms(0.5);
+        guint delay = spread.next_reconnect_delay_ms(g_random_double());
+        CHECK(delay >= MAX_MS * (1.0 - JITTER) && delay <= MAX_MS * (1.0 + JITTER));
+        min_delay = MIN(min_delay, delay);
+        max_delay = MAX(max_delay, delay);
+    }
+    CHECK(min_delay < MAX_MS * (1.0 - JITTER / 2));
+    CHECK(max_delay > MAX_MS * (1.0 + JITTER / 2));
+}
+
+static void
+test_backoff_reset()
+{
+    SourceWatchdog watchdog(TIMEOUT_SEC, BASE_MS, MAX_MS, JITTER);
+    gint64 t = 1000 * SEC;
+
+    watchdog.next_reconnect_delay_ms(0.5);
+    watchdog.next_reconnect_delay_ms(0.5);
+    CHECK(watchdog.attempts() == 2);
+
+    /* Flapping: streams for less than the timeout, keeps backing off */
+    watchdog.branch_created(t);
+    watchdog.buffer_seen(t + SEC);
+    CHECK(watchdog.tick(t + SEC) == SourceWatchdog::SOURCE_STARTED);
+    watchdog.buffer_seen(t + TIMEOUT_SEC * SEC);
+    CHECK(watchdog.tick(t + TIMEOUT_SEC * SEC) == SourceWatchdog::SOURCE_WAITING);
+    CHECK(watchdog.attempts() == 2);
+    CHECK(watchdog.next_reconnect_delay_ms(0.5) == BASE_MS * 4);
+
+    /* Stays up past the timeout: the next failure starts from the base */
+    watchdog.branch_created(t += 20 * SEC);
+    for (gint i = 1; i <= TIMEOUT_SEC + 2; i++) {
+        watchdog.buffer_seen(t + i * SEC);
+        watchdog.tick(t + i * SEC);
+    }
+    CHECK(watchdog.attempts() == 0);
+    CHECK(watchdog.next_reconnect_delay_ms(0.5) == BASE_MS);
+    CHECK(watchdog.up_since_us() == 0);
+}
+
+int
+main()
+{
+    test_stall_detection();
+    test_backoff();
+    test_backoff_reset();
+    printf("source_watchdog_test: ok\n");
+    return 0;
+}
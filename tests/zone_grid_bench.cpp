@@ -0,0 +1,89 @@
+/* ZoneGrid::query against testing every zone's box, which is what finding an
+ * object's zones cost before the grid, for 1 to 200 zones and 1 to 200
+ * objects per 1920x1080 frame. Zones are random quadrilaterals up to 400
+ * pixels across, objects random boxes up to 200. */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include "zone_grid.h"
+#include "check.h"
+
+#define BENCH_MS 200
+#define WIDTH 1920
+#define HEIGHT 1080
+
+typedef std::vector<std::pair<int, int>> Polygon;
+
+template <typename F>
+static double time_us(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::milliseconds(BENCH_MS);
+    uint64_t runs = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        f();
+        runs++;
+    }
+    std::chrono::duration<double, std::micro> spent = std::chrono::steady_clock::now() - start;
+    return spent.count() / runs;
+}
+
+int main()
+{
+    const int zone_counts[] = { 1, 10, 25, 50, 100, 200 };
+    const int object_counts[] = { 1, 10, 50, 100, 200 };
+
+    printf("%6s %8s %12s %14s %10s\n", "zones", "objects", "grid us", "all zones us", "matches");
+    for (int zone_count : zone_counts) {
+        std::vector<Polygon> polygons(zone_count);
+        std::vector<const Polygon *> zones;
+        for (Polygon &polygon : polygons) {
+            int x = random_int(WIDTH), y = random_int(HEIGHT);
+            int w = 20 + random_int(380), h = 20 + random_int(380);
+            polygon = { {x, y}, {x + w, y}, {x + w, y + h}, {x, y + h} };
+            zones.push_back(&polygon);
+        }
+        ZoneGrid grid;
+        grid.build(zones, WIDTH, HEIGHT);
+
+        for (int object_count : object_counts) {
+            std::vector<ZoneBox> objects;
+            for (int i = 0; i < object_count; i++) {
+                int x = random_int(WIDTH), y = random_int(HEIGHT);
+                objects.push_back({ x, y, x + 10 + random_int(190), y + 10 + random_int(190) });
+            }
+
+            std::vector<uint32_t> candidates;
+            size_t grid_matches = 0, all_matches = 0;
+            double grid_us = time_us([&] {
+                grid_matches = 0;
+                for (const ZoneBox &box : objects) {
+                    grid.query(box, candidates);
+                    grid_matches += candidates.size();
+                }
+            });
+            double all_us = time_us([&] {
+                all_matches = 0;
+                for (const ZoneBox &box : objects) {
+                    candidates.clear();
+                    for (uint32_t zone = 0; zone < (uint32_t) zone_count; zone++) {
+                        const ZoneBox &z = grid.bounds(zone);
+                        if (!z.empty() && z.x0 < box.x1 && box.x0 < z.x1 && z.y0 < box.y1 && box.y0 < z.y1)
+                            candidates.push_back(zone);
+                    }
+                    all_matches += candidates.size();
+                }
+            });
+            if (grid_matches != all_matches) {
+                fprintf(stderr, "grid found %zu zones, all zones %zu\n", grid_matches, all_matches);
+                return 1;
+            }
+            printf("%6d %8d %12.2f %14.2f %10zu\n", zone_count, object_count, grid_us, all_us,
+                grid_matches);
+        }
+    }
+    return 0;
+}
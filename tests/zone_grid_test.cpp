@@ -0,0 +1,85 @@
+/* ZoneGrid::query against testing every zone's bounding box, computed here
+ * from the polygon, for random frames, polygons reaching off the frame and
+ * query boxes that are empty, off the frame or cover all of it. */
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "zone_grid.h"
+#include "check.h"
+
+#define ROUNDS 2000
+#define QUERIES 50
+#define MAX_ZONES 40
+
+typedef std::vector<std::pair<int, int>> Polygon;
+
+/* The pixels fillPoly would cover are inside the points' box, clipped */
+static ZoneBox reference_box(const Polygon &polygon, int width, int height)
+{
+    ZoneBox box = { width, height, 0, 0 };
+    for (const auto &pt : polygon) {
+        box.x0 = std::min(box.x0, pt.first);
+        box.y0 = std::min(box.y0, pt.second);
+        box.x1 = std::max(box.x1, pt.first + 1);
+        box.y1 = std::max(box.y1, pt.second + 1);
+    }
+    box.x0 = std::max(box.x0, 0);
+    box.y0 = std::max(box.y0, 0);
+    box.x1 = std::min(box.x1, width);
+    box.y1 = std::min(box.y1, height);
+    return box;
+}
+
+static bool overlaps(const ZoneBox &a, const ZoneBox &b)
+{
+    return !a.empty() && !b.empty() && a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+}
+
+int main()
+{
+    std::vector<uint32_t> got, expected;
+
+    FOR_ROUNDS(round, ROUNDS) {
+        int width = 1 + random_int(700), height = 1 + random_int(400);
+        std::vector<Polygon> polygons(random_int(MAX_ZONES + 1));
+        std::vector<const Polygon *> zones;
+        for (Polygon &polygon : polygons) {
+            int points = 3 + random_int(4);
+            for (int i = 0; i < points; i++)
+                polygon.emplace_back(random_int(width + 100) - 50, random_int(height + 100) - 50);
+            zones.push_back(&polygon);
+        }
+
+        ZoneGrid grid;
+        grid.build(zones, width, height);
+
+        std::vector<ZoneBox> boxes;
+        for (const Polygon &polygon : polygons)
+            boxes.push_back(reference_box(polygon, width, height));
+        for (uint32_t zone = 0; zone < boxes.size(); zone++) {
+            const ZoneBox &box = grid.bounds(zone);
+            CHECK(box.x0 == boxes[zone].x0 && box.y0 == boxes[zone].y0);
+            CHECK(box.x1 == boxes[zone].x1 && box.y1 == boxes[zone].y1);
+        }
+
+        for (int q = 0; q < QUERIES + 1; q++) {
+            ZoneBox query;
+            if (q == QUERIES) {
+                query = { -10, -10, width + 10, height + 10 };
+            } else {
+                int x = random_int(width + 200) - 100, y = random_int(height + 200) - 100;
+                query = { x, y, x + random_int(150), y + random_int(150) };
+            }
+            grid.query(query, got);
+
+            expected.clear();
+            for (uint32_t zone = 0; zone < boxes.size(); zone++) {
+                if (overlaps(boxes[zone], query))
+                    expected.push_back(zone);
+            }
+            CHECK(got == expected);
+        }
+    }
+    return 0;
+}
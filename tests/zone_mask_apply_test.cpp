@@ -0,0 +1,135 @@
+/* ZoneMaskCpuBackend::apply on malloc'd host planes against a per-pixel
+ * reference, for 1, 2 and 4 bytes per pixel, the plugin's fills (memset) and
+ * multi-byte patterns. Rows are padded and the plane is fenced with guard
+ * bytes so writes past a row or the plane are caught. */
+#include <stdlib.h>
+#include <string.h>
+#include "zone_mask.h"
+#include "check.h"
+
+#define ROUNDS 300
+#define GUARD 64
+#define GUARD_BYTE 0xa5
+
+/* Spans straight into the mask, with lengths around the 32 byte pattern and
+ * spans reaching past the plane */
+static void
+random_mask (ZoneMask *mask, gint width, gint height)
+{
+    mask->height = height + random_int(4) - 2;
+    mask->spans.clear();
+    mask->row_offsets.assign(1, 0);
+    for (gint y = 0; y < mask->height; y++) {
+        gint x = random_int(8);
+        while (x < width + 8 && random_int(4)) {
+            ZoneSpan span;
+            span.x0 = x;
+            span.x1 = x + 1 + (random_int(2) ? random_int(40) : random_int(200));
+            mask->spans.push_back(span);
+            x = span.x1 + 1 + random_int(20);
+        }
+        mask->row_offsets.push_back((guint32) mask->spans.size());
+    }
+}
+
+static gboolean
+masked (const ZoneMask &mask, gint x, gint y)
+{
+    if (y >= mask.height)
+        return FALSE;
+    for (const ZoneSpan *span = mask.row_begin(y); span != mask.row_end(y); span++) {
+        if (x >= span->x0 && x < span->x1)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+check_apply (ZoneMaskBackend *backend, const ZoneMask &mask, gint width, gint height,
+    gint bpp, const guint8 *fill)
+{
+    gint pitch = width * bpp + random_int(3) * 16 + random_int(2) * bpp;
+    gsize size = (gsize) pitch * height;
+    guint8 *block = (guint8 *) malloc(size + 2 * GUARD);
+    guint8 *expected = (guint8 *) malloc(size);
+    CHECK(block && expected);
+
+    guint8 *data = block + GUARD;
+    memset(block, GUARD_BYTE, GUARD);
+    memset(data + size, GUARD_BYTE, GUARD);
+    for (gsize i = 0; i < size; i++)
+        data[i] = expected[i] = (guint8) random_int(256);
+
+    for (gint y = 0; y < height; y++) {
+        for (gint x = 0; x < width; x++) {
+            if (masked(mask, x, y))
+                memcpy(expected + (gsize) y * pitch + (gsize) x * bpp, fill, bpp);
+        }
+    }
+
+    ZoneMaskPlane plane;
+    plane.data = data;
+    plane.pitch = pitch;
+    plane.width = width;
+    plane.height = height;
+    plane.bytes_per_pixel = bpp;
+    memcpy(plane.fill, fill, sizeof(plane.fill));
+    CHECK(backend->apply(mask, plane));
+
+    /* Row padding past width must be left alone as well */
+    CHECK(memcmp(data, expected, size) == 0);
+    for (gint i = 0; i < GUARD; i++)
+        CHECK(block[i] == GUARD_BYTE && data[size + i] == GUARD_BYTE);
+    free(block);
+    free(expected);
+}
+
+static void
+run_backend (ZoneMaskBackend *backend)
+{
+    const gint bpps[] = { 1, 2, 4 };
+    FOR_ROUNDS(round, ROUNDS) {
+        gint width = 1 + random_int(round % 2 ? 64 : 700);
+        gint height = 1 + random_int(40);
+        ZoneMask mask;
+        random_mask(&mask, width, height);
+
+        for (gint bpp : bpps) {
+            /* Uniform goes to memset, the rest to the pattern fill */
+            guint8 uniform[4];
+            memset(uniform, random_int(256), sizeof(uniform));
+            check_apply(backend, mask, width, height, bpp, uniform);
+            if (bpp > 1) {
+                guint8 pattern[4] = { 16, 128, 235, 255 };
+                check_apply(backend, mask, width, height, bpp, pattern);
+            }
+        }
+    }
+
+    /* Compiled polygons, cut off by a smaller plane */
+    std::vector<ZonePolygon> polygons = {
+        { {10, 5}, {600, 40}, {300, 470} },
+        { {0, 0}, {1279, 0}, {1279, 719}, {0, 719} },
+    };
+    ZoneMask compiled;
+    zone_mask_compile(polygons, &compiled);
+    const guint8 rgba[4] = { 0, 255, 0, 255 };
+    check_apply(backend, compiled, 640, 360, 4, rgba);
+    check_apply(backend, compiled, 1280, 720, 4, rgba);
+
+    /* Only 1, 2 and 4 bytes per pixel */
+    guint8 pixel[3] = { 0, 0, 0 };
+    ZoneMaskPlane plane = { pixel, 3, 1, 1, 3, { 1, 2, 3, 0 } };
+    CHECK(!backend->apply(compiled, plane));
+}
+
+int
+main ()
+{
+    ZoneMaskBackend *backend = zone_mask_backend_new_cpu();
+    run_backend(backend);
+    delete backend;
+
+    printf("zone_mask_apply_test: ok\n");
+    return 0;
+}
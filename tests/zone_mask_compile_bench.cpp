@@ -0,0 +1,71 @@
+/* zone_mask_compile against rasterising the same zones with cv::fillPoly,
+ * which is what a bitmap mask costs, at 640x360, 1280x720 and 1920x1080.
+ * The zones are drawn for 1920x1080 and scaled to each resolution. */
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+#include "zone_mask.h"
+
+#define BENCH_MS 300
+
+static const ZonePolygon zones_1080p[] = {
+    { {0, 0}, {1919, 0}, {1919, 120}, {0, 120} },                       // timestamp band
+    { {100, 400}, {700, 300}, {900, 900}, {400, 1079}, {60, 800} },
+    { {1200, 200}, {1800, 250}, {1700, 700}, {1500, 500}, {1250, 650} }, // concave
+    { {800, 600}, {1100, 580}, {1150, 1000}, {820, 1050} },
+    { {1500, 800}, {1900, 760}, {1910, 1079}, {1450, 1070} },
+    { {300, 150}, {500, 160}, {480, 350}, {310, 330} },
+    { {960, 300}, {1060, 400}, {960, 500}, {860, 400} },               // diamond
+    { {0, 1000}, {1919, 1000}, {1919, 1079}, {0, 1079} },
+};
+
+template <typename F>
+static gdouble
+time_us (F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::milliseconds(BENCH_MS);
+    guint64 runs = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        f();
+        runs++;
+    }
+    std::chrono::duration<gdouble, std::micro> spent = std::chrono::steady_clock::now() - start;
+    return spent.count() / runs;
+}
+
+int
+main ()
+{
+    const gint resolutions[][2] = { {640, 360}, {1280, 720}, {1920, 1080} };
+
+    printf("%-10s %14s %14s %12s %12s\n", "frame", "compile us", "fillPoly us", "spans B", "bitmap B");
+    for (const gint *res : resolutions) {
+        gint width = res[0], height = res[1];
+        std::vector<ZonePolygon> polygons;
+        std::vector<std::vector<cv::Point>> contours;
+        for (const ZonePolygon &zone : zones_1080p) {
+            ZonePolygon polygon;
+            std::vector<cv::Point> contour;
+            for (const ZonePoint &p : zone) {
+                ZonePoint scaled = { p.x * width / 1920, p.y * height / 1080 };
+                polygon.push_back(scaled);
+                contour.push_back(cv::Point(scaled.x, scaled.y));
+            }
+            polygons.push_back(polygon);
+            contours.push_back(contour);
+        }
+
+        ZoneMask mask;
+        gdouble compile_us = time_us([&] { zone_mask_compile(polygons, &mask); });
+        cv::Mat bitmap;
+        gdouble fill_us = time_us([&] {
+            bitmap = cv::Mat::zeros(height, width, CV_8UC1);
+            cv::fillPoly(bitmap, contours, cv::Scalar(255));
+        });
+
+        gsize span_bytes = mask.spans.size() * sizeof(ZoneSpan) + mask.row_offsets.size() * sizeof(guint32);
+        printf("%4dx%-5d %14.1f %14.1f %12zu %12zu\n", width, height, compile_us, fill_us,
+            span_bytes, bitmap.total());
+    }
+    return 0;
+}
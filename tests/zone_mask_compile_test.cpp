@@ -0,0 +1,119 @@
+/* zone_mask_compile against an even-odd point-in-polygon test at every pixel
+ * centre, for random convex, concave and self-intersecting polygons, zones
+ * overlapping each other and zones reaching off the frame. Also checks that
+ * every row's spans are sorted and disjoint, and zone_mask_subsample against
+ * the 2x2 definition. */
+#include "zone_mask.h"
+#include "check.h"
+
+#define ROUNDS 400
+#define FRAME 96
+
+/* Even-odd rule with a ray to the right of the pixel centre */
+static gboolean
+point_in_polygon (const ZonePolygon &polygon, gint x, gint y)
+{
+    gdouble xc = x + 0.5, yc = y + 0.5;
+    gboolean inside = FALSE;
+    gsize n = polygon.size();
+    if (n < 3)
+        return FALSE;
+    for (gsize i = 0; i < n; i++) {
+        const ZonePoint &a = polygon[i];
+        const ZonePoint &b = polygon[(i + 1) % n];
+        if ((a.y <= yc) != (b.y <= yc) &&
+            xc < a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y))
+            inside = !inside;
+    }
+    return inside;
+}
+
+static gboolean
+in_spans (const ZoneMask &mask, gint x, gint y)
+{
+    if (y >= mask.height)
+        return FALSE;
+    for (const ZoneSpan *span = mask.row_begin(y); span != mask.row_end(y); span++) {
+        if (x >= span->x0 && x < span->x1)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+check_well_formed (const ZoneMask &mask)
+{
+    CHECK(mask.row_offsets.size() == (gsize) mask.height + 1);
+    CHECK(mask.row_offsets.back() == mask.spans.size());
+    for (gint y = 0; y < mask.height; y++) {
+        for (const ZoneSpan *span = mask.row_begin(y); span != mask.row_end(y); span++) {
+            CHECK(span->x0 >= 0 && span->x0 < span->x1);
+            /* Touching spans are merged too */
+            if (span + 1 != mask.row_end(y))
+                CHECK(span->x1 < span[1].x0);
+        }
+    }
+}
+
+static ZonePolygon
+random_polygon ()
+{
+    ZonePolygon polygon;
+    gint n = 3 + random_int(8);
+    for (gint i = 0; i < n; i++) {
+        ZonePoint p;
+        p.x = random_int(FRAME + 40) - 20;
+        p.y = random_int(FRAME + 20);
+        polygon.push_back(p);
+    }
+    /* Axis aligned edges and vertices on rows, the usual way zones are drawn */
+    if (random_int(2)) {
+        polygon[1].y = polygon[0].y;
+        polygon[n - 1].x = polygon[0].x;
+    }
+    return polygon;
+}
+
+int
+main ()
+{
+    FOR_ROUNDS(round, ROUNDS) {
+        std::vector<ZonePolygon> polygons;
+        gint zones = 1 + random_int(4);
+        for (gint i = 0; i < zones; i++)
+            polygons.push_back(random_polygon());
+        if (random_int(8) == 0)
+            polygons.push_back({ {5, 5}, {20, 5} });    // degenerate, ignored
+
+        ZoneMask mask;
+        zone_mask_compile(polygons, &mask);
+        check_well_formed(mask);
+
+        gint height = MAX(mask.height, FRAME + 20);
+        for (gint y = 0; y < height; y++) {
+            for (gint x = 0; x < FRAME + 40; x++) {
+                gboolean expected = FALSE;
+                for (const ZonePolygon &polygon : polygons)
+                    expected |= point_in_polygon(polygon, x, y);
+                if (in_spans(mask, x, y) != expected) {
+                    fprintf(stderr, "round %d pixel %d,%d: spans %d, polygons %d\n",
+                        round, x, y, !expected, expected);
+                    CHECK(in_spans(mask, x, y) == expected);
+                }
+            }
+        }
+
+        ZoneMask half;
+        zone_mask_subsample(mask, G_MAXINT, G_MAXINT, &half);
+        check_well_formed(half);
+        for (gint y = 0; y < (height + 1) / 2; y++) {
+            for (gint x = 0; x < (FRAME + 40) / 2; x++) {
+                gboolean expected = in_spans(mask, 2 * x, 2 * y) || in_spans(mask, 2 * x + 1, 2 * y) ||
+                    in_spans(mask, 2 * x, 2 * y + 1) || in_spans(mask, 2 * x + 1, 2 * y + 1);
+                CHECK(in_spans(half, x, y) == expected);
+            }
+        }
+    }
+    printf("zone_mask_compile_test: ok\n");
+    return 0;
+}
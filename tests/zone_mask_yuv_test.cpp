@@ -0,0 +1,180 @@
+/* NV12 and I420 masking against the RGBA path. Planes are laid out the way
+ * NvBufSurface describes them (chroma (w+1)/2 x (h+1)/2, padded pitches) and
+ * masked plane by plane as gstdsexample's mask jobs do. A pixel the RGBA path
+ * blacks out must come out as black luma with neutral chroma; every luma and
+ * chroma sample of unmasked pixels must be left alone. Odd widths and
+ * heights put half covered chroma samples on the right and bottom edges. */
+#include <stdlib.h>
+#include <string.h>
+#include "zone_mask.h"
+#include "check.h"
+
+#define ROUNDS 200
+#define PITCH_ALIGN 64
+
+enum Format { FORMAT_RGBA, FORMAT_NV12, FORMAT_I420 };
+
+struct Frame {
+    Format format;
+    gint width;
+    gint height;
+    guint num_planes;
+    ZoneMaskPlane planes[3];
+    std::vector<guint8> memory[3];
+    std::vector<guint8> original[3];
+};
+
+static void
+add_plane (Frame *frame, gint width, gint height, gint bpp)
+{
+    guint p = frame->num_planes++;
+    gint pitch = (width * bpp + PITCH_ALIGN - 1) / PITCH_ALIGN * PITCH_ALIGN;
+    frame->memory[p].resize((gsize) pitch * height);
+    /* Never the fill values, so every write shows */
+    for (guint8 &byte : frame->memory[p])
+        byte = (guint8) (17 + random_int(111));
+    frame->original[p] = frame->memory[p];
+
+    ZoneMaskPlane *plane = &frame->planes[p];
+    plane->data = frame->memory[p].data();
+    plane->pitch = pitch;
+    plane->width = width;
+    plane->height = height;
+    plane->bytes_per_pixel = bpp;
+    zone_mask_plane_fill(frame->format == FORMAT_RGBA, p, plane->fill);
+}
+
+static void
+mask_frame (Frame *frame, Format format, gint width, gint height,
+    const ZoneMaskSource &source, ZoneMaskBackend *backend)
+{
+    gint chroma_width = (width + 1) / 2, chroma_height = (height + 1) / 2;
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    frame->num_planes = 0;
+    switch (format) {
+    case FORMAT_RGBA:
+        add_plane(frame, width, height, 4);
+        break;
+    case FORMAT_NV12:
+        add_plane(frame, width, height, 1);
+        add_plane(frame, chroma_width, chroma_height, 2);
+        break;
+    case FORMAT_I420:
+        add_plane(frame, width, height, 1);
+        add_plane(frame, chroma_width, chroma_height, 1);
+        add_plane(frame, chroma_width, chroma_height, 1);
+        break;
+    }
+    for (guint p = 0; p < frame->num_planes; p++)
+        CHECK(backend->apply(source.plane(p), frame->planes[p]));
+}
+
+/* Each byte of a sample either kept or set to the fill */
+static gboolean
+sample_masked (const Frame &frame, guint p, gint x, gint y)
+{
+    const ZoneMaskPlane &plane = frame.planes[p];
+    gsize at = (gsize) y * plane.pitch + (gsize) x * plane.bytes_per_pixel;
+    gboolean filled = memcmp(&frame.memory[p][at], plane.fill, plane.bytes_per_pixel) == 0;
+    gboolean kept = memcmp(&frame.memory[p][at], &frame.original[p][at], plane.bytes_per_pixel) == 0;
+    CHECK(filled != kept);
+    return filled;
+}
+
+static void
+check_padding (const Frame &frame)
+{
+    for (guint p = 0; p < frame.num_planes; p++) {
+        const ZoneMaskPlane &plane = frame.planes[p];
+        for (gint y = 0; y < plane.height; y++) {
+            gsize row = (gsize) y * plane.pitch;
+            gsize used = (gsize) plane.width * plane.bytes_per_pixel;
+            CHECK(memcmp(&frame.memory[p][row + used], &frame.original[p][row + used], plane.pitch - used) == 0);
+        }
+    }
+}
+
+static void
+check_yuv (const Frame &rgba, const Frame &yuv)
+{
+    check_padding(yuv);
+    for (gint y = 0; y < yuv.height; y++) {
+        for (gint x = 0; x < yuv.width; x++)
+            CHECK(sample_masked(yuv, 0, x, y) == sample_masked(rgba, 0, x, y));
+    }
+
+    /* A chroma sample is neutral iff a pixel of the frame it covers is masked */
+    for (guint p = 1; p < yuv.num_planes; p++) {
+        for (gint cy = 0; cy < yuv.planes[p].height; cy++) {
+            for (gint cx = 0; cx < yuv.planes[p].width; cx++) {
+                gboolean covered = FALSE;
+                for (gint y = 2 * cy; y < MIN (2 * cy + 2, yuv.height); y++) {
+                    for (gint x = 2 * cx; x < MIN (2 * cx + 2, yuv.width); x++)
+                        covered |= sample_masked(rgba, 0, x, y);
+                }
+                if (sample_masked(yuv, p, cx, cy) != covered) {
+                    fprintf(stderr, "%s %dx%d plane %u sample %d,%d: neutral %d, covers masked %d\n",
+                        yuv.format == FORMAT_NV12 ? "NV12" : "I420", yuv.width, yuv.height,
+                        p, cx, cy, !covered, covered);
+                    CHECK(sample_masked(yuv, p, cx, cy) == covered);
+                }
+            }
+        }
+    }
+}
+
+static ZonePolygon
+random_polygon (gint width, gint height)
+{
+    ZonePolygon polygon;
+    gint n = 3 + random_int(5);
+    for (gint i = 0; i < n; i++) {
+        ZonePoint p;
+        p.x = random_int(width + 4) - 2;
+        p.y = random_int(height + 4) - 2;
+        polygon.push_back(p);
+    }
+    return polygon;
+}
+
+int
+main ()
+{
+    const gint sizes[][2] = {
+        {64, 48}, {63, 48}, {64, 47}, {63, 47}, {1, 1}, {2, 1}, {1, 2}, {3, 5}, {641, 361},
+    };
+    ZoneMaskBackend *backend = zone_mask_backend_new_cpu();
+
+    FOR_ROUNDS(round, ROUNDS) {
+        const gint *size = sizes[round % G_N_ELEMENTS(sizes)];
+        gint width = size[0], height = size[1];
+
+        /* Single pixel columns and rows on the odd edges, and random zones */
+        std::vector<ZonePolygon> polygons;
+        if (round % 3 == 0)
+            polygons.push_back({ {width - 1, 0}, {width, 0}, {width, height}, {width - 1, height} });
+        if (round % 3 == 1)
+            polygons.push_back({ {0, height - 1}, {width, height - 1}, {width, height}, {0, height} });
+        gint zones = random_int(4);
+        for (gint i = 0; i < zones; i++)
+            polygons.push_back(random_polygon(width, height));
+
+        ZoneMaskSource source;
+        zone_mask_compile(polygons, &source.full);
+        zone_mask_subsample(source.full, width, height, &source.half);
+
+        Frame rgba, nv12, i420;
+        mask_frame(&rgba, FORMAT_RGBA, width, height, source, backend);
+        check_padding(rgba);
+        mask_frame(&nv12, FORMAT_NV12, width, height, source, backend);
+        check_yuv(rgba, nv12);
+        mask_frame(&i420, FORMAT_I420, width, height, source, backend);
+        check_yuv(rgba, i420);
+    }
+
+    delete backend;
+    printf("zone_mask_yuv_test: ok\n");
+    return 0;
+}